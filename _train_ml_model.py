@@ -4,6 +4,7 @@ ML Training Script for SDN Smart Routing
 Uses the dataset collected by SDN Controller to train advanced ML models
 """
 
+import argparse
 import pandas as pd
 import numpy as np
 from sklearn.model_selection import train_test_split
@@ -12,11 +13,15 @@ from sklearn.ensemble import RandomForestClassifier
 from sklearn.neighbors import KNeighborsClassifier
 from sklearn.tree import DecisionTreeClassifier
 from sklearn.svm import SVC
+from sklearn.neural_network import MLPClassifier
 from sklearn.metrics import accuracy_score, classification_report, confusion_matrix
 import matplotlib.pyplot as plt
 import seaborn as sns
 import joblib
 
+# as in src/FlowClassifier.h
+FLOW_DEST_BUCKETS = 16
+
 class SDNMLTrainer:
     def __init__(self, dataset_path='sdn_dataset.csv'):
         self.dataset_path = dataset_path
@@ -211,6 +216,57 @@ class SDNMLTrainer:
         self.best_accuracy = data['accuracy']
         print(f"Model loaded: {self.best_model_name} (Accuracy: {self.best_accuracy:.4f})")
     
+    @staticmethod
+    def flow_features(df):
+        """Feature vectors of flowFeatures() in src/FlowClassifier.cc"""
+        n = len(df)
+        X = np.zeros((n, 4 + FLOW_DEST_BUCKETS), dtype=np.float32)
+        X[:, 0] = 1.0
+        X[:, 1] = df['src_battery'] / 100.0
+        X[:, 2] = df['dest_battery'] / 100.0
+        X[:, 3] = df['path_distance'] / 100.0
+        X[np.arange(n), 4 + df['dest_addr'].values % FLOW_DEST_BUCKETS] = 1.0
+        return X
+
+    def export_mlp(self, df, filename='sdn_mlp.txt', hidden=(32, 16)):
+        """Train an MLP on the controller's flow features and save its weights
+        for mlModel = "mlp" (file format in src/MlpNetwork.h)"""
+        print("\n" + "="*50)
+        print("TRAINING MLP FOR THE CONTROLLER")
+        print("="*50)
+
+        X = self.flow_features(df)
+        y = df['chosen_path'].values
+        mlp = MLPClassifier(hidden_layer_sizes=hidden, activation='relu',
+                            max_iter=500, random_state=42)
+        mlp.fit(X, y)
+
+        # One output per gate, in gate order; gates never chosen get a bias
+        # that keeps them from winning. A binary classifier has a single
+        # logistic output z, which becomes the pair (-z/2, z/2).
+        W_out, b_out = mlp.coefs_[-1], mlp.intercepts_[-1]
+        if len(mlp.classes_) == 2:
+            W_out = np.hstack([-W_out / 2, W_out / 2])
+            b_out = np.concatenate([-b_out / 2, b_out / 2])
+        num_gates = int(y.max()) + 1
+        W = np.zeros((W_out.shape[0], num_gates))
+        b = np.full(num_gates, -1e4)
+        for k, gate in enumerate(mlp.classes_):
+            W[:, gate] = W_out[:, k]
+            b[gate] = b_out[k]
+        layers = list(zip(mlp.coefs_[:-1], mlp.intercepts_[:-1])) + [(W, b)]
+
+        with open(filename, 'w') as f:
+            f.write('MLP 1  # written by _train_ml_model.py\n%d\n' % len(layers))
+            for k, (W, b) in enumerate(layers):
+                activation = 'linear' if k == len(layers) - 1 else 'relu'
+                f.write('%d %d %s\n' % (W.shape[0], W.shape[1], activation))
+                np.savetxt(f, W.T, fmt='%.8g')    # one row per output
+                np.savetxt(f, b[None, :], fmt='%.8g')
+
+        print(f"Training accuracy: {mlp.score(X, y):.4f}")
+        print(f"MLP weights saved: {filename}")
+
     def predict_path(self, src_addr, dest_addr, src_battery, dest_battery, 
                      path_distance, path_delay, path_quality):
         """Predict best path for new flow"""
@@ -230,12 +286,18 @@ class SDNMLTrainer:
 
 def main():
     """Main training pipeline"""
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('dataset', nargs='?', default='sdn_dataset.csv')
+    parser.add_argument('--mlp', metavar='FILE',
+                        help='also train an MLP and save its weights for mlModel = "mlp"')
+    args = parser.parse_args()
+
     print("="*60)
     print("SDN SMART ROUTING - ML TRAINING")
     print("="*60)
     
     # Initialize trainer
-    trainer = SDNMLTrainer('sdn_dataset.csv')
+    trainer = SDNMLTrainer(args.dataset)
     
     # Load data
     df = trainer.load_data()
@@ -258,6 +320,9 @@ def main():
     
     # Save best model
     trainer.save_model()
+
+    if args.mlp:
+        trainer.export_mlp(df, args.mlp)
     
     print("\n" + "="*60)
     print("TRAINING COMPLETED!")
@@ -0,0 +1,513 @@
+//
+// Microbenchmarks of the SDN controller hot paths.
+//
+// Drives the routing math of SDNRoutingCore (KNN prediction, energy-aware
+// gate scoring, feature distance, dataset export), the online classifiers
+// of FlowClassifier, MLP inference, LinUCB bandit routing and the Routing
+// table lookup with synthetic node tables and training sets, outside of any
+// simulation.
+// The harness mimics Google Benchmark: adaptive iteration counts, a console
+// table by default and the same JSON schema with --benchmark_format=json,
+// so results can be compared across commits.
+//
+// Build and run: cd src && make bench && ./controller_bench --benchmark_format=json
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "SDNRoutingCore.h"
+#include "FlowClassifier.h"
+#include "ContextualBandit.h"
+#include "MlpNetwork.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double cpuSeconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Per-benchmark state: the loop counter and the argument, as in Google
+ * Benchmark's benchmark::State. As there, the timer runs from the first
+ * keepRunning() call to the end of the loop, so the setup before the loop
+ * and the teardown after it are not measured.
+ */
+class State
+{
+  private:
+    long remaining;
+    long arg;
+    bool started = false;
+    Clock::time_point startTime, stopTime;
+    double cpuStart = 0, cpuStop = 0;
+
+    void start() { started = true; cpuStart = cpuSeconds(); startTime = Clock::now(); }
+    void stop() { stopTime = Clock::now(); cpuStop = cpuSeconds(); }
+
+  public:
+    State(long iterations, long arg) : remaining(iterations), arg(arg) {}
+    bool keepRunning() {
+        if (!started)
+            start();
+        if (remaining-- > 0)
+            return true;
+        stop();
+        return false;
+    }
+    long range() const { return arg; }
+
+    /** Time spent in the loop, in seconds. */
+    double realSeconds() const { return std::chrono::duration<double>(stopTime - startTime).count(); }
+    double cpuSecondsUsed() const { return cpuStop - cpuStart; }
+};
+
+// Keeps the optimizer from discarding a computed value.
+template <class T>
+inline void doNotOptimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Benchmark {
+    std::string name;
+    std::function<void(State&)> fn;
+    std::vector<long> args;
+    std::string argName;
+};
+
+struct Result {
+    std::string name;
+    long iterations;
+    double realTimeNs;
+    double cpuTimeNs;
+};
+
+std::vector<Benchmark>& registry()
+{
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+struct Registrar {
+    Registrar(const char *name, std::function<void(State&)> fn,
+              std::vector<long> args = {}, const char *argName = "")
+    {
+        registry().push_back({name, fn, args, argName});
+    }
+};
+
+#define BENCHMARK_ARGS(fn, argName, ...) \
+    static Registrar fn##_registrar(#fn, fn, {__VA_ARGS__}, argName)
+#define BENCHMARK(fn) \
+    static Registrar fn##_registrar(#fn, fn)
+
+//------------------------------------------------------------------------------
+// Synthetic inputs
+
+std::mt19937 makeRng() { return std::mt19937(12345); }
+
+std::vector<FlowData> makeTrainingSet(long samples, int numGates)
+{
+    std::mt19937 rng = makeRng();
+    std::uniform_real_distribution<double> battery(20.0, 100.0), distance(10.0, 130.0);
+    std::uniform_int_distribution<int> gate(0, numGates - 1), addr(1, numGates);
+
+    std::vector<FlowData> set(samples);
+    for (long i = 0; i < samples; i++) {
+        FlowData& fd = set[i];
+        fd.srcAddr = addr(rng);
+        fd.destAddr = addr(rng);
+        fd.srcBattery = battery(rng);
+        fd.destBattery = battery(rng);
+        fd.pathDistance = distance(rng);
+        fd.chosenPath = gate(rng);
+        fd.pathDelay = 0.005;
+        fd.pathQuality = 80.0;
+        fd.timestamp = i * 0.01;
+    }
+    return set;
+}
+
+std::map<int, NodeMetrics> makeNodeDatabase(int numNodes)
+{
+    std::mt19937 rng = makeRng();
+    std::uniform_real_distribution<double> battery(10.0, 100.0), distance(10.0, 130.0), loss(0.0, 5.0);
+    std::uniform_real_distribution<double> drain(0.0, 0.5);
+    std::uniform_int_distribution<int> degree(1, 4);
+
+    std::map<int, NodeMetrics> db;
+    for (int addr = 1; addr <= numNodes; addr++) {
+        NodeMetrics& nm = db[addr];
+        nm.address = addr;
+        nm.batteryLevel = battery(rng);
+        nm.distance = distance(rng);
+        nm.avgDelay = 0.005;
+        nm.packetLoss = loss(rng);
+        nm.throughput = 5.0;
+        nm.hopCount = 1;
+        nm.linkQuality = 100.0 - nm.packetLoss;
+        nm.lastUpdate = 0;
+        nm.connectedNeighbors = degree(rng);
+        nm.batteryForecast = nm.batteryLevel;
+        nm.batteryTrend = -drain(rng);
+    }
+    return db;
+}
+
+EnergyWeights defaultWeights()
+{
+    // defaults of SDNController_ML.ned
+    return EnergyWeights{0.4, 0.3, 0.2, 0.1, 20.0, 0.0, 100.0};
+}
+
+//------------------------------------------------------------------------------
+// Benchmarks
+
+void BM_CalculateEuclideanDistance(State& state)
+{
+    std::vector<FlowData> set = makeTrainingSet(1024, 8);
+    size_t i = 0;
+    while (state.keepRunning()) {
+        double d = flowFeatureDistance(set[i & 1023], set[(i + 1) & 1023]);
+        doNotOptimize(d);
+        i++;
+    }
+}
+BENCHMARK(BM_CalculateEuclideanDistance);
+
+void BM_PredictBestPath(State& state)
+{
+    std::vector<FlowData> set = makeTrainingSet(state.range(), 8);
+    std::vector<FlowData> queries = makeTrainingSet(64, 8);
+    size_t i = 0;
+    while (state.keepRunning()) {
+        int gate = knnPredict(set, queries[i++ & 63], 3);
+        doNotOptimize(gate);
+    }
+}
+BENCHMARK_ARGS(BM_PredictBestPath, "samples", 1000, 10000, 100000);
+
+// Online models: one prediction and one update per iteration, as in the
+// controller, after learning range() samples; the cost should not grow with it.
+void onlineDecision(State& state, const char *type)
+{
+    std::unique_ptr<FlowClassifier> model(createFlowClassifier(type, 8, 3, 0.1));
+    model->train(makeTrainingSet(state.range(), 8));
+    std::vector<FlowData> queries = makeTrainingSet(64, 8);
+    size_t i = 0;
+    while (state.keepRunning()) {
+        const FlowData& query = queries[i++ & 63];
+        int gate = model->predict(query);
+        model->learn(query);
+        doNotOptimize(gate);
+    }
+}
+
+void BM_LogisticDecision(State& state) { onlineDecision(state, "logistic"); }
+void BM_PerceptronDecision(State& state) { onlineDecision(state, "perceptron"); }
+void BM_HoeffdingDecision(State& state) { onlineDecision(state, "hoeffding"); }
+BENCHMARK_ARGS(BM_LogisticDecision, "samples", 1000, 10000, 100000);
+BENCHMARK_ARGS(BM_PerceptronDecision, "samples", 1000, 10000, 100000);
+BENCHMARK_ARGS(BM_HoeffdingDecision, "samples", 1000, 10000, 100000);
+
+void energyAwareDecision(State& state, double depletionWeight)
+{
+    int numGates = state.range();
+    std::map<int, NodeMetrics> db = makeNodeDatabase(numGates);
+    std::vector<int> gateNeighbors(numGates);
+    for (int i = 0; i < numGates; i++)
+        gateNeighbors[i] = i + 1;
+    EnergyWeights weights = defaultWeights();
+    weights.depletion = depletionWeight;
+
+    int preferred = 0;
+    while (state.keepRunning()) {
+        int gate = selectEnergyAwareGate(db, gateNeighbors, weights, preferred, 10.0);
+        doNotOptimize(gate);
+        preferred = (preferred + 1) % numGates;
+    }
+}
+
+// The second variant also scores the predicted time to depletion.
+void BM_SelectEnergyAwareGate(State& state) { energyAwareDecision(state, 0.0); }
+void BM_SelectEnergyAwareGateForecast(State& state) { energyAwareDecision(state, 1.0); }
+BENCHMARK_ARGS(BM_SelectEnergyAwareGate, "gates", 8, 32, 128, 512);
+BENCHMARK_ARGS(BM_SelectEnergyAwareGateForecast, "gates", 8, 32, 128, 512);
+
+// MLP inference (FLOW_FEATURES-32-16-8, random weights) of range() flows per
+// pass, with the AVX2 kernel and with the scalar one; divide by the batch
+// size for the time per flow.
+void mlpForward(State& state, bool simd)
+{
+    std::mt19937 rng = makeRng();
+    std::normal_distribution<float> weight(0.0f, 0.3f);
+    MlpNetwork network;
+    int sizes[] = { FLOW_FEATURES, 32, 16, 8 };
+    for (int k = 0; k < 3; k++) {
+        std::vector<float> weights(sizes[k] * sizes[k + 1]), biases(sizes[k + 1]);
+        for (float& w : weights)
+            w = weight(rng);
+        for (float& b : biases)
+            b = weight(rng);
+        network.addLayer(sizes[k], sizes[k + 1], k < 2, weights, biases);
+    }
+    network.setSimd(simd);
+
+    int batch = state.range();
+    std::vector<FlowData> flows = makeTrainingSet(64, 8);
+    std::vector<float> inputs(64 * FLOW_FEATURES);
+    for (int i = 0; i < 64; i++) {
+        double x[FLOW_FEATURES];
+        flowFeatures(flows[i], x);
+        std::copy_n(x, FLOW_FEATURES, &inputs[i * FLOW_FEATURES]);
+    }
+    std::vector<float> outputs(batch * 8);
+    size_t i = 0;
+    while (state.keepRunning()) {
+        network.forward(batch, &inputs[(i++ & 31) * FLOW_FEATURES], FLOW_FEATURES, outputs.data());
+        doNotOptimize(outputs[0]);
+    }
+}
+
+void BM_MlpForward(State& state) { mlpForward(state, true); }
+void BM_MlpForwardScalar(State& state) { mlpForward(state, false); }
+BENCHMARK_ARGS(BM_MlpForward, "batch", 1, 8, 32);
+BENCHMARK_ARGS(BM_MlpForwardScalar, "batch", 1, 8, 32);
+
+// Bandit routing: one gate selection and one reward update per packet.
+void BM_BanditDecision(State& state)
+{
+    int numGates = state.range();
+    LinUCBBandit bandit(numGates, 1.0);
+    std::vector<int> arms(numGates);
+    std::vector<double> contexts(numGates * BANDIT_FEATURES);
+    std::mt19937 rng = makeRng();
+    std::uniform_real_distribution<double> feature(0.0, 1.0);
+    for (int i = 0; i < numGates; i++)
+        arms[i] = i;
+    for (double& x : contexts)
+        x = feature(rng);
+
+    while (state.keepRunning()) {
+        int gate = bandit.select(numGates, arms.data(), contexts.data());
+        bandit.update(gate, &contexts[gate * BANDIT_FEATURES], -contexts[gate * BANDIT_FEATURES + 1]);
+        doNotOptimize(gate);
+    }
+}
+BENCHMARK_ARGS(BM_BanditDecision, "gates", 8, 32, 128, 512);
+
+// The controller flushes the dataset stream after every row, so the flushing
+// variant is the one that matches the simulation.
+void BM_ExportToDataset(State& state)
+{
+    bool flushEveryRow = state.range() != 0;
+    std::vector<FlowData> set = makeTrainingSet(1024, 8);
+    std::string fileName = "/tmp/controller_bench_" + std::to_string(getpid()) + ".csv";
+    std::ofstream out(fileName);
+    writeDatasetHeader(out);
+
+    size_t i = 0;
+    while (state.keepRunning()) {
+        writeDatasetRow(out, set[i++ & 1023]);
+        if (flushEveryRow)
+            out.flush();
+    }
+    out.close();
+    unlink(fileName.c_str());
+}
+BENCHMARK_ARGS(BM_ExportToDataset, "flush", 0, 1);
+
+// Per-packet route lookup in Routing (transit forwarding).
+void BM_RoutingTableLookup(State& state)
+{
+    int numNodes = state.range();
+    RoutingTable rtable;
+    std::mt19937 rng = makeRng();
+    std::uniform_int_distribution<int> gate(0, 3), dest(1, numNodes);
+    for (int addr = 1; addr <= numNodes; addr++)
+        rtable[addr] = gate(rng);
+
+    std::vector<int> dests(1024);
+    for (auto& d : dests)
+        d = dest(rng);
+
+    size_t i = 0;
+    while (state.keepRunning()) {
+        auto it = rtable.find(dests[i++ & 1023]);
+        int outGate = it != rtable.end() ? it->second : -1;
+        doNotOptimize(outGate);
+    }
+}
+BENCHMARK_ARGS(BM_RoutingTableLookup, "nodes", 8, 64, 512);
+
+//------------------------------------------------------------------------------
+// Runner
+
+Result runOne(const std::string& name, const std::function<void(State&)>& fn, long arg, double minTime)
+{
+    long iterations = 1;
+    while (true) {
+        State state(iterations, arg);
+        fn(state);
+        double real = state.realSeconds();
+        double cpu = state.cpuSecondsUsed();
+
+        if (real >= minTime || iterations >= 1000000000L)
+            return {name, iterations, real * 1e9 / iterations, cpu * 1e9 / iterations};
+
+        // same growth rule as Google Benchmark: aim for minTime, at most 10x per step
+        double multiplier = real > 0 ? std::min(10.0, minTime * 1.4 / real) : 10.0;
+        iterations = std::max(iterations + 1, (long)(iterations * multiplier));
+    }
+}
+
+std::string jsonEscape(const std::string& s)
+{
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+void writeJson(std::ostream& os, const std::vector<Result>& results)
+{
+    char date[64];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+    char host[256] = "";
+    gethostname(host, sizeof(host) - 1);
+
+    os << "{\n"
+       << "  \"context\": {\n"
+       << "    \"date\": \"" << date << "\",\n"
+       << "    \"host_name\": \"" << jsonEscape(host) << "\",\n"
+       << "    \"executable\": \"controller_bench\",\n"
+       << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+#ifdef NDEBUG
+       << "    \"library_build_type\": \"release\"\n"
+#else
+       << "    \"library_build_type\": \"debug\"\n"
+#endif
+       << "  },\n"
+       << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        os << "    {\n"
+           << "      \"name\": \"" << jsonEscape(r.name) << "\",\n"
+           << "      \"run_name\": \"" << jsonEscape(r.name) << "\",\n"
+           << "      \"run_type\": \"iteration\",\n"
+           << "      \"iterations\": " << r.iterations << ",\n"
+           << "      \"real_time\": " << r.realTimeNs << ",\n"
+           << "      \"cpu_time\": " << r.cpuTimeNs << ",\n"
+           << "      \"time_unit\": \"ns\"\n"
+           << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n}\n";
+}
+
+void writeConsole(std::ostream& os, const std::vector<Result>& results)
+{
+    char line[256];
+    snprintf(line, sizeof(line), "%-44s %14s %14s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+    os << line << std::string(87, '-') << "\n";
+    for (auto& r : results) {
+        snprintf(line, sizeof(line), "%-44s %11.1f ns %11.1f ns %12ld\n",
+                 r.name.c_str(), r.realTimeNs, r.cpuTimeNs, r.iterations);
+        os << line;
+    }
+}
+
+void usage()
+{
+    std::cerr <<
+        "Usage: controller_bench [options]\n"
+        "  --benchmark_filter=<regex>      run only matching benchmarks\n"
+        "  --benchmark_format=console|json output format on stdout\n"
+        "  --benchmark_out=<file>          also write JSON results to <file>\n"
+        "  --benchmark_min_time=<seconds>  minimum time per benchmark (default 0.5)\n"
+        "  --benchmark_list_tests          list benchmark names and exit\n";
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    std::string filter = ".", format = "console", outFile;
+    double minTime = 0.5;
+    bool listOnly = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&](const char *prefix) { return arg.substr(strlen(prefix)); };
+        if (arg.rfind("--benchmark_filter=", 0) == 0)
+            filter = value("--benchmark_filter=");
+        else if (arg.rfind("--benchmark_format=", 0) == 0)
+            format = value("--benchmark_format=");
+        else if (arg.rfind("--benchmark_out=", 0) == 0)
+            outFile = value("--benchmark_out=");
+        else if (arg.rfind("--benchmark_min_time=", 0) == 0)
+            minTime = atof(value("--benchmark_min_time=").c_str());
+        else if (arg == "--benchmark_list_tests")
+            listOnly = true;
+        else {
+            usage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    std::regex pattern(filter);
+    std::vector<Result> results;
+    for (auto& bm : registry()) {
+        std::vector<long> args = bm.args.empty() ? std::vector<long>{0} : bm.args;
+        for (long arg : args) {
+            std::string name = bm.name;
+            if (!bm.args.empty())
+                name += "/" + bm.argName + ":" + std::to_string(arg);
+            if (!std::regex_search(name, pattern))
+                continue;
+            if (listOnly) {
+                std::cout << name << "\n";
+                continue;
+            }
+            results.push_back(runOne(name, bm.fn, arg, minTime));
+            if (format != "json")
+                std::cerr << "  " << name << " done\n";
+        }
+    }
+    if (listOnly)
+        return 0;
+
+    if (format == "json")
+        writeJson(std::cout, results);
+    else
+        writeConsole(std::cout, results);
+
+    if (!outFile.empty()) {
+        std::ofstream out(outFile);
+        writeJson(out, results);
+    }
+    return 0;
+}
@@ -77,6 +77,12 @@ echo -e "${BLUE}Step 5: Analyzing results...${NC}"
 echo "Scalar results:"
 scavetool export -f results/*.sca -o results_summary.csv
 
+# AGGREGATE=1: also mean, CI and quantiles across repetitions (tools/result_aggregator)
+if [ "$AGGREGATE" = 1 ] && [ -x ../tools/result_aggregator ]; then
+    ../tools/result_aggregator -s -o results_aggregate.csv results
+    echo -e "${GREEN}✓ Aggregates written to results_aggregate.csv${NC}"
+fi
+
 if [ -f "results_summary.csv" ]; then
     echo -e "${GREEN}✓ Results exported to results_summary.csv${NC}"
 else
@@ -101,4 +107,4 @@ echo "Next steps:"
 echo "  1. View plots: open *.png"
 echo "  2. Analyze data: python3 analyze_results.py"
 echo "  3. Run comparison: ./routing2 -u Qtenv -c NetSDN_ML_Comparison"
-echo ""
\ No newline at end of file
+echo ""
\ No newline at end of file
@@ -14,6 +14,7 @@
 #include <vector>
 #include <omnetpp.h>
 #include "Packet_m.h"
+#include "HandlerProfiler.h"
 
 using namespace omnetpp;
 
@@ -44,6 +45,7 @@ class App : public cSimpleModule
   protected:
     virtual void initialize() override;
     virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
 };
 
 Define_Module(App);
@@ -55,6 +57,8 @@ App::~App()
 
 void App::initialize()
 {
+    PROFILE_HANDLER_INIT();
+
     myAddress = par("address");
     packetLengthBytes = &par("packetLength");
     sendIATime = &par("sendIaTime");  // volatile parameter
@@ -82,19 +86,22 @@ void App::initialize()
 
 void App::handleMessage(cMessage *msg)
 {
+    PROFILE_HANDLER(msg);
+
     if (msg == generatePacket) {
         // Sending packet
         int destAddress = destAddresses[intuniform(0, destAddresses.size()-1)];
 
         char pkname[40];
-        snprintf(pkname, sizeof(pkname), "pk-%d-to-%d-#%ld", myAddress, destAddress, pkCounter++);
-        EV << "generating packet " << pkname << endl;
+        snprintf(pkname, sizeof(pkname), "pk-%d-to-%d-#%ld", myAddress, destAddress, pkCounter);
+        EV_DEBUG << "generating packet " << pkname << endl;
 
         Packet *pk = new Packet(pkname);
         pk->setByteLength(packetLengthBytes->intValue());
         pk->setKind(intuniform(0, 7));
         pk->setSrcAddr(myAddress);
         pk->setDestAddr(destAddress);
+        pk->setSequenceNumber(pkCounter++);
         send(pk, "out");
 
         scheduleAt(simTime() + sendIATime->doubleValue(), generatePacket);
@@ -104,8 +111,8 @@ void App::handleMessage(cMessage *msg)
     else {
         // Handle incoming packet
         Packet *pk = check_and_cast<Packet *>(msg);
-        EV << "received packet " << pk->getName() << " after " << pk->getHopCount() << "hops" << endl;
-        emit(endToEndDelaySignal, simTime() - pk->getCreationTime());
+        EV_DEBUG << "received packet " << pk->getName() << " after " << pk->getHopCount() << "hops" << endl;
+        emit(endToEndDelaySignal, simTime() - pk->getCreationTime(), pk);  // pk: delivery feedback for bandit routing
         emit(hopCountSignal, pk->getHopCount());
         emit(sourceAddressSignal, pk->getSrcAddr());
         delete pk;
@@ -115,3 +122,8 @@ void App::handleMessage(cMessage *msg)
     }
 }
 
+void App::finish()
+{
+    PROFILE_HANDLER_FINISH();
+}
+
@@ -10,6 +10,7 @@
 #define FSM_DEBUG
 #include <omnetpp.h>
 #include "Packet_m.h"
+#include "HandlerProfiler.h"
 
 using namespace omnetpp;
 
@@ -54,6 +55,7 @@ class BurstyApp : public cSimpleModule
     // redefined cSimpleModule methods
     virtual void initialize() override;
     virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
     virtual void refreshDisplay() const override;
 
     // new methods
@@ -72,6 +74,8 @@ BurstyApp::~BurstyApp()
 
 void BurstyApp::initialize()
 {
+    PROFILE_HANDLER_INIT();
+
     numSent = numReceived = 0;
     WATCH(numSent);
     WATCH(numReceived);
@@ -99,6 +103,8 @@ void BurstyApp::initialize()
 
 void BurstyApp::handleMessage(cMessage *msg)
 {
+    PROFILE_HANDLER(msg);
+
     // process the self-message or incoming packet
     if (msg->isSelfMessage())
         processTimer(msg);
@@ -121,7 +127,7 @@ void BurstyApp::processTimer(cMessage *msg)
             scheduleAt(simTime() + d, startStopBurst);
 
             // display message, restore normal icon color
-            EV << "sleeping for " << d << "s\n";
+            EV_DETAIL << "sleeping for " << d << "s\n";
             bubble("burst ended, sleeping");
             getDisplayString().setTagArg("i", 1, "");
             break;
@@ -132,7 +138,7 @@ void BurstyApp::processTimer(cMessage *msg)
             scheduleAt(simTime() + d, startStopBurst);
 
             // display message, turn icon yellow
-            EV << "starting burst of duration " << d << "s\n";
+            EV_DETAIL << "starting burst of duration " << d << "s\n";
             bubble("burst started");
             getDisplayString().setTagArg("i", 1, "yellow");
 
@@ -145,7 +151,7 @@ void BurstyApp::processTimer(cMessage *msg)
         case FSM_Enter(ACTIVE):
             // schedule next sending
             d = sendIATime->doubleValue();
-            EV << "next sending in " << d << "s\n";
+            EV_DETAIL << "next sending in " << d << "s\n";
             scheduleAt(simTime() + d, sendMessage);
             break;
 
@@ -179,27 +185,33 @@ void BurstyApp::generatePacket()
     int destAddress = destAddresses[intuniform(0, destAddresses.size()-1)];
 
     char pkname[40];
-    snprintf(pkname, sizeof(pkname), "pk-%d-to-%d-#%d", myAddress, destAddress, pkCounter++);
-    EV << "generating packet " << pkname << endl;
+    snprintf(pkname, sizeof(pkname), "pk-%d-to-%d-#%d", myAddress, destAddress, pkCounter);
+    EV_DEBUG << "generating packet " << pkname << endl;
 
     Packet *pk = new Packet(pkname);
     pk->setByteLength(packetLengthBytes->intValue());
     pk->setSrcAddr(myAddress);
     pk->setDestAddr(destAddress);
+    pk->setSequenceNumber(pkCounter++);
     send(pk, "out");
 }
 
 void BurstyApp::processPacket(Packet *pk)
 {
     // update statistics and delete message
-    EV << "received packet " << pk->getName() << " after " << pk->getHopCount() << "hops" << endl;
-    emit(endToEndDelaySignal, simTime() - pk->getCreationTime());
+    EV_DEBUG << "received packet " << pk->getName() << " after " << pk->getHopCount() << "hops" << endl;
+    emit(endToEndDelaySignal, simTime() - pk->getCreationTime(), pk);  // pk: delivery feedback for bandit routing
     emit(hopCountSignal, pk->getHopCount());
     emit(sourceAddressSignal, pk->getSrcAddr());
     numReceived++;
     delete pk;
 }
 
+void BurstyApp::finish()
+{
+    PROFILE_HANDLER_FINISH();
+}
+
 void BurstyApp::refreshDisplay() const
 {
     // update status string above icon
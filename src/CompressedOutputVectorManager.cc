@@ -0,0 +1,260 @@
+//
+// Output vector manager writing the compressed .vecz format (see VectorCodec.h)
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <omnetpp.h>
+#include "VectorCodec.h"
+
+using namespace omnetpp;
+
+Register_PerRunConfigOption(CFGID_COMPRESSED_VECTOR_FILE, "compressed-vector-file", CFG_FILENAME, "${resultdir}/${configname}-${iterationvarsf}#${repetition}.vecz", "Name of the file written by CompressedOutputVectorManager.");
+Register_PerRunConfigOption(CFGID_COMPRESSED_VECTOR_BLOCK_SIZE, "compressed-vector-block-size", CFG_INT, "1024", "Number of samples CompressedOutputVectorManager buffers per vector before compressing them into a block.");
+
+/**
+ * Drop-in replacement of the default output vector manager
+ * (outputvectormanager-class = "CompressedOutputVectorManager").
+ *
+ * Samples are buffered per vector and written as Gorilla-compressed blocks
+ * of compressed-vector-block-size samples; the file ends with an index of
+ * all blocks. Like the default manager it honours vector-recording and
+ * opens the file only when the first sample arrives. tools/vecz2vec turns
+ * the result back into a standard .vec file.
+ */
+class CompressedOutputVectorManager : public cIOutputVectorManager
+{
+  protected:
+    struct Vector {
+        int id = -1;            // assigned when the first sample is written
+        std::string module;
+        std::string name;
+        opp_string_map attributes;
+        bool enabled = true;
+        std::vector<VectorSample> buffer;
+    };
+
+    std::string fileName;
+    FILE *f = nullptr;
+    bool runActive = false;
+    uint64_t fileOffset = 0;
+    size_t blockSize = 1024;
+    int nextVectorId = 0;
+    std::vector<Vector *> vectors;      // all registered vectors, for flush()
+    std::vector<VectorBlockInfo> index;
+
+  protected:
+    void startRun();
+    void endRun();
+    void openFile();
+    void closeFile();
+    void writeRecord(char tag, const std::string& payload);
+    void writeBlock(Vector *vector);
+
+  public:
+    virtual ~CompressedOutputVectorManager();
+
+    virtual void lifecycleEvent(SimulationLifecycleEventType eventType, cObject *details) override;
+    virtual void *registerVector(const char *componentFullPath, const char *name, opp_string_map *attributes = nullptr) override;
+    virtual void deregisterVector(void *vechandle) override;
+    virtual bool record(void *vechandle, simtime_t t, double value) override;
+    virtual const char *getFileName() const override { return fileName.c_str(); }
+    virtual void flush() override;
+};
+
+Register_Class(CompressedOutputVectorManager);
+
+CompressedOutputVectorManager::~CompressedOutputVectorManager()
+{
+    closeFile();
+    for (Vector *vector : vectors)
+        delete vector;
+}
+
+void CompressedOutputVectorManager::lifecycleEvent(SimulationLifecycleEventType eventType, cObject *details)
+{
+    switch (eventType) {
+        case LF_PRE_NETWORK_INITIALIZE: startRun(); break;
+        case LF_ON_RUN_END: case LF_ON_SIMULATION_ERROR: endRun(); break;
+        default: break;
+    }
+}
+
+void CompressedOutputVectorManager::startRun()
+{
+    // vectors of the network are registered before this point, keep them
+    closeFile();
+    index.clear();
+    nextVectorId = 0;
+    for (Vector *vector : vectors) {
+        vector->id = -1;
+        vector->buffer.clear();
+    }
+
+    cConfiguration *cfg = getEnvir()->getConfig();
+    fileName = cfg->getAsFilename(CFGID_COMPRESSED_VECTOR_FILE);
+    blockSize = std::max((intval_t)1, cfg->getAsInt(CFGID_COMPRESSED_VECTOR_BLOCK_SIZE));
+    remove(fileName.c_str());
+    runActive = true;
+}
+
+void CompressedOutputVectorManager::endRun()
+{
+    if (!runActive)
+        return;
+    flush();
+    runActive = false;
+    if (!f)
+        return;
+
+    uint64_t indexOffset = fileOffset;
+    std::string payload;
+    putVarint(payload, index.size());
+    for (const VectorBlockInfo& info : index)
+        putBlockInfo(payload, info);
+    writeRecord(VECZ_INDEX, payload);
+
+    std::string trailer;
+    for (int i = 0; i < 8; i++)
+        trailer += (char)(indexOffset >> (8 * i));
+    trailer += VECZ_MAGIC;
+    fwrite(trailer.data(), 1, trailer.size(), f);
+    closeFile();
+}
+
+void CompressedOutputVectorManager::openFile()
+{
+    // create the result directory like the default managers do
+    for (size_t slash = fileName.find('/', 1); slash != std::string::npos; slash = fileName.find('/', slash + 1)) {
+#ifdef _WIN32
+        mkdir(fileName.substr(0, slash).c_str());
+#else
+        mkdir(fileName.substr(0, slash).c_str(), 0755);
+#endif
+    }
+    f = fopen(fileName.c_str(), "wb");
+    if (!f)
+        throw cRuntimeError("CompressedOutputVectorManager: Cannot open output file '%s'", fileName.c_str());
+    setvbuf(f, nullptr, _IOFBF, 1 << 16);
+
+    std::string header = VECZ_MAGIC;
+    header += (char)VECZ_VERSION;
+    header += (char)SimTime::getScaleExp();
+    fwrite(header.data(), 1, header.size(), f);
+    fileOffset = header.size();
+
+    cConfigurationEx *cfg = getEnvir()->getConfigEx();
+    for (const char *name : cfg->getPredefinedVariableNames()) {
+        std::string payload;
+        putString(payload, name);
+        putString(payload, cfg->getVariable(name));
+        writeRecord(VECZ_RUN_ATTR, payload);
+    }
+    for (const char *name : cfg->getIterationVariableNames()) {
+        std::string payload;
+        putString(payload, name);
+        putString(payload, cfg->getVariable(name));
+        writeRecord(VECZ_ITERVAR, payload);
+    }
+}
+
+void CompressedOutputVectorManager::closeFile()
+{
+    if (f)
+        fclose(f);
+    f = nullptr;
+}
+
+void CompressedOutputVectorManager::writeRecord(char tag, const std::string& payload)
+{
+    std::string header(1, tag);
+    putVarint(header, payload.size());
+    fwrite(header.data(), 1, header.size(), f);
+    fwrite(payload.data(), 1, payload.size(), f);
+    fileOffset += header.size() + payload.size();
+}
+
+void CompressedOutputVectorManager::writeBlock(Vector *vector)
+{
+    if (vector->buffer.empty())
+        return;
+    if (!f)
+        openFile();
+
+    if (vector->id < 0) {
+        // declared lazily, so vectors without samples do not appear at all
+        vector->id = nextVectorId++;
+        std::string payload;
+        putVarint(payload, vector->id);
+        putString(payload, vector->module);
+        putString(payload, vector->name);
+        putVarint(payload, vector->attributes.size());
+        for (auto& attr : vector->attributes) {
+            putString(payload, attr.first.c_str());
+            putString(payload, attr.second.c_str());
+        }
+        writeRecord(VECZ_VECTOR, payload);
+    }
+
+    VectorBlockInfo info = summarizeSamples(vector->id, vector->buffer);
+    info.offset = fileOffset;
+    std::string payload;
+    putBlockInfo(payload, info);
+    encodeSamples(vector->buffer, payload);
+    writeRecord(VECZ_BLOCK, payload);
+
+    index.push_back(info);
+    vector->buffer.clear();
+}
+
+void *CompressedOutputVectorManager::registerVector(const char *componentFullPath, const char *name, opp_string_map *attributes)
+{
+    Vector *vector = new Vector();
+    vector->module = componentFullPath;
+    vector->name = name;
+    if (attributes)
+        vector->attributes = *attributes;
+
+    static cConfigOption *vectorRecording = cConfigOption::find("vector-recording");
+    if (vectorRecording) {
+        std::string vectorFullPath = vector->module + "." + vector->name;
+        vector->enabled = getEnvir()->getConfigEx()->getAsBool(vectorFullPath.c_str(), vectorRecording, true);
+    }
+    vectors.push_back(vector);
+    return vector;
+}
+
+void CompressedOutputVectorManager::deregisterVector(void *vechandle)
+{
+    Vector *vector = (Vector *)vechandle;
+    if (runActive)
+        writeBlock(vector);
+    vectors.erase(std::find(vectors.begin(), vectors.end(), vector));
+    delete vector;
+}
+
+bool CompressedOutputVectorManager::record(void *vechandle, simtime_t t, double value)
+{
+    Vector *vector = (Vector *)vechandle;
+    if (!vector->enabled)
+        return false;
+
+    vector->buffer.push_back({getSimulation()->getEventNumber(), t.raw(), value});
+    if (vector->buffer.size() >= blockSize)
+        writeBlock(vector);
+    return true;
+}
+
+void CompressedOutputVectorManager::flush()
+{
+    if (!runActive)
+        return;
+    for (Vector *vector : vectors)
+        writeBlock(vector);
+    if (f)
+        fflush(f);
+}
@@ -0,0 +1,90 @@
+//
+// Contextual-bandit gate selection of the SDN controller (see ContextualBandit.h)
+//
+
+#include <algorithm>
+#include <cmath>
+#include "ContextualBandit.h"
+
+static const int D = BANDIT_FEATURES;
+
+LinUCBBandit::LinUCBBandit(int numArms, double alpha)
+    : numArms(numArms), alpha(alpha), aInverse(numArms * D * D, 0.0),
+      b(numArms * D, 0.0), theta(numArms * D, 0.0), updates(numArms, 0)
+{
+    // A starts as the identity (ridge regularization), and so does its inverse
+    for (int arm = 0; arm < numArms; arm++)
+        for (int i = 0; i < D; i++)
+            aInverse[arm * D * D + i * D + i] = 1.0;
+}
+
+double LinUCBBandit::score(int arm, const double *x) const
+{
+    const double *ai = &aInverse[arm * D * D];
+    const double *t = &theta[arm * D];
+    double mean = 0, variance = 0;
+    for (int i = 0; i < D; i++) {
+        mean += t[i] * x[i];
+        double row = 0;
+        for (int j = 0; j < D; j++)
+            row += ai[i * D + j] * x[j];
+        variance += x[i] * row;
+    }
+    return mean + alpha * std::sqrt(std::max(variance, 0.0));
+}
+
+int LinUCBBandit::select(int numCandidates, const int *arms, const double *contexts, double *scoreMargin) const
+{
+    int best = -1;
+    double bestScore = -INFINITY, runnerUpScore = -INFINITY;
+    for (int i = 0; i < numCandidates; i++) {
+        double s = score(arms[i], contexts + i * D);
+        if (s > bestScore) {
+            runnerUpScore = bestScore;
+            bestScore = s;
+            best = arms[i];
+        }
+        else if (s > runnerUpScore) {
+            runnerUpScore = s;
+        }
+    }
+    if (scoreMargin)
+        *scoreMargin = numCandidates >= 2 ? bestScore - runnerUpScore : NAN;
+    return best;
+}
+
+void LinUCBBandit::update(int arm, const double *x, double reward)
+{
+    double *ai = &aInverse[arm * D * D];
+    double *bArm = &b[arm * D];
+    double *t = &theta[arm * D];
+
+    // Sherman-Morrison: (A + x x')^-1 = A^-1 - (A^-1 x)(x' A^-1) / (1 + x' A^-1 x);
+    // A^-1 stays symmetric, so x' A^-1 is the transpose of A^-1 x
+    double u[D];
+    double denominator = 1.0;
+    for (int i = 0; i < D; i++) {
+        u[i] = 0;
+        for (int j = 0; j < D; j++)
+            u[i] += ai[i * D + j] * x[j];
+        denominator += x[i] * u[i];
+    }
+    for (int i = 0; i < D; i++)
+        for (int j = 0; j < D; j++)
+            ai[i * D + j] -= u[i] * u[j] / denominator;
+
+    for (int i = 0; i < D; i++)
+        bArm[i] += reward * x[i];
+    for (int i = 0; i < D; i++) {
+        t[i] = 0;
+        for (int j = 0; j < D; j++)
+            t[i] += ai[i * D + j] * bArm[j];
+    }
+    updates[arm]++;
+}
+
+size_t LinUCBBandit::getMemoryBytes() const
+{
+    return sizeof(*this) + (aInverse.capacity() + b.capacity() + theta.capacity()) * sizeof(double)
+           + updates.capacity() * sizeof(long);
+}
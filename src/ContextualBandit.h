@@ -0,0 +1,55 @@
+//
+// Contextual-bandit gate selection of the SDN controller (LinUCB), kept
+// free of the simulation kernel like SDNRoutingCore.
+//
+
+#ifndef __CONTEXTUALBANDIT_H
+#define __CONTEXTUALBANDIT_H
+
+#include <cstddef>
+#include <vector>
+
+// Context of one arm (gate): see SDNController_ML::banditContext()
+#define BANDIT_FEATURES 8
+
+/**
+ * LinUCB with disjoint linear models: every arm keeps A^-1 and b of a ridge
+ * regression from its context to the observed reward and is scored by the
+ * upper confidence bound theta.x + alpha * sqrt(x' A^-1 x). A^-1 is updated
+ * in place with the Sherman-Morrison formula, so selecting among g arms costs
+ * O(g * d^2) and an update O(d^2) for d = BANDIT_FEATURES, independent of
+ * the number of decisions seen.
+ */
+class LinUCBBandit
+{
+  private:
+    int numArms;
+    double alpha;
+    std::vector<double> aInverse;   // numArms matrices of d x d, row-major
+    std::vector<double> b;          // numArms vectors of d
+    std::vector<double> theta;      // A^-1 b per arm
+    std::vector<long> updates;      // per arm
+
+  public:
+    LinUCBBandit(int numArms, double alpha);
+
+    /** Upper confidence bound of the reward of arm for context x. */
+    double score(int arm, const double *x) const;
+
+    /**
+     * Returns the arm with the highest score among arms[0..numCandidates),
+     * whose contexts are contexts[i * BANDIT_FEATURES ...]; ties go to the
+     * first candidate. scoreMargin, if given, receives best minus runner-up
+     * (NaN with fewer than two candidates). Returns -1 without candidates.
+     */
+    int select(int numCandidates, const int *arms, const double *contexts, double *scoreMargin = nullptr) const;
+
+    /** Learns the reward observed after choosing arm in context x. */
+    void update(int arm, const double *x, double reward);
+
+    int getNumArms() const { return numArms; }
+    long getUpdates(int arm) const { return updates[arm]; }
+    size_t getMemoryBytes() const;
+};
+
+#endif
@@ -0,0 +1,122 @@
+//
+// Binary snapshot of the SDN controller state (see ControllerSnapshot.h)
+//
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include "ControllerSnapshot.h"
+
+void saveControllerSnapshot(const std::string& fileName, const ControllerState& state)
+{
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, 4);
+    header.version = SNAPSHOT_VERSION;
+    header.nodeMetricsSize = sizeof(NodeMetrics);
+    header.flowDataSize = sizeof(FlowData);
+    header.savedAt = state.savedAt;
+    header.totalFlowsProcessed = state.totalFlowsProcessed;
+    header.modelTrained = state.modelTrained;
+    header.modelK = state.modelK;
+    header.numNodes = state.nodeDatabase->size();
+    header.numDatasetRows = state.trainingDataset->size();
+    header.numModelSamples = state.modelTrainingSet->size();
+    header.numModelParams = state.modelParameters->size();
+    strncpy(header.modelType, state.modelType.c_str(), sizeof(header.modelType) - 1);
+
+    std::string tmpName = fileName + ".tmp";
+    std::unique_ptr<FILE, int (*)(FILE *)> f(fopen(tmpName.c_str(), "wb"), fclose);
+    if (!f)
+        throw std::runtime_error("cannot open '" + tmpName + "' for writing: " + strerror(errno));
+
+    bool ok = fwrite(&header, sizeof(header), 1, f.get()) == 1;
+    for (auto& entry : *state.nodeDatabase)
+        ok = ok && fwrite(&entry.second, sizeof(NodeMetrics), 1, f.get()) == 1;
+    const std::vector<FlowData>& dataset = *state.trainingDataset;
+    const std::vector<FlowData>& model = *state.modelTrainingSet;
+    ok = ok && fwrite(dataset.data(), sizeof(FlowData), dataset.size(), f.get()) == dataset.size();
+    ok = ok && fwrite(model.data(), sizeof(FlowData), model.size(), f.get()) == model.size();
+    const std::vector<double>& params = *state.modelParameters;
+    ok = ok && fwrite(params.data(), sizeof(double), params.size(), f.get()) == params.size();
+    ok = fclose(f.release()) == 0 && ok;
+    if (!ok || rename(tmpName.c_str(), fileName.c_str()) != 0) {
+        remove(tmpName.c_str());
+        throw std::runtime_error("cannot write '" + fileName + "'");
+    }
+}
+
+MappedSnapshot::MappedSnapshot(const std::string& fileName)
+{
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("cannot open '" + fileName + "': " + strerror(errno));
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        throw std::runtime_error("'" + fileName + "' is not a controller snapshot");
+    }
+    size = st.st_size;
+    data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        data = nullptr;
+        throw std::runtime_error("cannot map '" + fileName + "': " + strerror(errno));
+    }
+
+    header = (const SnapshotHeader *)data;
+    std::string error;
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, 4) != 0)
+        error = "is not a controller snapshot";
+    else if (header->version != SNAPSHOT_VERSION)
+        error = "has snapshot version " + std::to_string(header->version) + ", expected " + std::to_string(SNAPSHOT_VERSION);
+    else if (header->nodeMetricsSize != sizeof(NodeMetrics) || header->flowDataSize != sizeof(FlowData))
+        error = "was written by a build with a different NodeMetrics/FlowData layout";
+    else if (size != sizeof(SnapshotHeader) + header->numNodes * sizeof(NodeMetrics)
+                     + (header->numDatasetRows + header->numModelSamples) * sizeof(FlowData)
+                     + header->numModelParams * sizeof(double))
+        error = "is truncated or corrupt";
+    if (!error.empty()) {
+        munmap(data, size);
+        data = nullptr;
+        throw std::runtime_error("'" + fileName + "' " + error);
+    }
+}
+
+MappedSnapshot::~MappedSnapshot()
+{
+    if (data)
+        munmap(data, size);
+}
+
+const NodeMetrics *MappedSnapshot::getNodes() const
+{
+    return (const NodeMetrics *)(header + 1);
+}
+
+const FlowData *MappedSnapshot::getDatasetRows() const
+{
+    return (const FlowData *)(getNodes() + header->numNodes);
+}
+
+const FlowData *MappedSnapshot::getModelSamples() const
+{
+    return getDatasetRows() + header->numDatasetRows;
+}
+
+const double *MappedSnapshot::getModelParameters() const
+{
+    return (const double *)(getModelSamples() + header->numModelSamples);
+}
+
+std::string MappedSnapshot::getModelType() const
+{
+    return std::string(header->modelType, strnlen(header->modelType, sizeof(header->modelType)));
+}
@@ -0,0 +1,89 @@
+//
+// Versioned binary snapshot of the SDN controller state, kept free of the
+// simulation kernel.
+//
+// A snapshot is a SnapshotHeader followed by four arrays in native byte
+// order: the node database (NodeMetrics), the training dataset and the
+// training set of the ML model (FlowData), and the parameters of an online
+// ML model (double). The header records the struct
+// sizes, so a snapshot from a build with another layout is rejected instead
+// of being misread.
+//
+
+#ifndef __CONTROLLERSNAPSHOT_H
+#define __CONTROLLERSNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "SDNRoutingCore.h"
+
+// Bump the version with every change of the layout, NodeMetrics or FlowData:
+// 1 first layout, 2 NodeMetrics with the battery forecast, 3 online model parameters
+#define SNAPSHOT_MAGIC      "SDNS"
+#define SNAPSHOT_VERSION    3
+
+struct SnapshotHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t nodeMetricsSize;   // sizeof(NodeMetrics)
+    uint32_t flowDataSize;      // sizeof(FlowData)
+    double savedAt;             // simulation time of the snapshot [s]
+    uint64_t totalFlowsProcessed;
+    int32_t modelTrained;
+    int32_t modelK;
+    uint64_t numNodes;
+    uint64_t numDatasetRows;
+    uint64_t numModelSamples;
+    uint64_t numModelParams;
+    char modelType[16];         // FlowClassifier::getName(), zero-padded
+};
+
+/** Controller state to be saved; the containers are referenced, not copied. */
+struct ControllerState {
+    double savedAt = 0;
+    uint64_t totalFlowsProcessed = 0;
+    bool modelTrained = false;
+    int modelK = 0;
+    const std::map<int, NodeMetrics> *nodeDatabase = nullptr;
+    const std::vector<FlowData> *trainingDataset = nullptr;
+    const std::vector<FlowData> *modelTrainingSet = nullptr;
+    std::string modelType;
+    const std::vector<double> *modelParameters = nullptr;
+};
+
+/**
+ * Writes the state to fileName.tmp and renames it, so that a crash while
+ * saving never leaves a truncated snapshot behind. Throws std::runtime_error.
+ */
+void saveControllerSnapshot(const std::string& fileName, const ControllerState& state);
+
+/**
+ * Read-only memory mapping of a snapshot. The arrays point into the mapping
+ * and are valid while the object lives. Throws std::runtime_error if the file
+ * cannot be mapped or is not a compatible snapshot.
+ */
+class MappedSnapshot
+{
+  private:
+    void *data = nullptr;
+    size_t size = 0;
+    const SnapshotHeader *header = nullptr;
+
+  public:
+    explicit MappedSnapshot(const std::string& fileName);
+    ~MappedSnapshot();
+    MappedSnapshot(const MappedSnapshot&) = delete;
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+    const SnapshotHeader& getHeader() const { return *header; }
+    const NodeMetrics *getNodes() const;
+    const FlowData *getDatasetRows() const;
+    const FlowData *getModelSamples() const;
+    const double *getModelParameters() const;
+    std::string getModelType() const;
+};
+
+#endif
@@ -0,0 +1,66 @@
+//
+// Binary ring-buffer trace of routing decisions (see DecisionTrace.h)
+//
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include "DecisionTrace.h"
+
+void DecisionTrace::resize(size_t capacity)
+{
+    size_t size = 0;
+    if (capacity > 0)
+        for (size = 1; size < capacity; size <<= 1)
+            ;
+    ring.assign(size, DecisionRecord());
+    mask = size ? size - 1 : 0;
+    total = 0;
+}
+
+std::vector<DecisionRecord> DecisionTrace::getRecords() const
+{
+    std::vector<DecisionRecord> records;
+    uint64_t first = total > ring.size() ? total - ring.size() : 0;
+    records.reserve(total - first);
+    for (uint64_t i = first; i < total; i++)
+        records.push_back(ring[i & mask]);
+    return records;
+}
+
+void DecisionTrace::save(const std::string& fileName) const
+{
+    std::unique_ptr<FILE, int (*)(FILE *)> f(fopen(fileName.c_str(), "wb"), fclose);
+    if (!f)
+        throw std::runtime_error("cannot open '" + fileName + "' for writing");
+
+    DecisionTraceHeader header;
+    memcpy(header.magic, DTRC_MAGIC, 4);
+    header.version = DTRC_VERSION;
+    header.recordSize = sizeof(DecisionRecord);
+    header.capacity = ring.size();
+    header.totalRecorded = total;
+
+    std::vector<DecisionRecord> records = getRecords();
+    if (fwrite(&header, sizeof(header), 1, f.get()) != 1
+            || fwrite(records.data(), sizeof(DecisionRecord), records.size(), f.get()) != records.size())
+        throw std::runtime_error("cannot write '" + fileName + "'");
+}
+
+std::vector<DecisionRecord> DecisionTrace::load(const std::string& fileName, DecisionTraceHeader& header)
+{
+    std::unique_ptr<FILE, int (*)(FILE *)> f(fopen(fileName.c_str(), "rb"), fclose);
+    if (!f)
+        throw std::runtime_error("cannot open '" + fileName + "'");
+    if (fread(&header, sizeof(header), 1, f.get()) != 1 || memcmp(header.magic, DTRC_MAGIC, 4) != 0)
+        throw std::runtime_error("'" + fileName + "' is not a decision trace");
+    if (header.version != DTRC_VERSION || header.recordSize != sizeof(DecisionRecord))
+        throw std::runtime_error("'" + fileName + "' has an unsupported version or record layout");
+
+    uint64_t count = header.totalRecorded < header.capacity ? header.totalRecorded : header.capacity;
+    std::vector<DecisionRecord> records(count);
+    if (fread(records.data(), sizeof(DecisionRecord), count, f.get()) != count)
+        throw std::runtime_error("'" + fileName + "' is truncated");
+    return records;
+}
@@ -0,0 +1,93 @@
+//
+// Binary ring-buffer trace of routing decisions, kept free of the simulation
+// kernel so that the decoder in tools/ can share it.
+//
+// A .dtrc file is a DecisionTraceHeader followed by the retained records,
+// oldest first, in native byte order.
+//
+
+#ifndef __DECISIONTRACE_H
+#define __DECISIONTRACE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define DTRC_MAGIC      "DTRC"
+#define DTRC_VERSION    2
+
+// DecisionRecord::flags
+enum DecisionFlags {
+    DECISION_FALLBACK = 1,  // policy gave no valid gate, fell back to findGateToDestination()
+    DECISION_BACKBONE = 2,  // destination in another domain, sent over the backbone
+    DECISION_DROPPED = 4,   // no valid gate at all
+    DECISION_REPLAYED = 8,  // gate taken from a replayed decision log
+};
+
+/**
+ * One routing decision of the controller. The policy is the controller's
+ * DecisionPolicy (0 traditional, 1 energyAware, 2 ml, 3 mlEnergyAware, 4 bandit,
+ * 5 replay).
+ */
+struct DecisionRecord {
+    double time;            // simulation time [s]
+    uint64_t sequence;      // number of the data packet at its source app
+    int32_t srcAddr;
+    int32_t destAddr;
+    float scoreMargin;      // best minus runner-up energy score or bandit bound; NaN if not scored
+    int16_t mlPrediction;   // gate predicted by the ML model, -1 if not used
+    int16_t chosenGate;     // -1 if dropped
+    uint8_t policy;
+    uint8_t flags;          // DecisionFlags
+    uint8_t reserved[6];
+};
+
+static_assert(sizeof(DecisionRecord) == 40, "DecisionRecord layout is part of the file format");
+
+struct DecisionTraceHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t capacity;
+    uint64_t totalRecorded; // records beyond capacity were overwritten
+};
+
+/**
+ * Fixed-size ring of the most recent decisions. Recording is a single
+ * struct copy into preallocated memory; nothing is formatted until the
+ * trace is saved.
+ */
+class DecisionTrace
+{
+  private:
+    std::vector<DecisionRecord> ring;
+    uint64_t mask = 0;
+    uint64_t total = 0;
+
+  public:
+    /** Capacity is rounded up to a power of two; 0 disables the trace. */
+    explicit DecisionTrace(size_t capacity = 0) { resize(capacity); }
+
+    void resize(size_t capacity);
+    bool isEnabled() const { return !ring.empty(); }
+
+    void record(const DecisionRecord& r) {
+        if (!ring.empty())
+            ring[total++ & mask] = r;
+    }
+
+    size_t getCapacity() const { return ring.size(); }
+    uint64_t getTotalRecorded() const { return total; }
+    size_t getMemoryBytes() const { return ring.capacity() * sizeof(DecisionRecord); }
+
+    /** The retained records, oldest first. */
+    std::vector<DecisionRecord> getRecords() const;
+
+    /** Writes the trace as a .dtrc file; throws std::runtime_error on failure. */
+    void save(const std::string& fileName) const;
+
+    /** Reads a .dtrc file; throws std::runtime_error on failure. */
+    static std::vector<DecisionRecord> load(const std::string& fileName, DecisionTraceHeader& header);
+};
+
+#endif
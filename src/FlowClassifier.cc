@@ -0,0 +1,592 @@
+//
+// Routing-decision classifiers of the SDN controller (see FlowClassifier.h)
+//
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "FlowClassifier.h"
+
+void flowFeatures(const FlowData& flow, double *x)
+{
+    std::fill(x, x + FLOW_FEATURES, 0.0);
+    x[0] = 1.0;
+    x[1] = flow.srcBattery / 100.0;
+    x[2] = flow.destBattery / 100.0;
+    x[3] = flow.pathDistance / 100.0;
+    int bucket = flow.destAddr % FLOW_DEST_BUCKETS;
+    x[4 + (bucket < 0 ? bucket + FLOW_DEST_BUCKETS : bucket)] = 1.0;
+}
+
+void FlowClassifier::train(const std::vector<FlowData>& samples)
+{
+    for (const FlowData& sample : samples)
+        learn(sample);
+}
+
+void FlowClassifier::predictBatch(int n, const FlowData *queries, int *gates) const
+{
+    for (int i = 0; i < n; i++)
+        gates[i] = predict(queries[i]);
+}
+
+void FlowClassifier::setParameters(const double *, size_t n)
+{
+    if (n > 0)
+        throw std::runtime_error(std::string("the ") + getName() + " model has no parameters to restore");
+}
+
+// Parameters of the linear models: the number of samples, then the weights
+static std::vector<double> linearParameters(size_t numSamples, const std::vector<double>& weights)
+{
+    std::vector<double> params;
+    params.reserve(1 + weights.size());
+    params.push_back(numSamples);
+    params.insert(params.end(), weights.begin(), weights.end());
+    return params;
+}
+
+static void setLinearParameters(const char *model, const double *params, size_t n, size_t& numSamples,
+                                std::vector<double>& weights)
+{
+    if (n != 1 + weights.size())
+        throw std::runtime_error(std::string("the saved ") + model + " model has " + std::to_string(n)
+                                 + " parameters instead of " + std::to_string(1 + weights.size())
+                                 + " (different number of gates?)");
+    numSamples = params[0];
+    std::copy_n(params + 1, weights.size(), weights.begin());
+}
+
+//------------------------------------------------------------------------------
+
+void KnnClassifier::train(const std::vector<FlowData>& samples)
+{
+    this->samples = samples;
+    numSamples = samples.size();
+}
+
+int KnnClassifier::predict(const FlowData& query) const
+{
+    return samples.empty() ? -1 : knnPredict(samples, query, k);
+}
+
+size_t KnnClassifier::getMemoryBytes() const
+{
+    return sizeof(*this) + samples.capacity() * sizeof(FlowData);
+}
+
+//------------------------------------------------------------------------------
+
+LogisticClassifier::LogisticClassifier(int numClasses, double learningRate)
+    : FlowClassifier(numClasses), learningRate(learningRate), weights(numClasses * FLOW_FEATURES, 0.0)
+{
+}
+
+void LogisticClassifier::learn(const FlowData& sample)
+{
+    int label = sample.chosenPath;
+    if (label < 0 || label >= numClasses)
+        return;
+    numSamples++;
+
+    double x[FLOW_FEATURES];
+    flowFeatures(sample, x);
+
+    // softmax of the class scores
+    std::vector<double> p(numClasses);
+    double maxScore = -INFINITY;
+    for (int c = 0; c < numClasses; c++) {
+        const double *w = &weights[c * FLOW_FEATURES];
+        double score = 0;
+        for (int f = 0; f < FLOW_FEATURES; f++)
+            score += w[f] * x[f];
+        p[c] = score;
+        maxScore = std::max(maxScore, score);
+    }
+    double sum = 0;
+    for (int c = 0; c < numClasses; c++)
+        sum += p[c] = std::exp(p[c] - maxScore);
+
+    // gradient of the cross-entropy: (p - onehot(label)) x
+    for (int c = 0; c < numClasses; c++) {
+        double g = learningRate * (p[c] / sum - (c == label ? 1.0 : 0.0));
+        double *w = &weights[c * FLOW_FEATURES];
+        for (int f = 0; f < FLOW_FEATURES; f++)
+            w[f] -= g * x[f];
+    }
+}
+
+int LogisticClassifier::predict(const FlowData& query) const
+{
+    if (numSamples == 0)
+        return -1;
+
+    double x[FLOW_FEATURES];
+    flowFeatures(query, x);
+    int best = -1;
+    double bestScore = -INFINITY;
+    for (int c = 0; c < numClasses; c++) {
+        const double *w = &weights[c * FLOW_FEATURES];
+        double score = 0;
+        for (int f = 0; f < FLOW_FEATURES; f++)
+            score += w[f] * x[f];
+        if (score > bestScore) {
+            bestScore = score;
+            best = c;
+        }
+    }
+    return best;
+}
+
+size_t LogisticClassifier::getMemoryBytes() const
+{
+    return sizeof(*this) + weights.capacity() * sizeof(double);
+}
+
+std::vector<double> LogisticClassifier::getParameters() const
+{
+    return linearParameters(numSamples, weights);
+}
+
+void LogisticClassifier::setParameters(const double *params, size_t n)
+{
+    setLinearParameters(getName(), params, n, numSamples, weights);
+}
+
+//------------------------------------------------------------------------------
+
+PerceptronClassifier::PerceptronClassifier(int numClasses)
+    : FlowClassifier(numClasses), weights(numClasses * FLOW_FEATURES, 0.0)
+{
+}
+
+int PerceptronClassifier::argmax(const double *x) const
+{
+    int best = 0;
+    double bestScore = -INFINITY;
+    for (int c = 0; c < numClasses; c++) {
+        const double *w = &weights[c * FLOW_FEATURES];
+        double score = 0;
+        for (int f = 0; f < FLOW_FEATURES; f++)
+            score += w[f] * x[f];
+        if (score > bestScore) {
+            bestScore = score;
+            best = c;
+        }
+    }
+    return best;
+}
+
+void PerceptronClassifier::learn(const FlowData& sample)
+{
+    int label = sample.chosenPath;
+    if (label < 0 || label >= numClasses)
+        return;
+    numSamples++;
+
+    double x[FLOW_FEATURES];
+    flowFeatures(sample, x);
+    int predicted = argmax(x);
+    if (predicted == label)
+        return;
+
+    double *wTrue = &weights[label * FLOW_FEATURES];
+    double *wPredicted = &weights[predicted * FLOW_FEATURES];
+    for (int f = 0; f < FLOW_FEATURES; f++) {
+        wTrue[f] += x[f];
+        wPredicted[f] -= x[f];
+    }
+}
+
+int PerceptronClassifier::predict(const FlowData& query) const
+{
+    if (numSamples == 0)
+        return -1;
+
+    double x[FLOW_FEATURES];
+    flowFeatures(query, x);
+    return argmax(x);
+}
+
+size_t PerceptronClassifier::getMemoryBytes() const
+{
+    return sizeof(*this) + weights.capacity() * sizeof(double);
+}
+
+std::vector<double> PerceptronClassifier::getParameters() const
+{
+    return linearParameters(numSamples, weights);
+}
+
+void PerceptronClassifier::setParameters(const double *params, size_t n)
+{
+    setLinearParameters(getName(), params, n, numSamples, weights);
+}
+
+//------------------------------------------------------------------------------
+
+static void treeAttributes(const FlowData& flow, double *a)
+{
+    a[0] = flow.srcBattery;
+    a[1] = flow.destBattery;
+    a[2] = flow.pathDistance;
+    a[3] = flow.srcAddr;
+    a[4] = flow.destAddr;
+}
+
+static double entropy(const double *weights, int n)
+{
+    double total = 0;
+    for (int i = 0; i < n; i++)
+        total += weights[i];
+    if (total <= 0)
+        return 0;
+    double h = 0;
+    for (int i = 0; i < n; i++)
+        if (weights[i] > 0)
+            h -= weights[i] / total * std::log2(weights[i] / total);
+    return h;
+}
+
+void HoeffdingTreeClassifier::Gaussian::add(double x)
+{
+    // Welford's update
+    weight += 1;
+    double d = x - mean;
+    mean += d / weight;
+    m2 += d * (x - mean);
+}
+
+double HoeffdingTreeClassifier::Gaussian::stddev() const
+{
+    return weight > 1 ? std::sqrt(m2 / (weight - 1)) : 0;
+}
+
+double HoeffdingTreeClassifier::Gaussian::weightBelow(double x) const
+{
+    if (weight <= 0)
+        return 0;
+    double sd = stddev();
+    if (sd <= 0)
+        return x >= mean ? weight : 0;
+    return weight * 0.5 * std::erfc(-(x - mean) / (sd * M_SQRT2));
+}
+
+HoeffdingTreeClassifier::HoeffdingTreeClassifier(int numClasses, int gracePeriod, double delta,
+                                                 double tieThreshold, int maxNodes)
+    : FlowClassifier(numClasses), gracePeriod(gracePeriod), delta(delta),
+      tieThreshold(tieThreshold), maxNodes(maxNodes)
+{
+    nodes.emplace_back();
+    initLeaf(nodes.back(), 0);
+}
+
+void HoeffdingTreeClassifier::initLeaf(Node& node, int depth)
+{
+    node.depth = depth;
+    node.classWeights.assign(numClasses, 0.0);
+    node.observers.assign(NUM_ATTRIBUTES * numClasses, Gaussian());
+    std::fill(node.minValue, node.minValue + NUM_ATTRIBUTES, INFINITY);
+    std::fill(node.maxValue, node.maxValue + NUM_ATTRIBUTES, -INFINITY);
+}
+
+int HoeffdingTreeClassifier::findLeaf(const double *attributes) const
+{
+    int index = 0;
+    while (nodes[index].attribute >= 0) {
+        const Node& node = nodes[index];
+        index = attributes[node.attribute] <= node.threshold ? node.left : node.right;
+    }
+    return index;
+}
+
+void HoeffdingTreeClassifier::learn(const FlowData& sample)
+{
+    int label = sample.chosenPath;
+    if (label < 0 || label >= numClasses)
+        return;
+    numSamples++;
+
+    double a[NUM_ATTRIBUTES];
+    treeAttributes(sample, a);
+    int leafIndex = findLeaf(a);
+    Node& leaf = nodes[leafIndex];
+    leaf.classWeights[label] += 1;
+    for (int i = 0; i < NUM_ATTRIBUTES; i++) {
+        leaf.observers[i * numClasses + label].add(a[i]);
+        leaf.minValue[i] = std::min(leaf.minValue[i], a[i]);
+        leaf.maxValue[i] = std::max(leaf.maxValue[i], a[i]);
+    }
+
+    double total = 0;
+    for (double w : leaf.classWeights)
+        total += w;
+    if (total - leaf.weightAtLastCheck >= gracePeriod) {
+        leaf.weightAtLastCheck = total;
+        trySplit(leafIndex);
+    }
+}
+
+double HoeffdingTreeClassifier::splitGain(const Node& leaf, int attribute, double threshold, double parentEntropy) const
+{
+    std::vector<double> left(numClasses), right(numClasses);
+    double leftTotal = 0, rightTotal = 0;
+    for (int c = 0; c < numClasses; c++) {
+        left[c] = leaf.observers[attribute * numClasses + c].weightBelow(threshold);
+        right[c] = std::max(0.0, leaf.classWeights[c] - left[c]);
+        leftTotal += left[c];
+        rightTotal += right[c];
+    }
+    double total = leftTotal + rightTotal;
+    if (total <= 0)
+        return 0;
+    return parentEntropy - (leftTotal * entropy(left.data(), numClasses)
+                            + rightTotal * entropy(right.data(), numClasses)) / total;
+}
+
+void HoeffdingTreeClassifier::trySplit(int leafIndex)
+{
+    if ((int)nodes.size() + 2 > maxNodes)
+        return;
+
+    const Node& leaf = nodes[leafIndex];
+    double total = 0;
+    int presentClasses = 0;
+    for (double w : leaf.classWeights) {
+        total += w;
+        presentClasses += w > 0;
+    }
+    if (presentClasses < 2)
+        return;  // pure leaf
+    double parentEntropy = entropy(leaf.classWeights.data(), numClasses);
+
+    // best threshold per attribute among evenly spaced candidates
+    const int numCandidates = 10;
+    double bestGain = 0, secondGain = 0, bestThreshold = 0;
+    int bestAttribute = -1;
+    for (int a = 0; a < NUM_ATTRIBUTES; a++) {
+        if (!(leaf.maxValue[a] > leaf.minValue[a]))
+            continue;
+        double attributeGain = 0, attributeThreshold = 0;
+        for (int i = 1; i <= numCandidates; i++) {
+            double t = leaf.minValue[a] + (leaf.maxValue[a] - leaf.minValue[a]) * i / (numCandidates + 1);
+            double gain = splitGain(leaf, a, t, parentEntropy);
+            if (gain > attributeGain) {
+                attributeGain = gain;
+                attributeThreshold = t;
+            }
+        }
+        if (attributeGain > bestGain) {
+            secondGain = bestGain;
+            bestGain = attributeGain;
+            bestThreshold = attributeThreshold;
+            bestAttribute = a;
+        }
+        else if (attributeGain > secondGain) {
+            secondGain = attributeGain;
+        }
+    }
+    if (bestAttribute < 0)
+        return;
+
+    // Hoeffding bound for information gain, whose range is log2(numClasses)
+    double range = std::log2((double)numClasses);
+    double epsilon = std::sqrt(range * range * std::log(1 / delta) / (2 * total));
+    if (bestGain - secondGain <= epsilon && epsilon >= tieThreshold)
+        return;
+
+    // children start with the class distribution estimated for their side
+    std::vector<double> leftWeights(numClasses), rightWeights(numClasses);
+    for (int c = 0; c < numClasses; c++) {
+        leftWeights[c] = leaf.observers[bestAttribute * numClasses + c].weightBelow(bestThreshold);
+        rightWeights[c] = std::max(0.0, leaf.classWeights[c] - leftWeights[c]);
+    }
+    int depth = leaf.depth + 1;
+    int leftIndex = nodes.size();
+    nodes.emplace_back();
+    initLeaf(nodes.back(), depth);
+    nodes.back().classWeights = leftWeights;
+    nodes.emplace_back();
+    initLeaf(nodes.back(), depth);
+    nodes.back().classWeights = rightWeights;
+
+    // emplace_back may have moved the nodes; the former leaf keeps its class
+    // weights for predictions in children that have seen nothing yet
+    Node& node = nodes[leafIndex];
+    node.attribute = bestAttribute;
+    node.threshold = bestThreshold;
+    node.left = leftIndex;
+    node.right = leftIndex + 1;
+    std::vector<Gaussian>().swap(node.observers);
+}
+
+int HoeffdingTreeClassifier::predict(const FlowData& query) const
+{
+    if (numSamples == 0)
+        return -1;
+
+    double a[NUM_ATTRIBUTES];
+    treeAttributes(query, a);
+
+    // majority class of the deepest node on the path that has any weight
+    int index = 0;
+    const std::vector<double> *weights = &nodes[0].classWeights;
+    while (true) {
+        const Node& node = nodes[index];
+        for (double w : node.classWeights) {
+            if (w > 0) {
+                weights = &node.classWeights;
+                break;
+            }
+        }
+        if (node.attribute < 0)
+            break;
+        index = a[node.attribute] <= node.threshold ? node.left : node.right;
+    }
+    return std::max_element(weights->begin(), weights->end()) - weights->begin();
+}
+
+size_t HoeffdingTreeClassifier::getMemoryBytes() const
+{
+    size_t bytes = sizeof(*this) + nodes.capacity() * sizeof(Node);
+    for (const Node& node : nodes)
+        bytes += node.classWeights.capacity() * sizeof(double) + node.observers.capacity() * sizeof(Gaussian);
+    return bytes;
+}
+
+// The number of samples and of nodes, then per node: attribute, threshold,
+// children, depth, weightAtLastCheck, the value ranges, the class weights,
+// the number of observers (0 for inner nodes) and their weight, mean and m2.
+std::vector<double> HoeffdingTreeClassifier::getParameters() const
+{
+    std::vector<double> params = { (double)numSamples, (double)nodes.size() };
+    for (const Node& node : nodes) {
+        params.insert(params.end(), { (double)node.attribute, node.threshold, (double)node.left,
+                                      (double)node.right, (double)node.depth, node.weightAtLastCheck });
+        params.insert(params.end(), node.minValue, node.minValue + NUM_ATTRIBUTES);
+        params.insert(params.end(), node.maxValue, node.maxValue + NUM_ATTRIBUTES);
+        params.insert(params.end(), node.classWeights.begin(), node.classWeights.end());
+        params.push_back(node.observers.size());
+        for (const Gaussian& g : node.observers)
+            params.insert(params.end(), { g.weight, g.mean, g.m2 });
+    }
+    return params;
+}
+
+void HoeffdingTreeClassifier::setParameters(const double *params, size_t n)
+{
+    size_t pos = 0;
+    auto next = [&]() {
+        if (pos >= n)
+            throw std::runtime_error("the saved hoeffding model is truncated");
+        return params[pos++];
+    };
+
+    size_t savedSamples = next();
+    int numNodes = next();
+    if (numNodes < 1 || numNodes > maxNodes)
+        throw std::runtime_error("the saved hoeffding model has " + std::to_string(numNodes) + " nodes");
+    std::vector<Node> saved(numNodes);
+    for (int i = 0; i < numNodes; i++) {
+        Node& node = saved[i];
+        node.attribute = next();
+        node.threshold = next();
+        node.left = next();
+        node.right = next();
+        node.depth = next();
+        node.weightAtLastCheck = next();
+        for (double& v : node.minValue)
+            v = next();
+        for (double& v : node.maxValue)
+            v = next();
+        node.classWeights.resize(numClasses);
+        for (double& w : node.classWeights)
+            w = next();
+        size_t numObservers = next();
+        bool leaf = node.attribute < 0;
+        if (node.attribute >= NUM_ATTRIBUTES || numObservers != (leaf ? NUM_ATTRIBUTES * numClasses : 0u)
+            || (!leaf && (node.left <= i || node.left >= numNodes || node.right <= i || node.right >= numNodes)))
+            throw std::runtime_error("the saved hoeffding model is corrupt or has a different number of gates");
+        node.observers.resize(numObservers);
+        for (Gaussian& g : node.observers) {
+            g.weight = next();
+            g.mean = next();
+            g.m2 = next();
+        }
+    }
+    if (pos != n)
+        throw std::runtime_error("the saved hoeffding model has a different number of gates");
+
+    numSamples = savedSamples;
+    nodes = std::move(saved);
+}
+
+//------------------------------------------------------------------------------
+
+MlpClassifier::MlpClassifier(int numClasses, const std::string& weightsFile)
+    : FlowClassifier(numClasses)
+{
+    if (weightsFile.empty())
+        throw std::invalid_argument("the mlp model needs a weights file");
+    network.load(weightsFile);
+    if (network.getNumInputs() != FLOW_FEATURES)
+        throw std::runtime_error("'" + weightsFile + "' has " + std::to_string(network.getNumInputs())
+                                 + " inputs instead of " + std::to_string(FLOW_FEATURES) + " flow features");
+    if (network.getNumOutputs() > numClasses)
+        throw std::runtime_error("'" + weightsFile + "' has " + std::to_string(network.getNumOutputs())
+                                 + " outputs for " + std::to_string(numClasses) + " gates");
+    inputs.resize(MLP_MAX_BATCH * FLOW_FEATURES);
+    outputs.resize(MLP_MAX_BATCH * network.getNumOutputs());
+}
+
+int MlpClassifier::predict(const FlowData& query) const
+{
+    double x[FLOW_FEATURES];
+    flowFeatures(query, x);
+    std::copy_n(x, FLOW_FEATURES, inputs.begin());
+    return network.argmax(inputs.data());
+}
+
+void MlpClassifier::predictBatch(int n, const FlowData *queries, int *gates) const
+{
+    int numOutputs = network.getNumOutputs();
+    for (int start = 0; start < n; start += MLP_MAX_BATCH) {
+        int chunk = std::min(n - start, MLP_MAX_BATCH);
+        for (int i = 0; i < chunk; i++) {
+            double x[FLOW_FEATURES];
+            flowFeatures(queries[start + i], x);
+            std::copy_n(x, FLOW_FEATURES, &inputs[i * FLOW_FEATURES]);
+        }
+        network.forward(chunk, inputs.data(), FLOW_FEATURES, outputs.data());
+        for (int i = 0; i < chunk; i++) {
+            const float *y = &outputs[i * numOutputs];
+            gates[start + i] = std::max_element(y, y + numOutputs) - y;
+        }
+    }
+}
+
+size_t MlpClassifier::getMemoryBytes() const
+{
+    return sizeof(*this) - sizeof(network) + network.getMemoryBytes()
+           + (inputs.capacity() + outputs.capacity()) * sizeof(float);
+}
+
+//------------------------------------------------------------------------------
+
+FlowClassifier *createFlowClassifier(const std::string& type, int numClasses, int k, double learningRate,
+                                     const std::string& weightsFile)
+{
+    if (numClasses < 1)
+        throw std::invalid_argument("a classifier needs at least one class (gate)");
+    if (type == "knn")
+        return new KnnClassifier(numClasses, k);
+    if (type == "logistic")
+        return new LogisticClassifier(numClasses, learningRate);
+    if (type == "perceptron")
+        return new PerceptronClassifier(numClasses);
+    if (type == "hoeffding")
+        return new HoeffdingTreeClassifier(numClasses);
+    if (type == "mlp")
+        return new MlpClassifier(numClasses, weightsFile);
+    throw std::invalid_argument("unknown model type '" + type + "' (knn, logistic, perceptron, hoeffding or mlp)");
+}
@@ -0,0 +1,239 @@
+//
+// Routing-decision classifiers of the SDN controller, kept free of the
+// simulation kernel like SDNRoutingCore (see bench/controller_bench.cc).
+//
+// A classifier predicts the output gate (FlowData::chosenPath) of a flow.
+// Besides the one-shot KNN model of the controller there are online
+// learners whose cost per update and per prediction does not grow with the
+// number of samples seen: multinomial logistic regression trained by SGD,
+// a multiclass perceptron and a Hoeffding tree. A multilayer perceptron
+// trained offline (MlpNetwork) serves batched predictions.
+//
+
+#ifndef __FLOWCLASSIFIER_H
+#define __FLOWCLASSIFIER_H
+
+#include <string>
+#include <vector>
+#include "SDNRoutingCore.h"
+#include "MlpNetwork.h"
+
+// Feature vector of the linear models: bias, the three KNN features scaled to
+// about [0, 1] and a one-hot encoding of the destination address, hashed
+// into FLOW_DEST_BUCKETS buckets.
+#define FLOW_DEST_BUCKETS  16
+#define FLOW_FEATURES      (4 + FLOW_DEST_BUCKETS)
+
+/** Fills x[FLOW_FEATURES] with the features of a flow. */
+void flowFeatures(const FlowData& flow, double *x);
+
+/**
+ * Common interface of the classifiers. Labels are gate indices in
+ * [0, numClasses); samples with other labels are ignored by online models.
+ */
+class FlowClassifier
+{
+  protected:
+    int numClasses;
+    size_t numSamples = 0;
+
+  public:
+    explicit FlowClassifier(int numClasses) : numClasses(numClasses) {}
+    virtual ~FlowClassifier() {}
+
+    virtual const char *getName() const = 0;
+
+    /** True if learn() updates the model, false for one-shot models. */
+    virtual bool isOnline() const { return true; }
+
+    /** Trains on a batch; online models learn the samples in order. */
+    virtual void train(const std::vector<FlowData>& samples);
+
+    /** Online update with one labelled sample. */
+    virtual void learn(const FlowData& sample) = 0;
+
+    /** Predicted gate, or -1 before anything was learned. */
+    virtual int predict(const FlowData& query) const = 0;
+
+    /** Predicted gates of n flows at once; by default one predict() per flow. */
+    virtual void predictBatch(int n, const FlowData *queries, int *gates) const;
+
+    /** Heap and object memory of the model. */
+    virtual size_t getMemoryBytes() const = 0;
+
+    /** The samples of instance-based models (kept in snapshots), else nullptr. */
+    virtual const std::vector<FlowData> *getSamples() const { return nullptr; }
+
+    /**
+     * The learned state of online models as flat values (kept in snapshots,
+     * so that a restored model goes on from where it was); empty for models
+     * that are restored from their samples or their weights file.
+     */
+    virtual std::vector<double> getParameters() const { return {}; }
+
+    /** Restores getParameters() of a model of the same type; throws std::runtime_error. */
+    virtual void setParameters(const double *params, size_t n);
+
+    /** Number of samples the model has learned. */
+    size_t getNumSamples() const { return numSamples; }
+};
+
+/**
+ * The controller's original model: majority vote of the k nearest samples of
+ * the training batch (knnPredict). It is trained once and does not learn
+ * online, so predictions cost O(n log n) in the size of the batch.
+ */
+class KnnClassifier : public FlowClassifier
+{
+  private:
+    int k;
+    std::vector<FlowData> samples;
+
+  public:
+    KnnClassifier(int numClasses, int k) : FlowClassifier(numClasses), k(k) {}
+    virtual const char *getName() const override { return "knn"; }
+    virtual bool isOnline() const override { return false; }
+    virtual void train(const std::vector<FlowData>& samples) override;
+    virtual void learn(const FlowData&) override {}
+    virtual int predict(const FlowData& query) const override;
+    virtual size_t getMemoryBytes() const override;
+    virtual const std::vector<FlowData> *getSamples() const override { return &samples; }
+};
+
+/**
+ * Multinomial logistic regression, one SGD step on the cross-entropy loss
+ * per sample. O(numClasses * FLOW_FEATURES) per update and prediction.
+ */
+class LogisticClassifier : public FlowClassifier
+{
+  private:
+    double learningRate;
+    std::vector<double> weights;  // numClasses rows of FLOW_FEATURES
+
+  public:
+    LogisticClassifier(int numClasses, double learningRate);
+    virtual const char *getName() const override { return "logistic"; }
+    virtual void learn(const FlowData& sample) override;
+    virtual int predict(const FlowData& query) const override;
+    virtual size_t getMemoryBytes() const override;
+    virtual std::vector<double> getParameters() const override;
+    virtual void setParameters(const double *params, size_t n) override;
+};
+
+/**
+ * Multiclass perceptron: on a mistake the weights of the true class move
+ * towards the sample and those of the predicted class away from it.
+ * O(numClasses * FLOW_FEATURES) per update and prediction.
+ */
+class PerceptronClassifier : public FlowClassifier
+{
+  private:
+    std::vector<double> weights;  // numClasses rows of FLOW_FEATURES
+
+    int argmax(const double *x) const;
+
+  public:
+    explicit PerceptronClassifier(int numClasses);
+    virtual const char *getName() const override { return "perceptron"; }
+    virtual void learn(const FlowData& sample) override;
+    virtual int predict(const FlowData& query) const override;
+    virtual size_t getMemoryBytes() const override;
+    virtual std::vector<double> getParameters() const override;
+    virtual void setParameters(const double *params, size_t n) override;
+};
+
+/**
+ * Hoeffding tree (VFDT) over the numeric attributes source/destination
+ * battery, path distance and source/destination address. Each leaf keeps a
+ * Gaussian per class and attribute; every gracePeriod samples it evaluates
+ * split thresholds by information gain and splits once the Hoeffding bound
+ * separates the two best attributes. An update costs O(depth + attributes *
+ * classes), a prediction O(depth); the tree is capped at maxNodes nodes.
+ */
+class HoeffdingTreeClassifier : public FlowClassifier
+{
+  public:
+    enum { NUM_ATTRIBUTES = 5 };
+
+  private:
+    struct Gaussian {
+        double weight = 0;
+        double mean = 0;
+        double m2 = 0;
+        void add(double x);
+        double stddev() const;
+        double weightBelow(double x) const;  // estimated weight of values <= x
+    };
+
+    struct Node {
+        int attribute = -1;     // -1 for a leaf
+        double threshold = 0;
+        int left = -1;          // child indices into nodes; values <= threshold go left
+        int right = -1;
+        int depth = 0;
+        std::vector<double> classWeights;
+        std::vector<Gaussian> observers;  // [attribute * numClasses + class], leaves only
+        double minValue[NUM_ATTRIBUTES];
+        double maxValue[NUM_ATTRIBUTES];
+        double weightAtLastCheck = 0;
+    };
+
+    int gracePeriod;
+    double delta;
+    double tieThreshold;
+    int maxNodes;
+    std::vector<Node> nodes;
+
+    void initLeaf(Node& node, int depth);
+    int findLeaf(const double *attributes) const;
+    void trySplit(int leafIndex);
+    double splitGain(const Node& leaf, int attribute, double threshold, double parentEntropy) const;
+
+  public:
+    HoeffdingTreeClassifier(int numClasses, int gracePeriod = 200, double delta = 1e-7,
+                            double tieThreshold = 0.05, int maxNodes = 255);
+    virtual const char *getName() const override { return "hoeffding"; }
+    virtual void learn(const FlowData& sample) override;
+    virtual int predict(const FlowData& query) const override;
+    virtual size_t getMemoryBytes() const override;
+    virtual std::vector<double> getParameters() const override;
+    virtual void setParameters(const double *params, size_t n) override;
+    int getNumNodes() const { return nodes.size(); }
+};
+
+/**
+ * Multilayer perceptron over the flow features, with the weights of the
+ * offline trainer. It does not learn in the simulation: train() only counts
+ * the batch, which makes the controller switch to the model. A prediction
+ * costs one pass through the network, and predictBatch() evaluates up to
+ * MLP_MAX_BATCH flows per pass. The network must have FLOW_FEATURES inputs
+ * and at most numClasses outputs (one per gate).
+ */
+class MlpClassifier : public FlowClassifier
+{
+  private:
+    MlpNetwork network;
+    mutable std::vector<float> inputs;   // MLP_MAX_BATCH rows of FLOW_FEATURES
+    mutable std::vector<float> outputs;  // MLP_MAX_BATCH rows of the network outputs
+
+  public:
+    MlpClassifier(int numClasses, const std::string& weightsFile);
+    virtual const char *getName() const override { return "mlp"; }
+    virtual bool isOnline() const override { return false; }
+    virtual void train(const std::vector<FlowData>& samples) override { numSamples = samples.size(); }
+    virtual void learn(const FlowData&) override {}
+    virtual int predict(const FlowData& query) const override;
+    virtual void predictBatch(int n, const FlowData *queries, int *gates) const override;
+    virtual size_t getMemoryBytes() const override;
+    const MlpNetwork& getNetwork() const { return network; }
+};
+
+/**
+ * Creates the classifier named type ("knn", "logistic", "perceptron",
+ * "hoeffding" or "mlp", which loads weightsFile); throws std::invalid_argument
+ * for other names and std::runtime_error for unusable weight files.
+ */
+FlowClassifier *createFlowClassifier(const std::string& type, int numClasses, int k, double learningRate,
+                                     const std::string& weightsFile = "");
+
+#endif
@@ -0,0 +1,65 @@
+//
+// Opt-in wall-clock profiler for handleMessage() (see HandlerProfiler.h)
+//
+
+#include "HandlerProfiler.h"
+
+#ifdef WITH_HANDLER_PROFILING
+
+#include <map>
+
+using namespace omnetpp;
+
+LatencyHistogram& HandlerProfile::histogramFor(const cMessage *msg)
+{
+    const char *name = msg->isSelfMessage() ? msg->getName() : msg->getClassName();
+    for (auto& category : categories)
+        if (category.name == name)
+            return category.histogram;
+
+    categories.push_back(Category());
+    categories.back().name = name;
+    return categories.back().histogram;
+}
+
+void HandlerProfile::beginRun()
+{
+    if (!recorded)
+        return;
+    categories.clear();
+    recorded = false;
+}
+
+void HandlerProfile::recordScalars(cModule *module)
+{
+    if (recorded)
+        return;
+    recorded = true;
+
+    uint64_t totalCount = 0, totalNs = 0;
+    for (auto& category : categories) {
+        const LatencyHistogram& h = category.histogram;
+        std::string prefix = "handlerProfile:" + moduleType + ":" + category.name;
+        module->recordScalar((prefix + ":count").c_str(), (double)h.getCount());
+        module->recordScalar((prefix + ":totalTime").c_str(), h.getTotalNs() * 1e-9, "s");
+        module->recordScalar((prefix + ":p50").c_str(), h.getQuantile(0.50) * 1e-9, "s");
+        module->recordScalar((prefix + ":p99").c_str(), h.getQuantile(0.99) * 1e-9, "s");
+        module->recordScalar((prefix + ":max").c_str(), h.getMaxNs() * 1e-9, "s");
+        totalCount += h.getCount();
+        totalNs += h.getTotalNs();
+    }
+    module->recordScalar(("handlerProfile:" + moduleType + ":count").c_str(), (double)totalCount);
+    module->recordScalar(("handlerProfile:" + moduleType + ":totalTime").c_str(), totalNs * 1e-9, "s");
+}
+
+HandlerProfile& HandlerProfiler::profileOf(const cModule *module)
+{
+    static std::map<std::string, HandlerProfile> profiles;
+    const char *type = module->getClassName();
+    auto it = profiles.find(type);
+    if (it == profiles.end())
+        it = profiles.emplace(type, HandlerProfile(type)).first;
+    return it->second;
+}
+
+#endif  // WITH_HANDLER_PROFILING
@@ -0,0 +1,93 @@
+//
+// Opt-in wall-clock profiler for handleMessage().
+//
+// Compiled in only with -DWITH_HANDLER_PROFILING (make PROFILING=1); without
+// it the macros below expand to nothing. When enabled, every handleMessage()
+// call is timed with steady_clock and collected per module type and message
+// category (timer name for self-messages, class name otherwise) into a
+// log-scale histogram. At finish() the first module of each type records the
+// totals, counts and p50/p99 of its type as scalars.
+//
+
+#ifndef __HANDLERPROFILER_H
+#define __HANDLERPROFILER_H
+
+#ifdef WITH_HANDLER_PROFILING
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <omnetpp.h>
+#include "LatencyHistogram.h"
+
+/**
+ * Profile of one module type: a histogram per message category.
+ */
+class HandlerProfile
+{
+  public:
+    struct Category {
+        std::string name;
+        LatencyHistogram histogram{2};  // 4 sub-buckets per power of two
+    };
+
+  private:
+    std::string moduleType;
+    std::deque<Category> categories;  // deque: timers keep references across inserts
+    bool recorded = false;
+
+  public:
+    explicit HandlerProfile(const char *moduleType) : moduleType(moduleType) {}
+    LatencyHistogram& histogramFor(const omnetpp::cMessage *msg);
+    void beginRun();
+    void recordScalars(omnetpp::cModule *module);
+};
+
+/**
+ * Registry of the per-type profiles; profiles live for the whole process.
+ */
+class HandlerProfiler
+{
+  public:
+    static HandlerProfile& profileOf(const omnetpp::cModule *module);
+};
+
+/**
+ * Times one handleMessage() invocation (RAII).
+ */
+class ScopedHandlerTimer
+{
+  private:
+    LatencyHistogram& histogram;
+    std::chrono::steady_clock::time_point start;
+
+  public:
+    ScopedHandlerTimer(HandlerProfile& profile, const omnetpp::cMessage *msg)
+        : histogram(profile.histogramFor(msg)), start(std::chrono::steady_clock::now()) {}
+    ~ScopedHandlerTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        histogram.collect(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+};
+
+// First statement of handleMessage(); the profile lookup happens once per module type.
+#define PROFILE_HANDLER(msg) \
+    static HandlerProfile& handlerProfile_ = HandlerProfiler::profileOf(this); \
+    ScopedHandlerTimer handlerTimer_(handlerProfile_, msg)
+
+// In initialize(): drops the data of a previous run in the same process.
+#define PROFILE_HANDLER_INIT() HandlerProfiler::profileOf(this).beginRun()
+
+// In finish(): records the scalars of this module type (once per type).
+#define PROFILE_HANDLER_FINISH() HandlerProfiler::profileOf(this).recordScalars(this)
+
+#else
+
+#define PROFILE_HANDLER(msg)        ((void)0)
+#define PROFILE_HANDLER_INIT()      ((void)0)
+#define PROFILE_HANDLER_FINISH()    ((void)0)
+
+#endif  // WITH_HANDLER_PROFILING
+
+#endif
@@ -10,6 +10,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <omnetpp.h>
+#include "HandlerProfiler.h"
+#include "MemoryAccounting.h"
 
 using namespace omnetpp;
 
@@ -25,6 +27,7 @@ class L2Queue : public cSimpleModule
     cQueue queue;
     cMessage *endTransmissionEvent = nullptr;
     bool isBusy;
+    MemoryAccount queueMemory{MEM_QUEUES};
 
     simsignal_t qlenSignal;
     simsignal_t busySignal;
@@ -32,6 +35,7 @@ class L2Queue : public cSimpleModule
     simsignal_t dropSignal;
     simsignal_t txBytesSignal;
     simsignal_t rxBytesSignal;
+    simsignal_t queueMemorySignal;
 
   public:
     virtual ~L2Queue();
@@ -39,8 +43,10 @@ class L2Queue : public cSimpleModule
   protected:
     virtual void initialize() override;
     virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
     virtual void refreshDisplay() const override;
     virtual void startTransmitting(cMessage *msg);
+    static int64_t messageFootprint(cMessage *msg);
 };
 
 Define_Module(L2Queue);
@@ -52,6 +58,8 @@ L2Queue::~L2Queue()
 
 void L2Queue::initialize()
 {
+    PROFILE_HANDLER_INIT();
+
     queue.setName("queue");
     endTransmissionEvent = new cMessage("endTxEvent");
 
@@ -66,6 +74,7 @@ void L2Queue::initialize()
     dropSignal = registerSignal("drop");
     txBytesSignal = registerSignal("txBytes");
     rxBytesSignal = registerSignal("rxBytes");
+    queueMemorySignal = registerSignal("queueMemory");
 
     emit(qlenSignal, queue.getLength());
     emit(busySignal, false);
@@ -74,7 +83,7 @@ void L2Queue::initialize()
 
 void L2Queue::startTransmitting(cMessage *msg)
 {
-    EV << "Starting transmission of " << msg << endl;
+    EV_DEBUG << "Starting transmission of " << msg << endl;
     isBusy = true;
     int64_t numBytes = check_and_cast<cPacket *>(msg)->getByteLength();
     send(msg, "line$o");
@@ -86,17 +95,27 @@ void L2Queue::startTransmitting(cMessage *msg)
     scheduleAt(endTransmission, endTransmissionEvent);
 }
 
+int64_t L2Queue::messageFootprint(cMessage *msg)
+{
+    // host memory of a queued packet, not its length on the wire
+    return sizeof(cPacket) + strlen(msg->getName()) + 1;
+}
+
 void L2Queue::handleMessage(cMessage *msg)
 {
+    PROFILE_HANDLER(msg);
+
     if (msg == endTransmissionEvent) {
         // Transmission finished, we can start next one.
-        EV << "Transmission finished.\n";
+        EV_TRACE << "Transmission finished.\n";
         isBusy = false;
         if (queue.isEmpty()) {
             emit(busySignal, false);
         }
         else {
             msg = (cMessage *)queue.pop();
+            queueMemory.add(-messageFootprint(msg));
+            emit(queueMemorySignal, queueMemory.get());
             emit(queueingTimeSignal, simTime() - msg->getTimestamp());
             emit(qlenSignal, queue.getLength());
             startTransmitting(msg);
@@ -111,20 +130,22 @@ void L2Queue::handleMessage(cMessage *msg)
         if (endTransmissionEvent->isScheduled()) {
             // We are currently busy, so just queue up the packet.
             if (frameCapacity && queue.getLength() >= frameCapacity) {
-                EV << "Received " << msg << " but transmitter busy and queue full: discarding\n";
+                EV_DEBUG << "Received " << msg << " but transmitter busy and queue full: discarding\n";
                 emit(dropSignal, (intval_t)check_and_cast<cPacket *>(msg)->getByteLength());
                 delete msg;
             }
             else {
-                EV << "Received " << msg << " but transmitter busy: queueing up\n";
+                EV_TRACE << "Received " << msg << " but transmitter busy: queueing up\n";
                 msg->setTimestamp();
                 queue.insert(msg);
+                queueMemory.add(messageFootprint(msg));
+                emit(queueMemorySignal, queueMemory.get());
                 emit(qlenSignal, queue.getLength());
             }
         }
         else {
             // We are idle, so we can start transmitting right away.
-            EV << "Received " << msg << endl;
+            EV_TRACE << "Received " << msg << endl;
             emit(queueingTimeSignal, SIMTIME_ZERO);
             startTransmitting(msg);
             emit(busySignal, true);
@@ -132,6 +153,11 @@ void L2Queue::handleMessage(cMessage *msg)
     }
 }
 
+void L2Queue::finish()
+{
+    PROFILE_HANDLER_FINISH();
+}
+
 void L2Queue::refreshDisplay() const
 {
     getDisplayString().setTagArg("t", 0, isBusy ? "transmitting" : "idle");
@@ -0,0 +1,83 @@
+//
+// HDR-style latency histogram (see LatencyHistogram.h)
+//
+
+#include <algorithm>
+#include <cmath>
+#include "LatencyHistogram.h"
+
+LatencyHistogram::LatencyHistogram(int subBucketBits)
+    : subBucketBits(subBucketBits),
+      counts((64 - subBucketBits + 1) << subBucketBits, 0)
+{
+}
+
+int LatencyHistogram::bucketOf(uint64_t ns) const
+{
+    if (ns < (1ull << subBucketBits))
+        return (int)ns;
+    int msb = 63 - __builtin_clzll(ns);
+    int shift = msb - subBucketBits;
+    uint64_t sub = (ns >> shift) & ((1ull << subBucketBits) - 1);
+    return ((shift + 1) << subBucketBits) + (int)sub;
+}
+
+double LatencyHistogram::bucketMidpoint(int bucket) const
+{
+    int octave = bucket >> subBucketBits;
+    if (octave == 0)
+        return bucket;
+    int shift = octave - 1;
+    uint64_t sub = bucket & ((1 << subBucketBits) - 1);
+    double width = std::ldexp(1.0, shift);
+    return ((1ull << subBucketBits) + sub) * width + (width - 1) / 2;
+}
+
+void LatencyHistogram::collect(uint64_t ns)
+{
+    counts[bucketOf(ns)]++;
+    count++;
+    totalNs += ns;
+    minNs = std::min(minNs, ns);
+    maxNs = std::max(maxNs, ns);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+    if (other.subBucketBits != subBucketBits) {
+        // different resolution: replay the other histogram's bucket midpoints
+        for (size_t i = 0; i < other.counts.size(); i++)
+            for (uint64_t j = 0; j < other.counts[i]; j++)
+                counts[bucketOf((uint64_t)other.bucketMidpoint(i))]++;
+    }
+    else {
+        for (size_t i = 0; i < counts.size(); i++)
+            counts[i] += other.counts[i];
+    }
+    count += other.count;
+    totalNs += other.totalNs;
+    minNs = std::min(minNs, other.minNs);
+    maxNs = std::max(maxNs, other.maxNs);
+}
+
+void LatencyHistogram::clear()
+{
+    std::fill(counts.begin(), counts.end(), 0);
+    count = totalNs = maxNs = 0;
+    minNs = UINT64_MAX;
+}
+
+double LatencyHistogram::getQuantile(double q) const
+{
+    if (count == 0)
+        return 0;
+
+    uint64_t target = std::max<uint64_t>(1, (uint64_t)std::ceil(q * count));
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        cumulative += counts[i];
+        if (cumulative >= target)
+            return std::max((double)getMinNs(), std::min(bucketMidpoint(i), (double)maxNs));
+    }
+    return maxNs;
+}
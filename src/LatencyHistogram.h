@@ -0,0 +1,47 @@
+//
+// HDR-style latency histogram with constant memory.
+//
+
+#ifndef __LATENCYHISTOGRAM_H
+#define __LATENCYHISTOGRAM_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Log-linear histogram of nanosecond values in the spirit of HdrHistogram:
+ * values below 2^subBucketBits are counted exactly, above that every power
+ * of two is split into 2^subBucketBits equal sub-buckets, so the relative
+ * error of a quantile is at most 2^-subBucketBits (about 3% for 5 bits)
+ * over the full 64-bit range.
+ */
+class LatencyHistogram
+{
+  private:
+    int subBucketBits;
+    std::vector<uint64_t> counts;
+    uint64_t count = 0;
+    uint64_t totalNs = 0;
+    uint64_t minNs = UINT64_MAX;
+    uint64_t maxNs = 0;
+
+    int bucketOf(uint64_t ns) const;
+    double bucketMidpoint(int bucket) const;
+
+  public:
+    explicit LatencyHistogram(int subBucketBits = 5);
+
+    void collect(uint64_t ns);
+    void merge(const LatencyHistogram& other);
+    void clear();
+
+    uint64_t getCount() const { return count; }
+    uint64_t getTotalNs() const { return totalNs; }
+    uint64_t getMinNs() const { return count ? minNs : 0; }
+    uint64_t getMaxNs() const { return maxNs; }
+    double getMeanNs() const { return count ? (double)totalNs / count : 0; }
+    double getQuantile(double q) const;
+    size_t getMemoryBytes() const { return sizeof(*this) + counts.capacity() * sizeof(uint64_t); }
+};
+
+#endif
@@ -0,0 +1,16 @@
+//
+// Lightweight accounting of the run-time memory of the model (see MemoryAccounting.h)
+//
+
+#include "MemoryAccounting.h"
+
+const char *getMemorySubsystemName(MemorySubsystem subsystem)
+{
+    switch (subsystem) {
+        case MEM_DATASET: return "dataset";
+        case MEM_MODEL:   return "model";
+        case MEM_METRICS: return "metrics";
+        case MEM_QUEUES:  return "queues";
+        default:          return "unknown";
+    }
+}
@@ -0,0 +1,52 @@
+//
+// Lightweight accounting of the run-time memory of the model.
+//
+
+#ifndef __MEMORYACCOUNTING_H
+#define __MEMORYACCOUNTING_H
+
+#include <cstdint>
+
+/**
+ * Subsystems whose memory grows during a run.
+ */
+enum MemorySubsystem {
+    MEM_DATASET,     // controller trainingDataset
+    MEM_MODEL,       // controller mlModel
+    MEM_METRICS,     // controller nodeDatabase and measurement state
+    MEM_QUEUES,      // packets waiting in an L2Queue
+    MEM_NUM_SUBSYSTEMS
+};
+
+const char *getMemorySubsystemName(MemorySubsystem subsystem);
+
+/**
+ * Byte count (current and peak) of one module's share of a subsystem. Every
+ * module keeps its own accounts, so the figures stay per instance with any
+ * number of controllers and under parsim. Updating is a couple of integer
+ * operations, so it can sit on the per-packet path.
+ */
+class MemoryAccount
+{
+  private:
+    MemorySubsystem subsystem;
+    int64_t bytes = 0;
+    int64_t peak = 0;
+
+  public:
+    explicit MemoryAccount(MemorySubsystem subsystem) : subsystem(subsystem) {}
+    MemoryAccount(const MemoryAccount&) = delete;
+    MemoryAccount& operator=(const MemoryAccount&) = delete;
+
+    void set(int64_t newBytes) {
+        bytes = newBytes;
+        if (bytes > peak)
+            peak = bytes;
+    }
+    void add(int64_t delta) { set(bytes + delta); }
+    int64_t get() const { return bytes; }
+    int64_t getPeak() const { return peak; }
+    const char *getName() const { return getMemorySubsystemName(subsystem); }
+};
+
+#endif
@@ -0,0 +1,244 @@
+//
+// Inference engine of small multilayer perceptrons (see MlpNetwork.h)
+//
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "MlpNetwork.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MLP_X86
+#include <immintrin.h>
+#endif
+
+static int roundUp8(int n)
+{
+    return (n + 7) & ~7;
+}
+
+// One layer over n samples whose activations are stride floats apart; writes
+// the padding of the outputs as zeros, as the next layer reads it.
+static void denseScalar(int inputs, int inputStride, int outputs, bool relu, const float *weights,
+                        const float *biases, int n, const float *in, int stride, float *out)
+{
+    for (int s = 0; s < n; s++) {
+        const float *x = in + s * stride;
+        float *y = out + s * stride;
+        for (int j = 0; j < outputs; j++) {
+            const float *w = weights + j * inputStride;
+            float sum = biases[j];
+            for (int i = 0; i < inputs; i++)
+                sum += w[i] * x[i];
+            y[j] = relu && sum < 0 ? 0 : sum;
+        }
+        std::fill(y + outputs, y + roundUp8(outputs), 0.0f);
+    }
+}
+
+#ifdef MLP_X86
+__attribute__((target("avx2,fma")))
+static inline float horizontalSum(__m256 v)
+{
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+// Same as denseScalar over the whole zero-padded rows; every weight row is
+// loaded once per four samples.
+__attribute__((target("avx2,fma")))
+static void denseAvx2(int inputStride, int outputs, bool relu, const float *weights,
+                      const float *biases, int n, const float *in, int stride, float *out)
+{
+    for (int j = 0; j < outputs; j++) {
+        const float *w = weights + j * inputStride;
+        int s = 0;
+        for (; s + 4 <= n; s += 4) {
+            const float *x0 = in + s * stride;
+            const float *x1 = x0 + stride;
+            const float *x2 = x1 + stride;
+            const float *x3 = x2 + stride;
+            __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+            __m256 a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+            for (int i = 0; i < inputStride; i += 8) {
+                __m256 wv = _mm256_loadu_ps(w + i);
+                a0 = _mm256_fmadd_ps(wv, _mm256_loadu_ps(x0 + i), a0);
+                a1 = _mm256_fmadd_ps(wv, _mm256_loadu_ps(x1 + i), a1);
+                a2 = _mm256_fmadd_ps(wv, _mm256_loadu_ps(x2 + i), a2);
+                a3 = _mm256_fmadd_ps(wv, _mm256_loadu_ps(x3 + i), a3);
+            }
+            float sums[4] = { horizontalSum(a0), horizontalSum(a1), horizontalSum(a2), horizontalSum(a3) };
+            for (int k = 0; k < 4; k++) {
+                float sum = sums[k] + biases[j];
+                out[(s + k) * stride + j] = relu && sum < 0 ? 0 : sum;
+            }
+        }
+        for (; s < n; s++) {
+            const float *x = in + s * stride;
+            __m256 a = _mm256_setzero_ps();
+            for (int i = 0; i < inputStride; i += 8)
+                a = _mm256_fmadd_ps(_mm256_loadu_ps(w + i), _mm256_loadu_ps(x + i), a);
+            float sum = horizontalSum(a) + biases[j];
+            out[s * stride + j] = relu && sum < 0 ? 0 : sum;
+        }
+    }
+    for (int s = 0; s < n; s++)
+        std::fill(out + s * stride + outputs, out + s * stride + roundUp8(outputs), 0.0f);
+}
+#endif
+
+MlpNetwork::MlpNetwork() : simd(cpuHasAvx2())
+{
+}
+
+bool MlpNetwork::cpuHasAvx2()
+{
+#ifdef MLP_X86
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+void MlpNetwork::setSimd(bool enabled)
+{
+    simd = enabled && cpuHasAvx2();
+}
+
+void MlpNetwork::addLayer(int inputs, int outputs, bool relu, const std::vector<float>& weights,
+                          const std::vector<float>& biases)
+{
+    if (inputs < 1 || outputs < 1)
+        throw std::invalid_argument("a layer needs at least one input and one output");
+    if (!layers.empty() && layers.back().outputs != inputs)
+        throw std::invalid_argument("layer has " + std::to_string(inputs) + " inputs, the previous one "
+                                    + std::to_string(layers.back().outputs) + " outputs");
+    if ((int)weights.size() != inputs * outputs || (int)biases.size() != outputs)
+        throw std::invalid_argument("layer weights or biases have the wrong size");
+
+    Layer layer;
+    layer.inputs = inputs;
+    layer.outputs = outputs;
+    layer.inputStride = roundUp8(inputs);
+    layer.relu = relu;
+    layer.weights.assign(outputs * layer.inputStride, 0.0f);
+    for (int j = 0; j < outputs; j++)
+        std::copy_n(&weights[j * inputs], inputs, &layer.weights[j * layer.inputStride]);
+    layer.biases = biases;
+    layers.push_back(std::move(layer));
+
+    maxStride = std::max({maxStride, roundUp8(inputs), roundUp8(outputs)});
+    for (auto& buffer : buffers)
+        buffer.assign(MLP_MAX_BATCH * maxStride, 0.0f);
+}
+
+void MlpNetwork::load(const std::string& fileName)
+{
+    std::ifstream in(fileName);
+    if (!in)
+        throw std::runtime_error("cannot open '" + fileName + "'");
+
+    // drop the comments, then read whitespace-separated tokens
+    std::string text, line;
+    while (std::getline(in, line))
+        text += line.substr(0, line.find('#')) + "\n";
+    std::istringstream tokens(text);
+
+    std::string magic;
+    int version = 0, numLayers = 0;
+    tokens >> magic >> version >> numLayers;
+    if (!tokens || magic != "MLP")
+        throw std::runtime_error("'" + fileName + "' is not an MLP weights file");
+    if (version != 1)
+        throw std::runtime_error("'" + fileName + "' has unsupported version " + std::to_string(version));
+
+    MlpNetwork network;
+    for (int k = 0; k < numLayers; k++) {
+        int inputs = 0, outputs = 0;
+        std::string activation;
+        tokens >> inputs >> outputs >> activation;
+        if (!tokens || (activation != "relu" && activation != "linear"))
+            throw std::runtime_error("'" + fileName + "': bad header of layer " + std::to_string(k + 1));
+        if (inputs < 1 || outputs < 1 || (size_t)inputs * outputs > 1u << 24)
+            throw std::runtime_error("'" + fileName + "': bad size of layer " + std::to_string(k + 1));
+        std::vector<float> weights(inputs * outputs), biases(outputs);
+        for (float& w : weights)
+            tokens >> w;
+        for (float& b : biases)
+            tokens >> b;
+        if (!tokens)
+            throw std::runtime_error("'" + fileName + "': layer " + std::to_string(k + 1) + " is truncated");
+        try {
+            network.addLayer(inputs, outputs, activation == "relu", weights, biases);
+        }
+        catch (std::invalid_argument& e) {
+            throw std::runtime_error("'" + fileName + "': layer " + std::to_string(k + 1) + ": " + e.what());
+        }
+    }
+    if (network.layers.empty())
+        throw std::runtime_error("'" + fileName + "' has no layers");
+
+    network.simd = simd;
+    *this = std::move(network);
+}
+
+const float *MlpNetwork::forwardChunk(int n, const float *inputs, int inputStride, float *outputs) const
+{
+    // copy the inputs into zero-padded rows
+    int numInputs = getNumInputs();
+    float *cur = buffers[0].data();
+    float *next = buffers[1].data();
+    for (int s = 0; s < n; s++) {
+        std::copy_n(inputs + s * inputStride, numInputs, cur + s * maxStride);
+        std::fill(cur + s * maxStride + numInputs, cur + s * maxStride + roundUp8(numInputs), 0.0f);
+    }
+
+    for (const Layer& l : layers) {
+#ifdef MLP_X86
+        if (simd)
+            denseAvx2(l.inputStride, l.outputs, l.relu, l.weights.data(), l.biases.data(),
+                      n, cur, maxStride, next);
+        else
+#endif
+            denseScalar(l.inputs, l.inputStride, l.outputs, l.relu, l.weights.data(), l.biases.data(),
+                        n, cur, maxStride, next);
+        std::swap(cur, next);
+    }
+
+    int numOutputs = getNumOutputs();
+    if (outputs)
+        for (int s = 0; s < n; s++)
+            std::copy_n(cur + s * maxStride, numOutputs, outputs + s * numOutputs);
+    return cur;
+}
+
+void MlpNetwork::forward(int n, const float *inputs, int inputStride, float *outputs) const
+{
+    if (layers.empty())
+        throw std::logic_error("MLP has no layers");
+    for (int s = 0; s < n; s += MLP_MAX_BATCH) {
+        int chunk = std::min(n - s, MLP_MAX_BATCH);
+        forwardChunk(chunk, inputs + s * inputStride, inputStride, outputs + s * getNumOutputs());
+    }
+}
+
+int MlpNetwork::argmax(const float *input) const
+{
+    if (layers.empty())
+        throw std::logic_error("MLP has no layers");
+    const float *y = forwardChunk(1, input, getNumInputs(), nullptr);
+    return std::max_element(y, y + getNumOutputs()) - y;
+}
+
+size_t MlpNetwork::getMemoryBytes() const
+{
+    size_t bytes = sizeof(*this) + layers.capacity() * sizeof(Layer);
+    for (const Layer& l : layers)
+        bytes += (l.weights.capacity() + l.biases.capacity()) * sizeof(float);
+    for (const auto& buffer : buffers)
+        bytes += buffer.capacity() * sizeof(float);
+    return bytes;
+}
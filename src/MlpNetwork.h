@@ -0,0 +1,88 @@
+//
+// Inference engine of small multilayer perceptrons for the SDN controller,
+// kept free of the simulation kernel like SDNRoutingCore.
+//
+// The weights come from the offline trainer (_train_ml_model.py --mlp) as a
+// text file:
+//
+//   MLP 1
+//   <number of layers>
+//   <inputs> <outputs> relu|linear     once per layer, followed by
+//   <outputs rows of inputs weights>
+//   <outputs biases>
+//
+// '#' starts a comment that runs to the end of the line.
+//
+
+#ifndef __MLPNETWORK_H
+#define __MLPNETWORK_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Samples evaluated together; larger batches are processed in chunks of this
+#define MLP_MAX_BATCH  32
+
+/**
+ * Fully connected float32 network: ReLU or linear layers, evaluated with AVX2
+ * and FMA where the CPU has them (checked at run time, no build flags needed)
+ * and with a scalar kernel otherwise. Weight rows and activations are padded
+ * to multiples of 8 floats, and the activation buffers are allocated for
+ * MLP_MAX_BATCH samples when a layer is added, so evaluation never allocates.
+ *
+ * A batch walks each weight row once for up to four samples at a time, so the
+ * weights are read from memory once per batch instead of once per sample.
+ */
+class MlpNetwork
+{
+  private:
+    struct Layer {
+        int inputs, outputs;
+        int inputStride;             // inputs rounded up to a multiple of 8
+        bool relu;
+        std::vector<float> weights;  // outputs rows of inputStride, zero-padded
+        std::vector<float> biases;
+    };
+    std::vector<Layer> layers;
+    bool simd;
+
+    // activations of the batch in progress, MLP_MAX_BATCH rows per buffer
+    mutable std::vector<float> buffers[2];
+    int maxStride = 0;
+
+    // returns the buffer with the outputs (rows maxStride apart); outputs may be nullptr
+    const float *forwardChunk(int n, const float *inputs, int inputStride, float *outputs) const;
+
+  public:
+    MlpNetwork();
+
+    /** Appends a layer; weights holds outputs rows of inputs values. */
+    void addLayer(int inputs, int outputs, bool relu, const std::vector<float>& weights,
+                  const std::vector<float>& biases);
+
+    /** Replaces the network with the one in fileName; throws std::runtime_error. */
+    void load(const std::string& fileName);
+
+    int getNumLayers() const { return layers.size(); }
+    int getNumInputs() const { return layers.empty() ? 0 : layers.front().inputs; }
+    int getNumOutputs() const { return layers.empty() ? 0 : layers.back().outputs; }
+
+    /** Whether the AVX2 kernel is used; it can be turned off (e.g. for comparisons). */
+    bool isSimd() const { return simd; }
+    void setSimd(bool enabled);
+    static bool cpuHasAvx2();
+
+    /**
+     * Evaluates n samples of getNumInputs() values each (rows inputStride
+     * apart) into outputs (getNumOutputs() values per sample, contiguous).
+     */
+    void forward(int n, const float *inputs, int inputStride, float *outputs) const;
+
+    /** Index of the largest output for one sample. */
+    int argmax(const float *input) const;
+
+    size_t getMemoryBytes() const;
+};
+
+#endif
@@ -150,7 +150,7 @@ void doParsimUnpacking(omnetpp::cCommBuffer *, T& t)
 
 }  // namespace omnetpp
 
-Register_Enum(PacketType, (PacketType::DATA, PacketType::DISCOVERY));
+Register_Enum(PacketType, (PacketType::DATA, PacketType::DISCOVERY, PacketType::QROUTING_PARAMS, PacketType::QROUTING_FEEDBACK));
 
 Register_Class(Packet)
 
@@ -185,6 +185,11 @@ void Packet::copy(const Packet& other)
     this->packetType = other.packetType;
     this->batteryLevel = other.batteryLevel;
     this->distanceToSDN = other.distanceToSDN;
+    this->lastHopSentAt = other.lastHopSentAt;
+    this->qEstimate = other.qEstimate;
+    this->qExploration = other.qExploration;
+    this->qEnergyWeight = other.qEnergyWeight;
+    this->sequenceNumber = other.sequenceNumber;
 }
 
 void Packet::parsimPack(omnetpp::cCommBuffer *b) const
@@ -198,6 +203,11 @@ void Packet::parsimPack(omnetpp::cCommBuffer *b) const
     doParsimPacking(b,this->packetType);
     doParsimPacking(b,this->batteryLevel);
     doParsimPacking(b,this->distanceToSDN);
+    doParsimPacking(b,this->lastHopSentAt);
+    doParsimPacking(b,this->qEstimate);
+    doParsimPacking(b,this->qExploration);
+    doParsimPacking(b,this->qEnergyWeight);
+    doParsimPacking(b,this->sequenceNumber);
 }
 
 void Packet::parsimUnpack(omnetpp::cCommBuffer *b)
@@ -211,6 +221,11 @@ void Packet::parsimUnpack(omnetpp::cCommBuffer *b)
     doParsimUnpacking(b,this->packetType);
     doParsimUnpacking(b,this->batteryLevel);
     doParsimUnpacking(b,this->distanceToSDN);
+    doParsimUnpacking(b,this->lastHopSentAt);
+    doParsimUnpacking(b,this->qEstimate);
+    doParsimUnpacking(b,this->qExploration);
+    doParsimUnpacking(b,this->qEnergyWeight);
+    doParsimUnpacking(b,this->sequenceNumber);
 }
 
 int Packet::getSrcAddr() const
@@ -293,6 +308,56 @@ void Packet::setDistanceToSDN(double distanceToSDN)
     this->distanceToSDN = distanceToSDN;
 }
 
+double Packet::getLastHopSentAt() const
+{
+    return this->lastHopSentAt;
+}
+
+void Packet::setLastHopSentAt(double lastHopSentAt)
+{
+    this->lastHopSentAt = lastHopSentAt;
+}
+
+double Packet::getQEstimate() const
+{
+    return this->qEstimate;
+}
+
+void Packet::setQEstimate(double qEstimate)
+{
+    this->qEstimate = qEstimate;
+}
+
+double Packet::getQExploration() const
+{
+    return this->qExploration;
+}
+
+void Packet::setQExploration(double qExploration)
+{
+    this->qExploration = qExploration;
+}
+
+double Packet::getQEnergyWeight() const
+{
+    return this->qEnergyWeight;
+}
+
+void Packet::setQEnergyWeight(double qEnergyWeight)
+{
+    this->qEnergyWeight = qEnergyWeight;
+}
+
+int Packet::getSequenceNumber() const
+{
+    return this->sequenceNumber;
+}
+
+void Packet::setSequenceNumber(int sequenceNumber)
+{
+    this->sequenceNumber = sequenceNumber;
+}
+
 class PacketDescriptor : public omnetpp::cClassDescriptor
 {
   private:
@@ -306,6 +371,11 @@ class PacketDescriptor : public omnetpp::cClassDescriptor
         FIELD_packetType,
         FIELD_batteryLevel,
         FIELD_distanceToSDN,
+        FIELD_lastHopSentAt,
+        FIELD_qEstimate,
+        FIELD_qExploration,
+        FIELD_qEnergyWeight,
+        FIELD_sequenceNumber,
     };
   public:
     PacketDescriptor();
@@ -372,7 +442,7 @@ const char *PacketDescriptor::getProperty(const char *propertyName) const
 int PacketDescriptor::getFieldCount() const
 {
     omnetpp::cClassDescriptor *base = getBaseClassDescriptor();
-    return base ? 8+base->getFieldCount() : 8;
+    return base ? 13+base->getFieldCount() : 13;
 }
 
 unsigned int PacketDescriptor::getFieldTypeFlags(int field) const
@@ -392,8 +462,13 @@ unsigned int PacketDescriptor::getFieldTypeFlags(int field) const
         FD_ISEDITABLE,    // FIELD_packetType
         FD_ISEDITABLE,    // FIELD_batteryLevel
         FD_ISEDITABLE,    // FIELD_distanceToSDN
+        FD_ISEDITABLE,    // FIELD_lastHopSentAt
+        FD_ISEDITABLE,    // FIELD_qEstimate
+        FD_ISEDITABLE,    // FIELD_qExploration
+        FD_ISEDITABLE,    // FIELD_qEnergyWeight
+        FD_ISEDITABLE,    // FIELD_sequenceNumber
     };
-    return (field >= 0 && field < 8) ? fieldTypeFlags[field] : 0;
+    return (field >= 0 && field < 13) ? fieldTypeFlags[field] : 0;
 }
 
 const char *PacketDescriptor::getFieldName(int field) const
@@ -413,8 +488,13 @@ const char *PacketDescriptor::getFieldName(int field) const
         "packetType",
         "batteryLevel",
         "distanceToSDN",
+        "lastHopSentAt",
+        "qEstimate",
+        "qExploration",
+        "qEnergyWeight",
+        "sequenceNumber",
     };
-    return (field >= 0 && field < 8) ? fieldNames[field] : nullptr;
+    return (field >= 0 && field < 13) ? fieldNames[field] : nullptr;
 }
 
 int PacketDescriptor::findField(const char *fieldName) const
@@ -429,6 +509,11 @@ int PacketDescriptor::findField(const char *fieldName) const
     if (strcmp(fieldName, "packetType") == 0) return baseIndex + 5;
     if (strcmp(fieldName, "batteryLevel") == 0) return baseIndex + 6;
     if (strcmp(fieldName, "distanceToSDN") == 0) return baseIndex + 7;
+    if (strcmp(fieldName, "lastHopSentAt") == 0) return baseIndex + 8;
+    if (strcmp(fieldName, "qEstimate") == 0) return baseIndex + 9;
+    if (strcmp(fieldName, "qExploration") == 0) return baseIndex + 10;
+    if (strcmp(fieldName, "qEnergyWeight") == 0) return baseIndex + 11;
+    if (strcmp(fieldName, "sequenceNumber") == 0) return baseIndex + 12;
     return base ? base->findField(fieldName) : -1;
 }
 
@@ -449,8 +534,13 @@ const char *PacketDescriptor::getFieldTypeString(int field) const
         "int",    // FIELD_packetType
         "double",    // FIELD_batteryLevel
         "double",    // FIELD_distanceToSDN
+        "double",    // FIELD_lastHopSentAt
+        "double",    // FIELD_qEstimate
+        "double",    // FIELD_qExploration
+        "double",    // FIELD_qEnergyWeight
+        "int",    // FIELD_sequenceNumber
     };
-    return (field >= 0 && field < 8) ? fieldTypeStrings[field] : nullptr;
+    return (field >= 0 && field < 13) ? fieldTypeStrings[field] : nullptr;
 }
 
 const char **PacketDescriptor::getFieldPropertyNames(int field) const
@@ -494,6 +584,26 @@ const char **PacketDescriptor::getFieldPropertyNames(int field) const
             static const char *names[] = { "packetData",  nullptr };
             return names;
         }
+        case FIELD_lastHopSentAt: {
+            static const char *names[] = { "packetData",  nullptr };
+            return names;
+        }
+        case FIELD_qEstimate: {
+            static const char *names[] = { "packetData",  nullptr };
+            return names;
+        }
+        case FIELD_qExploration: {
+            static const char *names[] = { "packetData",  nullptr };
+            return names;
+        }
+        case FIELD_qEnergyWeight: {
+            static const char *names[] = { "packetData",  nullptr };
+            return names;
+        }
+        case FIELD_sequenceNumber: {
+            static const char *names[] = { "packetData",  nullptr };
+            return names;
+        }
         default: return nullptr;
     }
 }
@@ -531,6 +641,21 @@ const char *PacketDescriptor::getFieldProperty(int field, const char *propertyNa
         case FIELD_distanceToSDN:
             if (!strcmp(propertyName, "packetData")) return "";
             return nullptr;
+        case FIELD_lastHopSentAt:
+            if (!strcmp(propertyName, "packetData")) return "";
+            return nullptr;
+        case FIELD_qEstimate:
+            if (!strcmp(propertyName, "packetData")) return "";
+            return nullptr;
+        case FIELD_qExploration:
+            if (!strcmp(propertyName, "packetData")) return "";
+            return nullptr;
+        case FIELD_qEnergyWeight:
+            if (!strcmp(propertyName, "packetData")) return "";
+            return nullptr;
+        case FIELD_sequenceNumber:
+            if (!strcmp(propertyName, "packetData")) return "";
+            return nullptr;
         default: return nullptr;
     }
 }
@@ -597,6 +722,11 @@ std::string PacketDescriptor::getFieldValueAsString(omnetpp::any_ptr object, int
         case FIELD_packetType: return long2string(pp->getPacketType());
         case FIELD_batteryLevel: return double2string(pp->getBatteryLevel());
         case FIELD_distanceToSDN: return double2string(pp->getDistanceToSDN());
+        case FIELD_lastHopSentAt: return double2string(pp->getLastHopSentAt());
+        case FIELD_qEstimate: return double2string(pp->getQEstimate());
+        case FIELD_qExploration: return double2string(pp->getQExploration());
+        case FIELD_qEnergyWeight: return double2string(pp->getQEnergyWeight());
+        case FIELD_sequenceNumber: return long2string(pp->getSequenceNumber());
         default: return "";
     }
 }
@@ -621,6 +751,11 @@ void PacketDescriptor::setFieldValueAsString(omnetpp::any_ptr object, int field,
         case FIELD_packetType: pp->setPacketType(string2long(value)); break;
         case FIELD_batteryLevel: pp->setBatteryLevel(string2double(value)); break;
         case FIELD_distanceToSDN: pp->setDistanceToSDN(string2double(value)); break;
+        case FIELD_lastHopSentAt: pp->setLastHopSentAt(string2double(value)); break;
+        case FIELD_qEstimate: pp->setQEstimate(string2double(value)); break;
+        case FIELD_qExploration: pp->setQExploration(string2double(value)); break;
+        case FIELD_qEnergyWeight: pp->setQEnergyWeight(string2double(value)); break;
+        case FIELD_sequenceNumber: pp->setSequenceNumber(string2long(value)); break;
         default: throw omnetpp::cRuntimeError("Cannot set field %d of class 'Packet'", field);
     }
 }
@@ -643,6 +778,11 @@ omnetpp::cValue PacketDescriptor::getFieldValue(omnetpp::any_ptr object, int fie
         case FIELD_packetType: return pp->getPacketType();
         case FIELD_batteryLevel: return pp->getBatteryLevel();
         case FIELD_distanceToSDN: return pp->getDistanceToSDN();
+        case FIELD_lastHopSentAt: return pp->getLastHopSentAt();
+        case FIELD_qEstimate: return pp->getQEstimate();
+        case FIELD_qExploration: return pp->getQExploration();
+        case FIELD_qEnergyWeight: return pp->getQEnergyWeight();
+        case FIELD_sequenceNumber: return pp->getSequenceNumber();
         default: throw omnetpp::cRuntimeError("Cannot return field %d of class 'Packet' as cValue -- field index out of range?", field);
     }
 }
@@ -667,6 +807,11 @@ void PacketDescriptor::setFieldValue(omnetpp::any_ptr object, int field, int i,
         case FIELD_packetType: pp->setPacketType(omnetpp::checked_int_cast<int>(value.intValue())); break;
         case FIELD_batteryLevel: pp->setBatteryLevel(value.doubleValue()); break;
         case FIELD_distanceToSDN: pp->setDistanceToSDN(value.doubleValue()); break;
+        case FIELD_lastHopSentAt: pp->setLastHopSentAt(value.doubleValue()); break;
+        case FIELD_qEstimate: pp->setQEstimate(value.doubleValue()); break;
+        case FIELD_qExploration: pp->setQExploration(value.doubleValue()); break;
+        case FIELD_qEnergyWeight: pp->setQEnergyWeight(value.doubleValue()); break;
+        case FIELD_sequenceNumber: pp->setSequenceNumber(omnetpp::checked_int_cast<int>(value.intValue())); break;
         default: throw omnetpp::cRuntimeError("Cannot set field %d of class 'Packet'", field);
     }
 }
@@ -24,19 +24,23 @@ class Packet;
  * {
  *     DATA = 0;
  *     DISCOVERY = 1;
+ *     QROUTING_PARAMS = 2;
+ *     QROUTING_FEEDBACK = 3;
  * }
  * </pre>
  */
 enum PacketType {
     DATA = 0,
-    DISCOVERY = 1
+    DISCOVERY = 1,
+    QROUTING_PARAMS = 2,
+    QROUTING_FEEDBACK = 3
 };
 
 inline void doParsimPacking(omnetpp::cCommBuffer *b, const PacketType& e) { b->pack(static_cast<int>(e)); }
 inline void doParsimUnpacking(omnetpp::cCommBuffer *b, PacketType& e) { int n; b->unpack(n); e = static_cast<PacketType>(n); }
 
 /**
- * Class generated from <tt>Packet.msg:15</tt> by opp_msgtool.
+ * Class generated from <tt>Packet.msg:17</tt> by opp_msgtool.
  * <pre>
  * //
  * // Represents a packet in the network with SDN capabilities
@@ -50,9 +54,18 @@ inline void doParsimUnpacking(omnetpp::cCommBuffer *b, PacketType& e) { int n; b
  *     double pathCost \@packetData;
  * 
  *     // SDN Discovery Fields
- *     int packetType \@packetData = 0;  // 0=DATA, 1=DISCOVERY
+ *     int packetType \@packetData = 0;  // PacketType
  *     double batteryLevel \@packetData = 100.0;  // Node battery level (%)
  *     double distanceToSDN \@packetData = 0.0;   // Distance to SDN controller
+ * 
+ *     // Distributed Q-routing (see Routing.ned)
+ *     double lastHopSentAt \@packetData = -1;    // DATA: when the previous Q-routing hop sent it [s]
+ *     double qEstimate \@packetData = 0.0;       // QROUTING_FEEDBACK: next hop's cost to destAddr [s]
+ *     double qExploration \@packetData = 0.0;    // QROUTING_PARAMS: exploration rate
+ *     double qEnergyWeight \@packetData = 0.0;   // QROUTING_PARAMS: cost of an empty battery [s]
+ * 
+ *     // Decision replay (see SDNController_ML.ned)
+ *     int sequenceNumber \@packetData;           // DATA: number of the packet at its source app
  * }
  * </pre>
  */
@@ -67,6 +80,11 @@ class Packet : public ::omnetpp::cPacket
     int packetType = 0;
     double batteryLevel = 100.0;
     double distanceToSDN = 0.0;
+    double lastHopSentAt = -1;
+    double qEstimate = 0.0;
+    double qExploration = 0.0;
+    double qEnergyWeight = 0.0;
+    int sequenceNumber = 0;
 
   private:
     void copy(const Packet& other);
@@ -106,6 +124,21 @@ class Packet : public ::omnetpp::cPacket
 
     virtual double getDistanceToSDN() const;
     virtual void setDistanceToSDN(double distanceToSDN);
+
+    virtual double getLastHopSentAt() const;
+    virtual void setLastHopSentAt(double lastHopSentAt);
+
+    virtual double getQEstimate() const;
+    virtual void setQEstimate(double qEstimate);
+
+    virtual double getQExploration() const;
+    virtual void setQExploration(double qExploration);
+
+    virtual double getQEnergyWeight() const;
+    virtual void setQEnergyWeight(double qEnergyWeight);
+
+    virtual int getSequenceNumber() const;
+    virtual void setSequenceNumber(int sequenceNumber);
 };
 
 inline void doParsimPacking(omnetpp::cCommBuffer *b, const Packet& obj) {obj.parsimPack(b);}
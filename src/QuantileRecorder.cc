@@ -0,0 +1,77 @@
+//
+// Result recorder for tail quantiles (record=quantiles)
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <omnetpp.h>
+#include "QuantileSketch.h"
+
+using namespace omnetpp;
+
+/**
+ * Keeps a DDSketch of the statistic and records selected quantiles as
+ * scalars named <statistic>:p<percent> (e.g. endToEndDelay:p99) in constant
+ * memory, so tail latencies no longer require vector recording.
+ *
+ * Optional keys of the @statistic property:
+ *   quantiles=0.5,0.9,0.95,0.99,0.999   quantiles to record (this is the default)
+ *   quantileAccuracy=0.01               relative accuracy of the sketch
+ */
+class QuantileRecorder : public cNumericResultRecorder
+{
+  protected:
+    QuantileSketch *sketch = nullptr;
+    std::vector<double> quantiles;
+    const char *unit = nullptr;
+
+  protected:
+    virtual void collect(simtime_t_cref t, double value, cObject *details) override;
+
+  public:
+    virtual ~QuantileRecorder() { delete sketch; }
+    virtual void init(Context *ctx) override;
+    virtual void finish(cResultFilter *prev) override;
+};
+
+Register_ResultRecorder("quantiles", QuantileRecorder);
+
+void QuantileRecorder::init(Context *ctx)
+{
+    cNumericResultRecorder::init(ctx);
+
+    double accuracy = 0.01;
+    cProperty *property = getComponent()->getProperties()->get("statistic", getStatisticName());
+    if (property) {
+        unit = property->getValue("unit");
+        for (int i = 0; i < property->getNumValues("quantiles"); i++)
+            quantiles.push_back(atof(property->getValue("quantiles", i)));
+        if (property->getNumValues("quantileAccuracy") > 0)
+            accuracy = atof(property->getValue("quantileAccuracy"));
+    }
+    if (quantiles.empty())
+        quantiles = {0.5, 0.9, 0.95, 0.99, 0.999};
+    for (double q : quantiles)
+        if (q < 0 || q > 1)
+            throw cRuntimeError("QuantileRecorder: quantile %g of statistic '%s' is outside [0,1]", q, getStatisticName());
+    if (accuracy <= 0 || accuracy >= 1)
+        throw cRuntimeError("QuantileRecorder: quantileAccuracy of statistic '%s' must be in (0,1)", getStatisticName());
+
+    sketch = new QuantileSketch(accuracy);
+}
+
+void QuantileRecorder::collect(simtime_t_cref t, double value, cObject *details)
+{
+    sketch->collect(value);
+}
+
+void QuantileRecorder::finish(cResultFilter *prev)
+{
+    for (double q : quantiles) {
+        char name[32];
+        snprintf(name, sizeof(name), ":p%g", q * 100);
+        getComponent()->recordScalar((std::string(getStatisticName()) + name).c_str(), sketch->getQuantile(q), unit);
+    }
+}
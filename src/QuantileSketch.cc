@@ -0,0 +1,151 @@
+//
+// DDSketch quantile sketch (see QuantileSketch.h)
+//
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "QuantileSketch.h"
+
+void QuantileSketch::Store::add(int index, uint64_t n, size_t maxBins)
+{
+    if (counts.empty()) {
+        counts.push_back(0);
+        offset = index;
+    }
+    else if (index < offset) {
+        // below the lowest bucket: grow downwards, or fold into the lowest one
+        // if the store is already full
+        size_t grow = offset - index;
+        if (counts.size() + grow > maxBins)
+            index = offset;
+        else {
+            counts.insert(counts.begin(), grow, 0);
+            offset = index;
+        }
+    }
+    else if (index >= offset + (int)counts.size()) {
+        counts.resize(index - offset + 1, 0);
+    }
+    counts[index - offset] += n;
+    total += n;
+    collapse(maxBins);
+}
+
+void QuantileSketch::Store::collapse(size_t maxBins)
+{
+    if (counts.size() <= maxBins)
+        return;
+    size_t excess = counts.size() - maxBins;
+    uint64_t folded = 0;
+    for (size_t i = 0; i <= excess; i++)
+        folded += counts[i];
+    counts.erase(counts.begin(), counts.begin() + excess);
+    counts[0] = folded;
+    offset += excess;
+}
+
+QuantileSketch::QuantileSketch(double relativeAccuracy, size_t maxBins, double minIndexable)
+    : relativeAccuracy(relativeAccuracy), minIndexable(minIndexable), maxBins(maxBins)
+{
+    if (relativeAccuracy <= 0 || relativeAccuracy >= 1)
+        throw std::invalid_argument("QuantileSketch: relative accuracy must be in (0,1)");
+    gamma = (1 + relativeAccuracy) / (1 - relativeAccuracy);
+    logGamma = std::log(gamma);
+}
+
+int QuantileSketch::indexOf(double absValue) const
+{
+    return (int)std::ceil(std::log(absValue) / logGamma);
+}
+
+double QuantileSketch::valueOf(int index) const
+{
+    // midpoint (in relative terms) of (gamma^(i-1), gamma^i]
+    return 2 * std::pow(gamma, index) / (gamma + 1);
+}
+
+void QuantileSketch::collect(double value)
+{
+    if (std::isnan(value))
+        return;
+    if (value > minIndexable)
+        positive.add(indexOf(value), 1, maxBins);
+    else if (value < -minIndexable)
+        negative.add(indexOf(-value), 1, maxBins);
+    else
+        zeroCount++;
+
+    min = count == 0 ? value : std::min(min, value);
+    max = count == 0 ? value : std::max(max, value);
+    count++;
+    sum += value;
+}
+
+void QuantileSketch::merge(const QuantileSketch& other)
+{
+    if (other.count == 0)
+        return;
+    if (std::fabs(other.gamma - gamma) > 1e-12)
+        throw std::invalid_argument("QuantileSketch: cannot merge sketches of different accuracy");
+
+    for (size_t i = 0; i < other.positive.counts.size(); i++)
+        if (other.positive.counts[i])
+            positive.add(other.positive.offset + (int)i, other.positive.counts[i], maxBins);
+    for (size_t i = 0; i < other.negative.counts.size(); i++)
+        if (other.negative.counts[i])
+            negative.add(other.negative.offset + (int)i, other.negative.counts[i], maxBins);
+    zeroCount += other.zeroCount;
+
+    min = count == 0 ? other.min : std::min(min, other.min);
+    max = count == 0 ? other.max : std::max(max, other.max);
+    count += other.count;
+    sum += other.sum;
+}
+
+void QuantileSketch::clear()
+{
+    positive = Store();
+    negative = Store();
+    zeroCount = count = 0;
+    sum = min = max = 0;
+}
+
+double QuantileSketch::getQuantile(double q) const
+{
+    if (count == 0)
+        return 0;
+    if (q <= 0)
+        return min;
+    if (q >= 1)
+        return max;
+
+    // rank of the requested sample, counted from the most negative value
+    uint64_t rank = (uint64_t)(q * (count - 1));
+    double result;
+    if (rank < negative.total) {
+        uint64_t cumulative = 0;
+        size_t i = negative.counts.size();
+        while (i > 0) {
+            cumulative += negative.counts[--i];
+            if (cumulative > rank)
+                break;
+        }
+        result = -valueOf(negative.offset + (int)i);
+    }
+    else if (rank < negative.total + zeroCount) {
+        result = 0;
+    }
+    else {
+        uint64_t cumulative = negative.total + zeroCount;
+        size_t i = 0;
+        for (; i < positive.counts.size(); i++) {
+            cumulative += positive.counts[i];
+            if (cumulative > rank)
+                break;
+        }
+        result = valueOf(positive.offset + (int)std::min(i, positive.counts.size() - 1));
+    }
+    // the bucket estimate may lie slightly outside the observed range
+    return std::max(min, std::min(result, max));
+}
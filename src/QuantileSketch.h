@@ -0,0 +1,69 @@
+//
+// DDSketch quantile sketch with bounded memory.
+//
+
+#ifndef __QUANTILESKETCH_H
+#define __QUANTILESKETCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Mergeable quantile sketch after DDSketch (Masson et al., VLDB 2019).
+ * Values are counted in logarithmic buckets of ratio gamma = (1+a)/(1-a),
+ * so every quantile is returned within a relative error of a (the
+ * relativeAccuracy). Values with |x| below minIndexable share one zero
+ * bucket. When a store exceeds maxBins buckets its lowest buckets are
+ * collapsed, which only affects quantiles of the smallest magnitudes.
+ * Sketches with the same accuracy can be merged.
+ */
+class QuantileSketch
+{
+  private:
+    /** Dense run of bucket counters starting at bucket index offset. */
+    struct Store {
+        std::vector<uint64_t> counts;
+        int offset = 0;
+        uint64_t total = 0;
+
+        void add(int index, uint64_t n, size_t maxBins);
+        void collapse(size_t maxBins);
+    };
+
+    double relativeAccuracy;
+    double gamma;
+    double logGamma;
+    double minIndexable;
+    size_t maxBins;
+
+    Store positive;
+    Store negative;     // indexed by |x|
+    uint64_t zeroCount = 0;
+    uint64_t count = 0;
+    double sum = 0;
+    double min = 0;
+    double max = 0;
+
+    int indexOf(double absValue) const;
+    double valueOf(int index) const;
+
+  public:
+    explicit QuantileSketch(double relativeAccuracy = 0.01, size_t maxBins = 2048, double minIndexable = 1e-12);
+
+    void collect(double value);
+    void merge(const QuantileSketch& other);
+    void clear();
+
+    uint64_t getCount() const { return count; }
+    double getSum() const { return sum; }
+    double getMin() const { return min; }
+    double getMax() const { return max; }
+    double getRelativeAccuracy() const { return relativeAccuracy; }
+    size_t getNumBins() const { return positive.counts.size() + negative.counts.size(); }
+
+    /** Value at quantile q in [0,1], within the relative accuracy; 0 if empty. */
+    double getQuantile(double q) const;
+};
+
+#endif
@@ -7,8 +7,11 @@
 #endif
 
 #include <map>
+#include <vector>
 #include <omnetpp.h>
 #include "Packet_m.h"
+#include "SDNRoutingCore.h"
+#include "HandlerProfiler.h"
 
 using namespace omnetpp;
 
@@ -23,8 +26,8 @@ class Routing : public cSimpleModule
     double batteryLevel;
     int sdnAddress;
 
-    typedef std::map<int, int> RoutingTable;
     RoutingTable rtable;
+    bool topologyRoutes;  // shortest paths to all nodes, else neighbours plus the default route
 
     cMessage *discoveryTimer;
     bool sendDiscovery;
@@ -42,6 +45,25 @@ class Routing : public cSimpleModule
     // (existing signals, unchanged in meaning)
     simsignal_t dropSignal;
     simsignal_t outputIfSignal;
+    simsignal_t batteryLevelSignal;
+
+    // Distributed Q-routing (Boyan & Littman): every node estimates, per
+    // destination and output gate, the time a packet still needs to arrive
+    // and learns it from the estimate its next hop sends back. One row of
+    // gates per destination, created when the first packet for it arrives.
+    bool qRouting;
+    double qLearningRate;
+    double qInitialEstimate;
+    double qDropPenalty;
+    int qMaxHops;
+    double qExploration = 0;      // set by the controller (QROUTING_PARAMS)
+    double qEnergyWeight = 0;     // ditto
+    std::vector<int> gatePeers;   // gate index -> neighbour address, -1 if none
+    std::map<int, int> qRows;     // destination -> offset of its row in qTable
+    std::vector<float> qTable;
+    std::vector<int> qCandidates;  // scratch of qSelectGate()
+    long qFeedbackReceived = 0;
+    long qLoopDrops = 0;
 
   protected:
     virtual void initialize() override;
@@ -52,6 +74,18 @@ class Routing : public cSimpleModule
     double calculateDistanceToSDN();
     int getGateToSDN();
 
+    // Routing table construction: direct neighbours are resolved from our own
+    // ports (safe under parsim), multi-hop routes need the global cTopology.
+    void buildNeighborRoutes();
+    void buildTopologyRoutes();
+    bool isParallelRun() const;
+
+    float *qRow(int destAddr);
+    int qSelectGate(int destAddr, int arrivalGate, bool explore);
+    void qSendFeedback(Packet *pkt, int arrivalGate);
+    void qForward(Packet *pkt, int arrivalGate);
+    bool handleQRoutingPacket(Packet *pkt);
+
     // CHANGE 2: new helpers for the battery model
     void processBatteryTimer();                           // periodic FSM update
     void updateBatteryOnActivity(double minDrain, double maxDrain); // per-packet drain
@@ -71,9 +105,11 @@ Routing::~Routing()
 
 void Routing::initialize()
 {
+    PROFILE_HANDLER_INIT();
+
     myAddress    = getParentModule()->par("address");
     batteryLevel = 100.0;
-    sdnAddress   = 0;  // SDN controller address is always 0
+    sdnAddress   = par("controllerAddress");  // 0 unless the node sits in a controller domain
 
     // CHANGE 4: initialise FSM and start periodic battery timer
     batteryFsm.setName("batteryFsm");
@@ -86,16 +122,83 @@ void Routing::initialize()
     discoveryInterval = par("discoveryInterval");
     dropSignal        = registerSignal("drop");
     outputIfSignal    = registerSignal("outputIf");
+    batteryLevelSignal = registerSignal("batteryLevel");
+
+    qRouting         = par("qRouting");
+    qLearningRate    = par("qLearningRate");
+    qInitialEstimate = par("qInitialEstimate");
+    qDropPenalty     = par("qDropPenalty");
+    qMaxHops         = par("qMaxHops");
+
+    // Routing table build. Under parsim a cTopology only sees the modules
+    // of the local partition, so there we stay with the neighbour routes and
+    // send everything else through the controller of our domain.
+    topologyRoutes = par("topologyRoutes");
+    if (topologyRoutes && isParallelRun())
+        throw cRuntimeError("Routing: topologyRoutes needs the whole network, set it to false under parsim");
+    buildNeighborRoutes();
+    if (topologyRoutes)
+        buildTopologyRoutes();
+
+    EV_INFO << "Node " << myAddress << ": Routing table has "
+            << rtable.size() << " entries\n";
+
+    // Verify we have a route to SDN (unchanged)
+    if (rtable.find(sdnAddress) != rtable.end()) {
+        EV_INFO << "Node " << myAddress << ": Route to SDN controller FOUND via gate "
+                << rtable[sdnAddress] << "\n";
+    }
+    else {
+        EV_WARN << "Node " << myAddress << ": WARNING - No route to SDN controller!\n";
+    }
+
+    // Discovery timer setup (same logic)
+    if (sendDiscovery && myAddress != sdnAddress) {
+        discoveryTimer = new cMessage("discoveryTimer");
+        scheduleAt(simTime() + uniform(0.5, 2.0), discoveryTimer);
+        EV_DETAIL << "Node " << myAddress << ": Discovery scheduled\n";
+    }
+    else {
+        discoveryTimer = nullptr;
+    }
+}
+
+bool Routing::isParallelRun() const
+{
+    return getEnvir()->getParsimNumPartitions() > 1;
+}
+
+void Routing::buildNeighborRoutes()
+{
+    cModule *node = getParentModule();
+    gatePeers.assign(node->gateSize("port"), -1);
+    for (int i = 0; i < node->gateSize("port"); i++) {
+        // port$o[i] is linked to the peer's port$i; the peer may be a
+        // placeholder in another partition, but its parameters are still set.
+        cGate *peerGate = node->gate("port$o", i)->getNextGate();
+        if (!peerGate || !peerGate->getOwnerModule()->hasPar("address"))
+            continue;
+
+        int peerAddr = peerGate->getOwnerModule()->par("address");
+        gatePeers[i] = peerAddr;
+        if (rtable.find(peerAddr) == rtable.end())
+            rtable[peerAddr] = i;
+    }
+
+    EV_DETAIL << "Node " << myAddress << ": " << rtable.size()
+              << " direct neighbours\n";
+}
 
-    // Routing table build (same logic as before, just formatted)
+void Routing::buildTopologyRoutes()
+{
     cTopology *topo = new cTopology("topo");
     std::vector<std::string> nedTypes;
     nedTypes.push_back("modelingproject4sdn.Node");
     nedTypes.push_back("modelingproject4sdn.SDNNode_ML");
     topo->extractByNedTypeName(nedTypes);
 
-    EV << "Node " << myAddress << ": cTopology found "
-       << topo->getNumNodes() << " nodes\n";
+    EV_DETAIL << "Node " << myAddress << ": cTopology found "
+              << topo->getNumNodes() << " nodes\n";
 
     cTopology::Node *thisNode = topo->getNodeFor(getParentModule());
     if (thisNode) {
@@ -112,33 +215,11 @@ void Routing::initialize()
 
             int destAddr = topo->getNode(i)->getModule()->par("address");
             rtable[destAddr] = gateIndex;
-            EV << "Node " << myAddress << ": route to "
-               << destAddr << " via gate " << gateIndex << "\n";
+            EV_DETAIL << "Node " << myAddress << ": route to "
+                      << destAddr << " via gate " << gateIndex << "\n";
         }
     }
     delete topo;
-
-    EV << "Node " << myAddress << ": Routing table has "
-       << rtable.size() << " entries\n";
-
-    // Verify we have a route to SDN (unchanged)
-    if (rtable.find(sdnAddress) != rtable.end()) {
-        EV << "Node " << myAddress << ": Route to SDN controller FOUND via gate "
-           << rtable[sdnAddress] << "\n";
-    }
-    else {
-        EV << "Node " << myAddress << ": WARNING - No route to SDN controller!\n";
-    }
-
-    // Discovery timer setup (same logic)
-    if (sendDiscovery && myAddress != sdnAddress) {
-        discoveryTimer = new cMessage("discoveryTimer");
-        scheduleAt(simTime() + uniform(0.5, 2.0), discoveryTimer);
-        EV << "Node " << myAddress << ": Discovery scheduled\n";
-    }
-    else {
-        discoveryTimer = nullptr;
-    }
 }
 
 int Routing::getGateToSDN()
@@ -151,6 +232,8 @@ int Routing::getGateToSDN()
 
 void Routing::handleMessage(cMessage *msg)
 {
+    PROFILE_HANDLER(msg);
+
     if (msg == discoveryTimer) {
         // periodic discovery (as before)
         sendDiscoveryPacket();
@@ -166,15 +249,15 @@ void Routing::handleMessage(cMessage *msg)
 
         // if node is not ACTIVE, drop local traffic
         if (batteryFsm.getState() != BAT_ACTIVE) {
-            EV << "Node " << myAddress
-               << ": battery not available for transmission, dropping local packet\n";
+            EV_DEBUG << "Node " << myAddress
+                     << ": battery not available for transmission, dropping local packet\n";
             delete pkt;
             return;
         }
 
         int destAddr = pkt->getDestAddr();
-        EV << "Node " << myAddress << ": Sending DATA packet to "
-           << destAddr << " via SDN controller\n";
+        EV_DEBUG << "Node " << myAddress << ": Sending DATA packet to "
+                 << destAddr << " via SDN controller\n";
 
         // activity-based battery drain (was inline uniform() before)
         updateBatteryOnActivity(0.05, 0.2);
@@ -184,16 +267,22 @@ void Routing::handleMessage(cMessage *msg)
         pkt->setHopCount(pkt->getHopCount() + 1);
         pkt->setPathDelay(pkt->getPathDelay() + uniform(0.001, 0.005));
 
+        // Q-routing: the nodes route the traffic among themselves
+        if (qRouting && destAddr != sdnAddress) {
+            qForward(pkt, -1);
+            return;
+        }
+
         int sdnGate = getGateToSDN();
         if (sdnGate >= 0) {
-            EV << "Node " << myAddress
-               << ": Forwarding to SDN via gate " << sdnGate << "\n";
+            EV_TRACE << "Node " << myAddress
+                     << ": Forwarding to SDN via gate " << sdnGate << "\n";
             emit(outputIfSignal, sdnGate);
             send(pkt, "out", sdnGate);
         }
         else {
-            EV << "Node " << myAddress
-               << ": ERROR - No route to SDN controller, dropping\n";
+            EV_WARN << "Node " << myAddress
+                    << ": ERROR - No route to SDN controller, dropping\n";
             emit(dropSignal, (long)pkt->getByteLength());
             delete pkt;
         }
@@ -201,27 +290,35 @@ void Routing::handleMessage(cMessage *msg)
     // CHANGE 7: transit traffic also checks battery FSM and uses shared drain helper
     else {
         Packet *pkt = check_and_cast<Packet *>(msg);
+        if (handleQRoutingPacket(pkt))
+            return;
+
         int destAddr = pkt->getDestAddr();
+        int arrivalGate = pkt->getArrivalGate()->getIndex();
+        bool qData = qRouting && pkt->getPacketType() == DATA && destAddr != sdnAddress;
+
+        EV_DEBUG << "Node " << myAddress
+                 << ": Received packet destined to " << destAddr << "\n";
 
-        EV << "Node " << myAddress
-           << ": Received packet destined to " << destAddr << "\n";
+        if (qData)
+            qSendFeedback(pkt, arrivalGate);
 
         if (destAddr == myAddress) {
             // simplified: we now always deliver to localOut
             // (old code special-cased DISCOVERY packets)
-            EV << "Node " << myAddress << ": Packet arrived at destination\n";
+            EV_TRACE << "Node " << myAddress << ": Packet arrived at destination\n";
             send(pkt, "localOut");
         }
         else {
             if (batteryFsm.getState() != BAT_ACTIVE) {
-                EV << "Node " << myAddress
-                   << ": battery not available for forwarding, dropping transit packet\n";
+                EV_DEBUG << "Node " << myAddress
+                         << ": battery not available for forwarding, dropping transit packet\n";
                 delete pkt;
                 return;
             }
 
-            EV << "Node " << myAddress
-               << ": Forwarding packet to " << destAddr << "\n";
+            EV_TRACE << "Node " << myAddress
+                     << ": Forwarding packet to " << destAddr << "\n";
 
             // smaller drain for transit forwarding
             updateBatteryOnActivity(0.02, 0.1);
@@ -230,15 +327,22 @@ void Routing::handleMessage(cMessage *msg)
             pkt->setHopCount(pkt->getHopCount() + 1);
             pkt->setPathDelay(pkt->getPathDelay() + uniform(0.001, 0.005));
 
+            if (qData) {
+                qForward(pkt, arrivalGate);
+                return;
+            }
+
             auto it = rtable.find(destAddr);
+            if (it == rtable.end() && !topologyRoutes)
+                it = rtable.find(sdnAddress);  // default route: let the controller decide
             if (it != rtable.end()) {
                 int outGateIndex = it->second;
                 emit(outputIfSignal, outGateIndex);
                 send(pkt, "out", outGateIndex);
             }
             else {
-                EV << "Node " << myAddress
-                   << ": No route to " << destAddr << ", dropping\n";
+                EV_WARN << "Node " << myAddress
+                        << ": No route to " << destAddr << ", dropping\n";
                 emit(dropSignal, (long)pkt->getByteLength());
                 delete pkt;
             }
@@ -246,18 +350,155 @@ void Routing::handleMessage(cMessage *msg)
     }
 }
 
+bool Routing::handleQRoutingPacket(Packet *pkt)
+{
+    switch (pkt->getPacketType()) {
+        case QROUTING_FEEDBACK: {
+            // the neighbour behind the arrival gate reports its remaining time to destAddr
+            if (qRouting) {
+                float& q = qRow(pkt->getDestAddr())[pkt->getArrivalGate()->getIndex()];
+                q += qLearningRate * (pkt->getQEstimate() - q);
+                qFeedbackReceived++;
+            }
+            delete pkt;
+            return true;
+        }
+        case QROUTING_PARAMS:
+            if (pkt->getDestAddr() != myAddress)
+                return false;  // in transit, forwarded like any other packet
+            qExploration = pkt->getQExploration();
+            qEnergyWeight = pkt->getQEnergyWeight();
+            EV_DETAIL << "Node " << myAddress << ": Q-routing exploration " << qExploration
+                      << ", energy weight " << qEnergyWeight << "s\n";
+            delete pkt;
+            return true;
+        default:
+            return false;
+    }
+}
+
+float *Routing::qRow(int destAddr)
+{
+    auto it = qRows.find(destAddr);
+    if (it == qRows.end()) {
+        // start from the shortest path: its gate is assumed twice as fast as the others
+        auto route = rtable.find(destAddr);
+        int offset = qTable.size();
+        for (int i = 0; i < (int)gatePeers.size(); i++) {
+            bool shortest = route != rtable.end() && route->second == i;
+            qTable.push_back(shortest ? qInitialEstimate : 2 * qInitialEstimate);
+        }
+        it = qRows.insert(std::make_pair(destAddr, offset)).first;
+    }
+    return &qTable[it->second];
+}
+
+int Routing::qSelectGate(int destAddr, int arrivalGate, bool explore)
+{
+    // a neighbouring destination is always reached directly
+    auto route = rtable.find(destAddr);
+    if (route != rtable.end() && gatePeers[route->second] == destAddr)
+        return route->second;
+
+    // gates to other nodes (the controller takes no part), not back where the
+    // packet came from unless that is the only way out
+    qCandidates.clear();
+    for (int i = 0; i < (int)gatePeers.size(); i++)
+        if (gatePeers[i] >= 0 && gatePeers[i] != sdnAddress && i != arrivalGate)
+            qCandidates.push_back(i);
+    if (qCandidates.empty() && arrivalGate >= 0 && gatePeers[arrivalGate] >= 0 && gatePeers[arrivalGate] != sdnAddress)
+        qCandidates.push_back(arrivalGate);
+    if (qCandidates.empty())
+        return -1;
+
+    if (explore && qExploration > 0 && uniform(0, 1) < qExploration)
+        return qCandidates[intuniform(0, qCandidates.size() - 1)];
+
+    const float *row = qRow(destAddr);
+    int best = qCandidates[0];
+    for (int gate : qCandidates)
+        if (row[gate] < row[best])
+            best = gate;
+    return best;
+}
+
+void Routing::qSendFeedback(Packet *pkt, int arrivalGate)
+{
+    // only packets a neighbour has routed by its Q table are answered
+    if (pkt->getLastHopSentAt() < 0 || gatePeers[arrivalGate] < 0 || gatePeers[arrivalGate] == sdnAddress)
+        return;
+
+    int destAddr = pkt->getDestAddr();
+    double estimate = simTime().dbl() - pkt->getLastHopSentAt();
+    if (destAddr != myAddress) {
+        if (batteryFsm.getState() != BAT_ACTIVE || pkt->getHopCount() >= qMaxHops) {
+            estimate += qDropPenalty;  // the packet gets dropped here
+        }
+        else {
+            // time still needed from here, plus the price of draining this battery
+            int gate = qSelectGate(destAddr, arrivalGate, false);
+            estimate += (gate >= 0 ? qRow(destAddr)[gate] : qDropPenalty)
+                        + qEnergyWeight * (1 - batteryLevel / 100.0);
+        }
+    }
+
+    Packet *feedback = new Packet("qfeedback");
+    feedback->setPacketType(QROUTING_FEEDBACK);
+    feedback->setSrcAddr(myAddress);
+    feedback->setDestAddr(destAddr);
+    feedback->setQEstimate(estimate);
+    feedback->setByteLength(16);
+    send(feedback, "out", arrivalGate);
+}
+
+void Routing::qForward(Packet *pkt, int arrivalGate)
+{
+    int destAddr = pkt->getDestAddr();
+    if (pkt->getHopCount() > qMaxHops) {
+        EV_WARN << "Node " << myAddress << ": Packet to " << destAddr
+                << " exceeded " << qMaxHops << " hops, dropping\n";
+        qLoopDrops++;
+        emit(dropSignal, (long)pkt->getByteLength());
+        delete pkt;
+        return;
+    }
+
+    int outGateIndex = qSelectGate(destAddr, arrivalGate, true);
+    if (outGateIndex >= 0) {
+        pkt->setLastHopSentAt(simTime().dbl());
+    }
+    else {
+        // no other node in reach: let the controller route it
+        outGateIndex = getGateToSDN();
+        pkt->setLastHopSentAt(-1);
+    }
+
+    if (outGateIndex >= 0) {
+        EV_TRACE << "Node " << myAddress << ": Q-routing packet to " << destAddr
+                 << " via gate " << outGateIndex << "\n";
+        emit(outputIfSignal, outGateIndex);
+        send(pkt, "out", outGateIndex);
+    }
+    else {
+        EV_WARN << "Node " << myAddress
+                << ": No route to " << destAddr << ", dropping\n";
+        emit(dropSignal, (long)pkt->getByteLength());
+        delete pkt;
+    }
+}
+
 void Routing::sendDiscoveryPacket()
 {
     // CHANGE 8: discovery is now also gated by battery FSM
     if (batteryFsm.getState() != BAT_ACTIVE) {
-        EV << "Node " << myAddress
-           << ": battery not available (state=" << batteryFsm.getState()
-           << "), skipping discovery\n";
+        EV_DETAIL << "Node " << myAddress
+                  << ": battery not available (state=" << batteryFsm.getState()
+                  << "), skipping discovery\n";
         return;
     }
 
-    EV << "Node " << myAddress
-       << ": Sending discovery packet to SDN controller\n";
+    EV_DETAIL << "Node " << myAddress
+              << ": Sending discovery packet to SDN controller\n";
 
     // use shared helper for discovery drain (instead of inline uniform())
     updateBatteryOnActivity(0.1, 0.5);
@@ -277,13 +518,13 @@ void Routing::sendDiscoveryPacket()
 
     int sdnGate = getGateToSDN();
     if (sdnGate >= 0) {
-        EV << "Node " << myAddress
-           << ": Sending discovery via gate " << sdnGate << "\n";
+        EV_TRACE << "Node " << myAddress
+                 << ": Sending discovery via gate " << sdnGate << "\n";
         send(discoveryPkt, "out", sdnGate);
     }
     else {
-        EV << "Node " << myAddress
-           << ": ERROR - No route to SDN controller!\n";
+        EV_WARN << "Node " << myAddress
+                << ": ERROR - No route to SDN controller!\n";
         delete discoveryPkt;
     }
 }
@@ -306,8 +547,8 @@ void Routing::processBatteryTimer()
 
             if (batteryLevel < 20.0) {
                 FSM_Goto(batteryFsm, BAT_CHARGING);
-                EV << "Node " << myAddress << ": battery low ("
-                   << batteryLevel << "%), entering CHARGING state\n";
+                EV_INFO << "Node " << myAddress << ": battery low ("
+                        << batteryLevel << "%), entering CHARGING state\n";
             }
             break;
 
@@ -318,12 +559,13 @@ void Routing::processBatteryTimer()
 
             if (batteryLevel >= 100.0) {
                 FSM_Goto(batteryFsm, BAT_ACTIVE);
-                EV << "Node " << myAddress
-                   << ": battery full, returning to ACTIVE state\n";
+                EV_INFO << "Node " << myAddress
+                        << ": battery full, returning to ACTIVE state\n";
             }
             break;
     }
 
+    emit(batteryLevelSignal, batteryLevel);
     scheduleAt(simTime() + 1, batteryTimer);
 }
 
@@ -338,25 +580,28 @@ void Routing::updateBatteryOnActivity(double minDrain, double maxDrain)
 
     if (batteryLevel < 0)
         batteryLevel = 0;
+    emit(batteryLevelSignal, batteryLevel);
 
     if (batteryLevel == 0) {
         if (batteryFsm.getState() != BAT_CHARGING) {
             FSM_Goto(batteryFsm, BAT_CHARGING);
-            EV << "Node " << myAddress
-               << ": battery depleted to 0%, entering CHARGING state\n";
+            EV_INFO << "Node " << myAddress
+                    << ": battery depleted to 0%, entering CHARGING state\n";
         }
     }
     else if (batteryLevel < 20.0 && batteryFsm.getState() == BAT_ACTIVE) {
         FSM_Goto(batteryFsm, BAT_CHARGING);
-        EV << "Node " << myAddress
-           << ": battery low (" << batteryLevel
-           << "%), entering CHARGING state\n";
+        EV_INFO << "Node " << myAddress
+                << ": battery low (" << batteryLevel
+                << "%), entering CHARGING state\n";
     }
 }
 
 // CHANGE 11: finish() now reports the FSM state label, not just the %
 void Routing::finish()
 {
+    PROFILE_HANDLER_FINISH();
+
     const char *stateName = "unknown";
     switch (batteryFsm.getState()) {
         case BAT_ACTIVE:   stateName = "ACTIVE";   break;
@@ -364,6 +609,14 @@ void Routing::finish()
         default: break;
     }
 
-    EV << "Node " << myAddress << ": Final battery level = "
-       << batteryLevel << "%, state = " << stateName << "\n";
+    EV_INFO << "Node " << myAddress << ": Final battery level = "
+            << batteryLevel << "%, state = " << stateName << "\n";
+
+    if (qRouting) {
+        recordScalar("qTableEntries", (double)qTable.size());
+        recordScalar("qTableBytes", (double)(qTable.capacity() * sizeof(float)
+                                             + qRows.size() * (sizeof(std::pair<const int, int>) + 4 * sizeof(void *))), "B");
+        recordScalar("qFeedbackReceived", qFeedbackReceived);
+        recordScalar("qLoopDrops", qLoopDrops);
+    }
 }
@@ -1,19 +1,35 @@
 #include <omnetpp.h>
+#include <chrono>
+#include <deque>
 #include <map>
+#include <set>
+#include <unordered_map>
 #include <vector>
 #include <fstream>
 #include <sstream>
 #include <cmath>
 #include <algorithm>
 #include <iomanip>
+#include <memory>
 #include "Packet_m.h"
+#include "SDNRoutingCore.h"
+#include "FlowClassifier.h"
+#include "ContextualBandit.h"
+#include "HandlerProfiler.h"
+#include "LatencyHistogram.h"
+#include "MemoryAccounting.h"
+#include "DecisionTrace.h"
+#include "ControllerSnapshot.h"
 
 using namespace omnetpp;
 
+// Names of SDNController_ML::DecisionPolicy, in scalar names and shadowPolicies
+static const char *policyNames[] = { "traditional", "energyAware", "ml", "mlEnergyAware", "bandit", "replay" };
+
 /**
  * SDN Controller with Machine Learning capabilities
  */
-class SDNController_ML : public cSimpleModule
+class SDNController_ML : public cSimpleModule, public cListener
 {
   private:
     int myAddress;
@@ -30,50 +46,171 @@ class SDNController_ML : public cSimpleModule
     double linkQualityWeight;     // weight of link quality in score
     double distanceWeight;        // weight of (inverted) distance in score
     double fairnessWeight;        // weight of neighbor degree / fairness term
+    double batteryForecastAlpha;  // Holt smoothing of the reported battery levels
+    double batteryForecastBeta;   // ... and of their trend
+
+    // Controller domains (parsim partitioning): addresses are grouped in blocks
+    // of domainAddressBlock, the controller of a block owns its base address.
+    int domainAddressBlock;       // 0 = single domain (original behaviour)
+    int maxHops;                  // hop count beyond which packets are not sent to another domain
+    long backboneForwards = 0;
+    long hopLimitDrops = 0;
+    std::vector<int> gateNeighbors;       // gate index -> neighbour address
+    std::vector<int> scoringNeighbors;    // same, -1 for gates that are not routing candidates
+    std::map<int, int> neighborGates;     // neighbour address -> gate index
+    EnergyWeights energyWeights;
 
     cMessage *discoveryTimer;
 
-    struct NodeMetrics {
-        int address;
-        double batteryLevel;
-        double distance;
-        double avgDelay;
-        double packetLoss;
-        double throughput;
-        int hopCount;
-        double linkQuality;
-        simtime_t lastUpdate;
-        int connectedNeighbors;
-    };
-
-    struct FlowData {
-        int srcAddr;
-        int destAddr;
-        double srcBattery;
-        double destBattery;
-        double pathDistance;
-        int chosenPath;
-        double pathDelay;
-        double pathQuality;
-        simtime_t timestamp;
-    };
+    // Warm restarts: state snapshot saved at the end and every snapshotInterval
+    std::string snapshotFile;
+    simtime_t snapshotInterval;
+    cMessage *snapshotTimer = nullptr;
+
+    // Batched decisions: data packets wait up to decisionBatchWindow (0s = until
+    // the other events of the same simulation time are done) or until
+    // maxDecisionBatch have gathered, then their flow contexts are built and
+    // the ML model predicts for all of them in one pass.
+    bool batchDecisions;
+    simtime_t decisionBatchWindow;
+    int maxDecisionBatch;
+    cMessage *batchTimer = nullptr;
+    std::vector<Packet *> pendingDecisions;
+    std::vector<FlowData> batchFlows;
+    std::vector<int> batchPredictions;
+    std::vector<int> unbatchedPredictions;    // reference pass of measureDecisionLatency, discarded
+    std::chrono::nanoseconds batchShare{0};   // of the shared batch work, per decision
+    long decisionBatches = 0;
+    long batchedDecisions = 0;
+    int64_t batchInferenceNs = 0;     // measured with measureDecisionLatency
+    int64_t unbatchedInferenceNs = 0; // the same predictions one flow at a time
+    long batchInferences = 0;
 
     std::map<int, NodeMetrics> nodeDatabase;
+
+    // Nodes reported since the last discovery tick; only these are printed.
+    // The aggregates over the whole database are kept up to date on every
+    // DISCOVERY, so a tick costs O(changes) rather than O(nodes).
+    std::set<int> changedNodes;
+    int newNodes;
+    double batterySum;
+    int lowBatteryNodes;
     std::vector<FlowData> trainingDataset;
     int totalFlowsProcessed;
 
     struct MLModel {
         bool isTrained;
-        std::vector<FlowData> trainingSet;
+        std::unique_ptr<FlowClassifier> classifier;   // selected by the mlModel parameter
         int k;
     } mlModel;
 
+    // Prequential accuracy: ML predictions are compared with the gate the
+    // traditional policy (which labelled the training samples) would choose;
+    // online models then learn that label. The label costs a traditional
+    // decision, so it is computed only for online models or with
+    // trackMLAccuracy, after the decision's latency has been measured.
+    bool trackMLAccuracy;
+    long mlPredictions = 0;
+    long mlAgreements = 0;
+    int unlabelledPrediction = -1;  // of the decision in progress
+
+    // Contextual-bandit routing: LinUCB over the gates, rewarded by the delivery
+    // delay of each routed packet (endToEndDelay at the destination, matched by
+    // packet id) and the battery of the chosen next hop.
+    bool banditRouting;
+    double banditDelayScale;
+    double banditEnergyWeight;
+    double banditLossReward;
+    simtime_t banditFeedbackTimeout;
+    std::unique_ptr<LinUCBBandit> bandit;
+    struct BanditPending {
+        int gate;
+        int neighbor;
+        simtime_t routedAt;
+        double context[BANDIT_FEATURES];
+    };
+    std::unordered_map<long, BanditPending> banditPending;     // packet id -> decision
+    std::deque<std::pair<simtime_t, long>> banditPendingOrder;  // for the timeouts
+    std::vector<int> banditArms;          // candidate gates
+    std::vector<double> banditContexts;   // of the decision in progress, per candidate
+    long banditRewards = 0;
+    long banditLosses = 0;
+    double banditRewardSum = 0;
+
+    // Distributed Q-routing: the nodes route the data traffic themselves; the
+    // controller only sends them the exploration rate and energy weight.
+    bool qRouting;
+
     simsignal_t topologyUpdatedSignal;
+    simsignal_t topologyChangesSignal;
     simsignal_t mlPredictionSignal;
     simsignal_t routingDecisionSignal;
+    simsignal_t decisionBatchSizeSignal;
+    simsignal_t decisionBatchDelaySignal;
+    simsignal_t banditRewardSignal;
+    simsignal_t endToEndDelaySignal;
 
     std::ofstream datasetStream;
 
+    // Wall-clock compute time of each routing decision, split by policy and by
+    // the size of the sample set the decision worked on (decades: <100 .. >=100k).
+    enum DecisionPolicy {
+        POLICY_TRADITIONAL, POLICY_ENERGY_AWARE, POLICY_ML, POLICY_ML_ENERGY_AWARE, POLICY_BANDIT,
+        POLICY_REPLAY, NUM_POLICIES
+    };
+    bool measureDecisionLatency;
+    std::map<std::pair<int, int>, LatencyHistogram> decisionLatency;
+
+    // Shadow evaluation: candidate policies are run on every decision next to
+    // the live one, on the same flow context, without routing by them,
+    // learning from them or emitting anything. Each is scored by the next hop
+    // it would have chosen; the last entry scores the live gates.
+    struct ShadowStats {
+        long decisions = 0;
+        long agreements = 0;          // same gate as the live policy
+        double nextHopBatterySum = 0;
+        long lowBatteryHops = 0;      // next hop below lowBatteryThreshold
+        long directHops = 0;          // next hop is the destination
+    };
+    std::vector<int> shadowPolicies;
+    ShadowStats shadowStats[NUM_POLICIES + 1];
+    long shadowEvaluations = 0;
+    int64_t shadowTimeNs = 0;
+
+    // Memory footprint of the growing state, sampled on every discovery tick
+    MemoryAccount datasetMemory{MEM_DATASET};
+    MemoryAccount modelMemory{MEM_MODEL};
+    MemoryAccount metricsMemory{MEM_METRICS};
+    simsignal_t memDatasetSignal;
+    simsignal_t memModelSignal;
+    simsignal_t memMetricsSignal;
+
+    // The most recent routing decisions, saved as a binary .dtrc file at the
+    // end of the run or, after an error, when the module is deleted.
+    DecisionTrace decisionTrace;
+    std::string decisionTraceFile;
+    bool decisionTraceSaved = false;
+    int lastMLPrediction = -1;    // side results of the decision in progress
+    double lastScoreMargin = NAN;
+
+    // Replay mode: gates of a previous run's decision trace, per packet (source
+    // address and the source's sequence number), applied instead of ML
+    // inference and scoring. A packet that reaches the controller more than
+    // once takes its recorded decisions in order.
+    struct ReplayEntry {
+        int destAddr;
+        int gate;               // -1 if the packet was dropped
+    };
+    struct ReplayQueue {
+        std::vector<ReplayEntry> decisions;
+        size_t next = 0;
+    };
+    bool replaying = false;
+    std::map<std::pair<int, uint64_t>, ReplayQueue> replayLog;
+    long replayedDecisions = 0;
+    long replayDrops = 0;
+    long replayDivergences = 0;
+
   protected:
     virtual void initialize() override;
     virtual void handleMessage(cMessage *msg) override;
@@ -81,21 +218,56 @@ class SDNController_ML : public cSimpleModule
 
     void performTopologyDiscovery();
     void processDiscoveryPacket(Packet *pkt);
-    void forwardDataPacket(Packet *pkt);
+    void forwardDataPacket(Packet *pkt, const FlowData *flow = nullptr, int prediction = -1);
+    void flushDecisionBatch();
 
-    int findBestRouteML(int srcAddr, int destAddr);
+    FlowData makeFlowContext(int srcAddr, int destAddr);
+    int findBestRouteML(const FlowData &flow, int prediction = -1);
     int findBestRouteTraditional(int srcAddr, int destAddr);
     void exportToDataset(const FlowData &data);
     void trainMLModel();
-    int predictBestPath(int srcAddr, int destAddr);
+    int predictBestPath(const FlowData &flow, int prediction = -1);
+    void labelPrediction(const FlowData &flow);
     double calculateEuclideanDistance(const FlowData &a, const FlowData &b);
     double calculatePathQuality(int srcAddr, int destAddr, int pathIndex);
     int findGateToDestination(int destAddr);
+    int traditionalGate(int destAddr);
+
+    // Neighbour resolution from our own ports, without touching remote modules'
+    // internals (placeholders under parsim only carry parameters).
+    void buildNeighborTable();
+    bool isPeerControllerGate(int gateIndex) const;
+    int findGateToPeerDomain(int destAddr) const;
 
     // CHANGE 2: New helper that scores *per-gate* next hops using energy metrics
     //           and optionally keeps the ML / traditional suggestion as “preferred”.
+    //           The scoring itself lives in SDNRoutingCore.
     int selectEnergyAwareGate(int srcAddr, int destAddr, int preferredGate);
 
+    void banditContext(int srcAddr, int destAddr, int neighbor, double *x);
+    int selectBanditGate(int srcAddr, int destAddr);
+    void banditRouted(long packetId, int gate);
+    void banditReward(const BanditPending& decision, double reward);
+    void expireBanditDecisions();
+    void sendQRoutingParameters();
+    virtual void receiveSignal(cComponent *source, simsignal_t signalID, const SimTime& value, cObject *details) override;
+
+    int decisionPolicy(bool usedML) const;
+    int shadowGate(int policy, const FlowData &flow, int directGate, int &mlGate);
+    void scoreShadowGate(ShadowStats &stats, const FlowData &flow, int gate, int liveGate);
+    void evaluateShadowPolicies(const FlowData &flow, int liveGate);
+    void recordShadowStats();
+    void collectDecisionLatency(int policy, size_t workingSetSize,
+                                std::chrono::steady_clock::time_point start);
+    void traceDecision(const Packet *pkt, int policy, int gate, int flags);
+    void saveDecisionTrace();
+    void loadReplayLog(const char *fileName);
+    bool replayDecision(const Packet *pkt, int &gate);
+    void recordDecisionLatency();
+    void updateMemoryAccounting();
+    void saveSnapshot();
+    void restoreSnapshot(const char *fileName);
+
   public:
     virtual ~SDNController_ML();
 };
@@ -105,12 +277,27 @@ Define_Module(SDNController_ML);
 SDNController_ML::~SDNController_ML()
 {
     cancelAndDelete(discoveryTimer);
+    cancelAndDelete(snapshotTimer);
+    cancelAndDelete(batchTimer);
+    for (Packet *pkt : pendingDecisions)
+        delete pkt;
     if (datasetStream.is_open())
         datasetStream.close();
+
+    // finish() was not reached: keep the decisions that led up to the error
+    if (!decisionTraceSaved) {
+        try {
+            saveDecisionTrace();
+        }
+        catch (std::exception&) {
+        }
+    }
 }
 
 void SDNController_ML::initialize()
 {
+    PROFILE_HANDLER_INIT();
+
     myAddress = par("address");
     discoveryInterval = par("discoveryInterval");
     datasetFile = par("datasetFile").stdstringValue();
@@ -126,101 +313,272 @@ void SDNController_ML::initialize()
     distanceWeight       = par("distanceWeight");
     fairnessWeight       = par("fairnessWeight");
 
+    energyWeights.battery             = batteryWeight;
+    energyWeights.linkQuality         = linkQualityWeight;
+    energyWeights.distance            = distanceWeight;
+    energyWeights.fairness            = fairnessWeight;
+    energyWeights.lowBatteryThreshold = lowBatteryThreshold;
+    energyWeights.depletion           = par("depletionWeight");
+    energyWeights.depletionHorizon    = par("depletionHorizon");
+    batteryForecastAlpha = par("batteryForecastAlpha");
+    batteryForecastBeta  = par("batteryForecastBeta");
+
+    domainAddressBlock   = par("domainAddressBlock");
+    maxHops              = par("maxHops");
+    buildNeighborTable();
+
+    measureDecisionLatency = par("measureDecisionLatency");
+
+    for (const std::string& name : cStringTokenizer(par("shadowPolicies")).asVector()) {
+        if (name == "all") {
+            for (int policy = 0; policy < POLICY_BANDIT; policy++)
+                shadowPolicies.push_back(policy);
+            continue;
+        }
+        int policy = std::find_if(policyNames, policyNames + NUM_POLICIES,
+                                  [&](const char *p) { return name == p; }) - policyNames;
+        if (policy == NUM_POLICIES)
+            throw cRuntimeError("SDNController_ML: Unknown shadow policy '%s'", name.c_str());
+        if (policy == POLICY_BANDIT)
+            throw cRuntimeError("SDNController_ML: Cannot shadow the bandit policy, it learns only from the gates it routes");
+        if (policy == POLICY_REPLAY)
+            throw cRuntimeError("SDNController_ML: Cannot shadow the replay policy, set replayFile instead");
+        shadowPolicies.push_back(policy);
+    }
+
+    decisionTrace.resize(par("decisionTraceSize").intValue());
+    decisionTraceFile = par("decisionTraceFile").stdstringValue();
+    if (decisionTraceFile.empty()) {
+        // next to the scalar file of the run
+        std::string base = getEnvir()->getConfig()->getAsFilename(cConfigOption::find("output-scalar-file"));
+        if (base.size() > 4 && base.compare(base.size() - 4, 4, ".sca") == 0)
+            base.resize(base.size() - 4);
+        decisionTraceFile = base + "-" + getFullPath() + ".dtrc";
+    }
+
     topologyUpdatedSignal = registerSignal("topologyUpdated");
+    topologyChangesSignal = registerSignal("topologyChanges");
     mlPredictionSignal = registerSignal("mlPrediction");
     routingDecisionSignal = registerSignal("routingDecision");
+    decisionBatchSizeSignal = registerSignal("decisionBatchSize");
+    decisionBatchDelaySignal = registerSignal("decisionBatchDelay");
+    banditRewardSignal = registerSignal("banditReward");
+    endToEndDelaySignal = registerSignal("endToEndDelay");
+    memDatasetSignal = registerSignal("memDataset");
+    memModelSignal = registerSignal("memModel");
+    memMetricsSignal = registerSignal("memMetrics");
 
     mlModel.isTrained = false;
     mlModel.k = 3;
+    try {
+        mlModel.classifier.reset(createFlowClassifier(par("mlModel").stdstringValue(), gateSize("out"),
+                                                      mlModel.k, par("mlLearningRate").doubleValue(),
+                                                      par("mlWeightsFile").stdstringValue()));
+    }
+    catch (std::exception& e) {
+        throw cRuntimeError("SDNController_ML: Cannot create ML model: %s", e.what());
+    }
+    trackMLAccuracy = par("trackMLAccuracy");
     totalFlowsProcessed = 0;
+    newNodes = 0;
+    batterySum = 0;
+    lowBatteryNodes = 0;
+
+    banditRouting = par("banditRouting");
+    if (banditRouting) {
+        banditDelayScale = par("banditDelayScale");
+        banditEnergyWeight = par("banditEnergyWeight");
+        banditLossReward = par("banditLossReward");
+        banditFeedbackTimeout = par("banditFeedbackTimeout");
+        bandit.reset(new LinUCBBandit(gateSize("out"), par("banditAlpha").doubleValue()));
+        for (int i = 0; i < (int)scoringNeighbors.size(); i++)
+            if (scoringNeighbors[i] >= 0)
+                banditArms.push_back(i);
+        banditContexts.resize(banditArms.size() * BANDIT_FEATURES);
+        // deliveries are reported by the destination apps
+        getSimulation()->getSystemModule()->subscribe(endToEndDelaySignal, this);
+    }
+
+    qRouting = par("qRouting");
+
+    batchDecisions = par("batchDecisions");
+    if (batchDecisions) {
+        decisionBatchWindow = par("decisionBatchWindow");
+        maxDecisionBatch = par("maxDecisionBatch");
+        if (maxDecisionBatch < 1)
+            throw cRuntimeError("SDNController_ML: maxDecisionBatch must be at least 1");
+        batchTimer = new cMessage("batchTimer");
+        batchTimer->setSchedulingPriority(1);  // after the arrivals of the same time
+        pendingDecisions.reserve(maxDecisionBatch);
+        batchFlows.resize(maxDecisionBatch);
+        batchPredictions.resize(maxDecisionBatch);
+        unbatchedPredictions.resize(maxDecisionBatch);
+    }
+
+    const char *restoreFile = par("restoreFile");
+    if (*restoreFile)
+        restoreSnapshot(restoreFile);
+
+    const char *replayFile = par("replayFile");
+    if (*replayFile)
+        loadReplayLog(replayFile);
+
+    snapshotFile = par("snapshotFile").stdstringValue();
+    snapshotInterval = par("snapshotInterval").doubleValue();
+    if (!snapshotFile.empty() && snapshotInterval > 0) {
+        snapshotTimer = new cMessage("snapshotTimer");
+        scheduleAt(simTime() + snapshotInterval, snapshotTimer);
+    }
 
     // Open dataset file
     datasetStream.open(datasetFile, std::ios::out);
     if (datasetStream.is_open()) {
-        datasetStream << "timestamp,src_addr,dest_addr,src_battery,dest_battery,"
-                      << "path_distance,chosen_path,path_delay,path_quality\n";
+        writeDatasetHeader(datasetStream);
         datasetStream.flush();
-        EV << "SDN Controller: Dataset file opened: " << datasetFile << "\n";
+        EV_INFO << "SDN Controller: Dataset file opened: " << datasetFile << "\n";
     } else {
-        EV << "SDN Controller: ERROR - Could not open dataset file: " << datasetFile << "\n";
+        EV_ERROR << "SDN Controller: ERROR - Could not open dataset file: " << datasetFile << "\n";
     }
 
     discoveryTimer = new cMessage("discoveryTimer");
     scheduleAt(simTime() + 1.0, discoveryTimer);
 
-    EV << "SDN Controller initialized at address " << myAddress << "\n";
-    EV << "ML Routing: " << (enableMLRouting ? "ENABLED" : "DISABLED") << "\n";
-    EV << "Training Threshold: " << trainingThreshold << " samples\n";
+    EV_INFO << "SDN Controller initialized at address " << myAddress << "\n";
+    EV_INFO << "ML Routing: " << (enableMLRouting ? "ENABLED" : "DISABLED") << "\n";
+    EV_INFO << "Training Threshold: " << trainingThreshold << " samples\n";
 
     // CHANGE 4: Extra log line to show whether energy-aware routing is active.
-    EV << "Energy-aware routing: " << (energyAwareRouting ? "ENABLED" : "DISABLED")
-       << " (lowBatteryThreshold=" << lowBatteryThreshold << "%)\n";
+    EV_INFO << "Energy-aware routing: " << (energyAwareRouting ? "ENABLED" : "DISABLED")
+            << " (lowBatteryThreshold=" << lowBatteryThreshold << "%)\n";
 }
 
 void SDNController_ML::handleMessage(cMessage *msg)
 {
+    PROFILE_HANDLER(msg);
+
     if (msg == discoveryTimer) {
         performTopologyDiscovery();
         if (trainingDataset.size() >= trainingThreshold && !mlModel.isTrained) {
             trainMLModel();
         }
+        if (qRouting)
+            sendQRoutingParameters();
 
         scheduleAt(simTime() + discoveryInterval, discoveryTimer);
     }
+    else if (msg == snapshotTimer) {
+        saveSnapshot();
+        scheduleAt(simTime() + snapshotInterval, snapshotTimer);
+    }
+    else if (msg == batchTimer) {
+        flushDecisionBatch();
+    }
     else {
         Packet *pkt = check_and_cast<Packet *>(msg);
 
         if (pkt->getPacketType() == DISCOVERY) {
-            EV << "SDN: Received DISCOVERY packet from node " << pkt->getSrcAddr() << "\n";
+            EV_DETAIL << "SDN: Received DISCOVERY packet from node " << pkt->getSrcAddr() << "\n";
             processDiscoveryPacket(pkt);
             delete pkt;
         }
+        else if (pkt->getPacketType() == QROUTING_FEEDBACK || pkt->getPacketType() == QROUTING_PARAMS) {
+            delete pkt;  // the controller is no Q-routing hop
+        }
         else {
-            EV << "SDN: Received DATA packet from " << pkt->getSrcAddr()
-               << " to " << pkt->getDestAddr() << "\n";
-            forwardDataPacket(pkt);
+            EV_DEBUG << "SDN: Received DATA packet from " << pkt->getSrcAddr()
+                     << " to " << pkt->getDestAddr() << "\n";
+            if (batchDecisions) {
+                pendingDecisions.push_back(pkt);
+                if ((int)pendingDecisions.size() >= maxDecisionBatch) {
+                    cancelEvent(batchTimer);
+                    flushDecisionBatch();
+                }
+                else if (!batchTimer->isScheduled()) {
+                    scheduleAt(simTime() + decisionBatchWindow, batchTimer);
+                }
+            }
+            else {
+                forwardDataPacket(pkt);
+            }
         }
     }
 }
 
 void SDNController_ML::performTopologyDiscovery()
 {
-    EV << "\n==== TOPOLOGY DISCOVERY ====\n";
-    EV << "Time: " << simTime() << "\n";
-    EV << "Node database has " << nodeDatabase.size() << " entries\n";
-
-    if (nodeDatabase.size() > 0) {
-        EV << "\n--- Node Metrics Database ---\n";
-        EV << "Addr | Battery | Distance | Delay | Quality\n";
-        EV << "-----+---------+----------+-------+--------\n";
-
-        for (auto &entry : nodeDatabase) {
-            NodeMetrics &nm = entry.second;
-            EV << std::setw(4) << nm.address << " | "
-               << std::setw(6) << std::fixed << std::setprecision(1) << nm.batteryLevel << "% | "
-               << std::setw(7) << std::setprecision(2) << nm.distance << "m | "
-               << std::setw(5) << std::setprecision(3) << nm.avgDelay << "s | "
-               << std::setw(6) << std::setprecision(2) << nm.linkQuality << "%\n";
+    EV_DETAIL << "\n==== TOPOLOGY DISCOVERY ====\n";
+    EV_DETAIL << "Time: " << simTime() << "\n";
+    EV_DETAIL << "Node database has " << nodeDatabase.size() << " entries ("
+              << newNodes << " new, " << changedNodes.size() - newNodes << " updated since last tick)\n";
+    if (!nodeDatabase.empty())
+        EV_DETAIL << "Mean battery: " << batterySum / nodeDatabase.size() << "%, "
+                  << lowBatteryNodes << " nodes below " << lowBatteryThreshold << "%\n";
+
+    if (!changedNodes.empty()) {
+        EV_DETAIL << "\n--- Changed Nodes ---\n";
+        EV_DETAIL << "Addr | Battery | Distance | Delay | Quality\n";
+        EV_DETAIL << "-----+---------+----------+-------+--------\n";
+
+        for (int addr : changedNodes) {
+            NodeMetrics &nm = nodeDatabase[addr];
+            EV_DETAIL << std::setw(4) << nm.address << " | "
+                      << std::setw(6) << std::fixed << std::setprecision(1) << nm.batteryLevel << "% | "
+                      << std::setw(7) << std::setprecision(2) << nm.distance << "m | "
+                      << std::setw(5) << std::setprecision(3) << nm.avgDelay << "s | "
+                      << std::setw(6) << std::setprecision(2) << nm.linkQuality << "%\n";
         }
     }
 
-    EV << "\nTraining dataset size: " << trainingDataset.size() << "\n";
-    EV << "Total flows processed: " << totalFlowsProcessed << "\n";
-    EV << "ML Model trained: " << (mlModel.isTrained ? "YES" : "NO") << "\n";
-    EV << "=============================\n\n";
+    EV_DETAIL << "\nTraining dataset size: " << trainingDataset.size() << "\n";
+    EV_DETAIL << "Total flows processed: " << totalFlowsProcessed << "\n";
+    EV_DETAIL << "ML Model trained: " << (mlModel.isTrained ? "YES" : "NO") << "\n";
+    EV_DETAIL << "=============================\n\n";
 
     emit(topologyUpdatedSignal, (long)nodeDatabase.size());
+    emit(topologyChangesSignal, (long)changedNodes.size());
+    changedNodes.clear();
+    newNodes = 0;
+
+    updateMemoryAccounting();
+    emit(memDatasetSignal, (long)datasetMemory.get());
+    emit(memModelSignal, (long)modelMemory.get());
+    emit(memMetricsSignal, (long)metricsMemory.get());
+}
+
+void SDNController_ML::updateMemoryAccounting()
+{
+    // std::map nodes carry three pointers and a colour word besides the value
+    const size_t mapNodeOverhead = 4 * sizeof(void *);
+
+    datasetMemory.set(trainingDataset.capacity() * sizeof(FlowData));
+    modelMemory.set(mlModel.classifier->getMemoryBytes() + (bandit ? bandit->getMemoryBytes() : 0));
+
+    int64_t metricsBytes = nodeDatabase.size() * (sizeof(std::pair<const int, NodeMetrics>) + mapNodeOverhead);
+    for (auto &entry : decisionLatency)
+        metricsBytes += entry.second.getMemoryBytes() + mapNodeOverhead;
+    metricsMemory.set(metricsBytes);
 }
 
 void SDNController_ML::processDiscoveryPacket(Packet *pkt)
 {
     int srcAddr = pkt->getSrcAddr();
 
-    EV << "SDN: Processing DISCOVERY from Node " << srcAddr
-       << " (Battery: " << pkt->getBatteryLevel() << "%, Distance: "
-       << pkt->getDistanceToSDN() << "m)\n";
+    EV_DETAIL << "SDN: Processing DISCOVERY from Node " << srcAddr
+              << " (Battery: " << pkt->getBatteryLevel() << "%, Distance: "
+              << pkt->getDistanceToSDN() << "m)\n";
+
+    auto inserted = nodeDatabase.emplace(srcAddr, NodeMetrics());
+    NodeMetrics &nm = inserted.first->second;
+    if (inserted.second) {
+        newNodes++;
+    }
+    else {
+        batterySum -= nm.batteryLevel;
+        lowBatteryNodes -= nm.batteryLevel < lowBatteryThreshold;
+    }
 
-    NodeMetrics &nm = nodeDatabase[srcAddr];
+    updateBatteryForecast(nm, pkt->getBatteryLevel(), simTime().dbl(), inserted.second,
+                          batteryForecastAlpha, batteryForecastBeta);
     nm.address = srcAddr;
     nm.batteryLevel = pkt->getBatteryLevel();
     nm.distance = pkt->getDistanceToSDN();
@@ -229,10 +587,66 @@ void SDNController_ML::processDiscoveryPacket(Packet *pkt)
     nm.throughput = uniform(1, 10);
     nm.hopCount = pkt->getHopCount();
     nm.linkQuality = 100.0 - nm.packetLoss;
-    nm.lastUpdate = simTime();
+    nm.lastUpdate = simTime().dbl();
     nm.connectedNeighbors = intuniform(1, 4);
 
-    EV << "SDN: Node " << srcAddr << " added/updated in database\n";
+    batterySum += nm.batteryLevel;
+    lowBatteryNodes += nm.batteryLevel < lowBatteryThreshold;
+    changedNodes.insert(srcAddr);
+
+    EV_DETAIL << "SDN: Node " << srcAddr << " added/updated in database\n";
+}
+
+void SDNController_ML::buildNeighborTable()
+{
+    cModule *node = getParentModule();
+    gateNeighbors.assign(gateSize("out"), -1);
+
+    for (int i = 0; i < (int)gateNeighbors.size() && i < node->gateSize("port"); i++) {
+        cGate *peerGate = node->gate("port$o", i)->getNextGate();
+        if (!peerGate || !peerGate->getOwnerModule()->hasPar("address"))
+            continue;
+
+        int peerAddr = peerGate->getOwnerModule()->par("address");
+        gateNeighbors[i] = peerAddr;
+        if (neighborGates.find(peerAddr) == neighborGates.end())
+            neighborGates[peerAddr] = i;
+    }
+
+    // Energy-aware scoring candidates: unresolved gates keep the 1..N testbed
+    // numbering, backbone links to other controller domains never carry local traffic.
+    scoringNeighbors.resize(gateNeighbors.size());
+    for (int i = 0; i < (int)gateNeighbors.size(); i++) {
+        if (isPeerControllerGate(i))
+            scoringNeighbors[i] = -1;
+        else
+            scoringNeighbors[i] = gateNeighbors[i] >= 0 ? gateNeighbors[i] : i + 1;
+    }
+
+    EV_INFO << "SDN: " << neighborGates.size() << " direct neighbours on "
+            << gateNeighbors.size() << " gates\n";
+}
+
+bool SDNController_ML::isPeerControllerGate(int gateIndex) const
+{
+    if (domainAddressBlock <= 0)
+        return false;
+
+    int peerAddr = gateNeighbors[gateIndex];
+    return peerAddr >= 0 && peerAddr % domainAddressBlock == 0;
+}
+
+int SDNController_ML::findGateToPeerDomain(int destAddr) const
+{
+    if (domainAddressBlock <= 0)
+        return -1;
+
+    int destController = destAddr - destAddr % domainAddressBlock;
+    if (destController == myAddress)
+        return -1;
+
+    auto it = neighborGates.find(destController);
+    return it != neighborGates.end() ? it->second : -1;
 }
 
 int SDNController_ML::findGateToDestination(int destAddr)
@@ -240,13 +654,14 @@ int SDNController_ML::findGateToDestination(int destAddr)
     int numGates = gateSize("out");
 
     if (numGates == 0) {
-        EV << "SDN: No output gates available!\n";
+        EV_WARN << "SDN: No output gates available!\n";
         return -1;
     }
 
-    int gateIndex = (destAddr - 1) % numGates;
+    auto it = neighborGates.find(destAddr);
+    int gateIndex = it != neighborGates.end() ? it->second : (destAddr - 1) % numGates;
 
-    EV << "SDN: Routing to device " << destAddr << " via gate " << gateIndex << "\n";
+    EV_TRACE << "SDN: Routing to device " << destAddr << " via gate " << gateIndex << "\n";
 
     return gateIndex;
 }
@@ -257,120 +672,159 @@ int SDNController_ML::findGateToDestination(int destAddr)
 //           choice is passed in as 'preferredGate' and gets a small bonus.
 int SDNController_ML::selectEnergyAwareGate(int srcAddr, int destAddr, int preferredGate)
 {
-    int numGates = gateSize("out");
-    if (numGates <= 0)
-        return -1;
-
-    // Compute average battery to define a fairness baseline.
-    double avgBattery = 100.0;
-    if (!nodeDatabase.empty()) {
-        double sum = 0.0;
-        int count = 0;
-        for (auto &kv : nodeDatabase) {
-            sum += kv.second.batteryLevel;
-            count++;
-        }
-        if (count > 0)
-            avgBattery = sum / count;
-    }
-
-    double bestScore = -1e9;
-    int bestGate = preferredGate;
-
-    for (int i = 0; i < numGates; i++) {
-        // Map gate index to neighbor address (1..N) in this small testbed.
-        int neighborAddr = i + 1;
-
-        // Default (optimistic) metrics if we have never seen this neighbor.
-        double battery   = 100.0;
-        double quality   = 90.0;
-        double distance  = 50.0;
-        double degree    = 1.0;
-
-        auto it = nodeDatabase.find(neighborAddr);
-        if (it != nodeDatabase.end()) {
-            NodeMetrics &nm = it->second;
-            battery  = nm.batteryLevel;
-            quality  = nm.linkQuality;
-            distance = 100.0 - std::min(nm.distance, 100.0); // closer → higher score
-            degree   = (double)nm.connectedNeighbors;
-        }
-
-        double fairnessPenalty = 0.0;
-        if (battery < avgBattery)
-            fairnessPenalty = (avgBattery - battery);
-
-        double score =
-            batteryWeight      * battery   +
-            linkQualityWeight  * quality   +
-            distanceWeight     * distance  +
-            fairnessWeight     * degree    -
-            fairnessWeight     * fairnessPenalty;
-
-        // Strong penalty if node is below lowBatteryThreshold
-        if (battery < lowBatteryThreshold)
-            score -= 50.0;
-
-        // Small bias to keep the original ML/traditional suggestion when scores tie.
-        if (i == preferredGate)
-            score += 5.0;
+    return ::selectEnergyAwareGate(nodeDatabase, scoringNeighbors, energyWeights, preferredGate,
+                                   simTime().dbl(), &lastScoreMargin);
+}
 
-        if (score > bestScore) {
-            bestScore = score;
-            bestGate  = i;
-        }
+void SDNController_ML::flushDecisionBatch()
+{
+    int n = pendingDecisions.size();
+    if (n == 0)
+        return;
+
+    // the work shared by the batch: flow contexts and one ML pass (replayed
+    // decisions need no prediction)
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++)
+        batchFlows[i] = makeFlowContext(pendingDecisions[i]->getSrcAddr(), pendingDecisions[i]->getDestAddr());
+    bool predicted = enableMLRouting && mlModel.isTrained && !banditRouting && !replaying
+                     && mlModel.classifier->getNumSamples() > 0;
+    auto inferenceStart = std::chrono::steady_clock::now();
+    if (predicted)
+        mlModel.classifier->predictBatch(n, batchFlows.data(), batchPredictions.data());
+    auto end = std::chrono::steady_clock::now();
+    batchShare = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start) / n;
+
+    if (predicted && measureDecisionLatency) {
+        // reference: the same predictions one flow at a time, into a scratch buffer
+        auto unbatchedStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; i++)
+            unbatchedPredictions[i] = mlModel.classifier->predict(batchFlows[i]);
+        auto unbatched = std::chrono::steady_clock::now() - unbatchedStart;
+        batchInferenceNs += std::chrono::duration_cast<std::chrono::nanoseconds>(end - inferenceStart).count();
+        unbatchedInferenceNs += std::chrono::duration_cast<std::chrono::nanoseconds>(unbatched).count();
+        batchInferences += n;
     }
 
-    return bestGate;
+    decisionBatches++;
+    batchedDecisions += n;
+    emit(decisionBatchSizeSignal, (long)n);
+    for (int i = 0; i < n; i++) {
+        Packet *pkt = pendingDecisions[i];
+        emit(decisionBatchDelaySignal, simTime() - pkt->getArrivalTime());
+        forwardDataPacket(pkt, &batchFlows[i], predicted ? batchPredictions[i] : -1);
+    }
+    pendingDecisions.clear();
+    batchShare = std::chrono::nanoseconds(0);
 }
 
-void SDNController_ML::forwardDataPacket(Packet *pkt)
+// flow and prediction come from flushDecisionBatch(): the flow context and
+// the ML model's gate, computed for the whole batch.
+void SDNController_ML::forwardDataPacket(Packet *pkt, const FlowData *flow, int prediction)
 {
     int srcAddr = pkt->getSrcAddr();
     int destAddr = pkt->getDestAddr();
+    lastMLPrediction = -1;
+    lastScoreMargin = NAN;
+    unlabelledPrediction = -1;
+
+    // Traffic for another controller domain goes straight over the backbone;
+    // the destination's own controller makes the routing decision (and counts
+    // the flow). Every backbone crossing is a hop, so a packet that controllers
+    // keep passing to each other is dropped once it reaches maxHops.
+    int peerGate = findGateToPeerDomain(destAddr);
+    if (peerGate >= 0) {
+        if (pkt->getHopCount() >= maxHops) {
+            EV_WARN << "SDN: Packet from " << srcAddr << " to " << destAddr << " reached "
+                    << maxHops << " hops, dropping instead of forwarding to another domain\n";
+            traceDecision(pkt, decisionPolicy(false), -1, DECISION_BACKBONE | DECISION_DROPPED);
+            hopLimitDrops++;
+            delete pkt;
+            return;
+        }
+        EV_TRACE << "SDN: DATA packet from " << srcAddr << " to " << destAddr
+                 << " is for another domain -> backbone gate " << peerGate << "\n";
+        traceDecision(pkt, decisionPolicy(false), peerGate, DECISION_BACKBONE);
+        backboneForwards++;
+        pkt->setHopCount(pkt->getHopCount() + 1);
+        send(pkt, "out", peerGate);
+        return;
+    }
+
     totalFlowsProcessed++;
-    EV << "SDN: Routing DATA packet #" << totalFlowsProcessed
-       << " from " << srcAddr << " to " << destAddr << "\n";
+    EV_DEBUG << "SDN: Routing DATA packet #" << totalFlowsProcessed
+             << " from " << srcAddr << " to " << destAddr << "\n";
 
+    // a batched decision is charged its share of the batch's work
+    std::chrono::steady_clock::time_point decisionStart;
+    if (measureDecisionLatency)
+        decisionStart = std::chrono::steady_clock::now() - batchShare;
+
+    // features of this flow, shared by the policies, the shadows and the dataset row
+    FlowData fd = flow ? *flow : makeFlowContext(srcAddr, destAddr);
+
+    bool usedML = enableMLRouting && mlModel.isTrained && !banditRouting;
+    int policy = decisionPolicy(usedML);
     int outGateIndex = -1;
-    if (enableMLRouting && mlModel.isTrained) {
-        outGateIndex = findBestRouteML(srcAddr, destAddr);
-        EV << "  Using ML-based routing -> gate " << outGateIndex << "\n";
+    int traceFlags = 0;
+    if (replaying && replayDecision(pkt, outGateIndex)) {
+        usedML = false;
+        policy = POLICY_REPLAY;
+        traceFlags |= DECISION_REPLAYED;
+        if (outGateIndex < 0) {
+            EV_TRACE << "  Replayed decision -> drop\n";
+            traceDecision(pkt, policy, -1, traceFlags | DECISION_DROPPED);
+            replayDrops++;
+            delete pkt;
+            return;
+        }
+        EV_TRACE << "  Replayed decision -> gate " << outGateIndex << "\n";
+    }
+    else if (banditRouting) {
+        outGateIndex = selectBanditGate(srcAddr, destAddr);
+        EV_TRACE << "  Using bandit routing -> gate " << outGateIndex << "\n";
+    }
+    else if (usedML) {
+        outGateIndex = findBestRouteML(fd, prediction);
+        EV_TRACE << "  Using ML-based routing -> gate " << outGateIndex << "\n";
     } else {
         outGateIndex = findBestRouteTraditional(srcAddr, destAddr);
-        EV << "  Using traditional routing -> gate " << outGateIndex << "\n";
+        EV_TRACE << "  Using traditional routing -> gate " << outGateIndex << "\n";
     }
 
     if (outGateIndex < 0 || outGateIndex >= gateSize("out")) {
         outGateIndex = findGateToDestination(destAddr);
-        EV << "  Fallback routing -> gate " << outGateIndex << "\n";
+        traceFlags |= DECISION_FALLBACK;
+        EV_TRACE << "  Fallback routing -> gate " << outGateIndex << "\n";
     }
 
     if (outGateIndex >= 0 && outGateIndex < gateSize("out")) {
-        EV << "  Forwarding via gate " << outGateIndex << "\n";
+        EV_TRACE << "  Forwarding via gate " << outGateIndex << "\n";
 
         // (unchanged) – we still log flows and export them to CSV
-        FlowData fd;
-        fd.srcAddr = srcAddr;
-        fd.destAddr = destAddr;
-        fd.srcBattery = (nodeDatabase.find(srcAddr) != nodeDatabase.end()) ?
-                        nodeDatabase[srcAddr].batteryLevel : 100.0;
-        fd.destBattery = (nodeDatabase.find(destAddr) != nodeDatabase.end()) ?
-                         nodeDatabase[destAddr].batteryLevel : 100.0;
-        fd.pathDistance = (nodeDatabase.find(srcAddr) != nodeDatabase.end()) ?
-                          nodeDatabase[srcAddr].distance : 50.0;
         fd.chosenPath = outGateIndex;
         fd.pathDelay = pkt->getPathDelay();
         fd.pathQuality = calculatePathQuality(srcAddr, destAddr, outGateIndex);
-        fd.timestamp = simTime();
 
         exportToDataset(fd);
         trainingDataset.push_back(fd);
+        if (measureDecisionLatency)
+            collectDecisionLatency(policy, usedML ? mlModel.classifier->getNumSamples() : trainingDataset.size(),
+                                   decisionStart);
+        labelPrediction(fd);
+        if (!shadowPolicies.empty())
+            evaluateShadowPolicies(fd, outGateIndex);
         emit(routingDecisionSignal, outGateIndex);
+        traceDecision(pkt, policy, outGateIndex, traceFlags);
+        if (banditRouting && traceFlags == 0)
+            banditRouted(pkt->getId(), outGateIndex);
+        pkt->setLastHopSentAt(-1);  // not routed by a Q table
         send(pkt, "out", outGateIndex);
     }
     else {
-        EV << "  No valid route, dropping packet\n";
+        EV_WARN << "  No valid route, dropping packet\n";
+        labelPrediction(fd);
+        traceDecision(pkt, policy, -1, traceFlags | DECISION_DROPPED);
         delete pkt;
     }
 }
@@ -378,20 +832,23 @@ void SDNController_ML::forwardDataPacket(Packet *pkt)
 // CHANGE 6: ML path selection now *delegates* to energy-aware gate scoring
 //           when the flag is enabled. Otherwise, behaviour is identical
 //           to the original controller.
-int SDNController_ML::findBestRouteML(int srcAddr, int destAddr)
+int SDNController_ML::findBestRouteML(const FlowData &flow, int prediction)
 {
-    int predictedPath = predictBestPath(srcAddr, destAddr);
+    int srcAddr = flow.srcAddr;
+    int destAddr = flow.destAddr;
+    int predictedPath = predictBestPath(flow, prediction);
     emit(mlPredictionSignal, (double)predictedPath);
+    lastMLPrediction = predictedPath;
 
     if (!energyAwareRouting)
         return predictedPath;
 
     int gate = selectEnergyAwareGate(srcAddr, destAddr, predictedPath);
 
-    EV << "SDN: [EA-ML] src=" << srcAddr
-       << " dest=" << destAddr
-       << " mlGate=" << predictedPath
-       << " chosenGate=" << gate << "\n";
+    EV_TRACE << "SDN: [EA-ML] src=" << srcAddr
+             << " dest=" << destAddr
+             << " mlGate=" << predictedPath
+             << " chosenGate=" << gate << "\n";
 
     return gate;
 }
@@ -408,10 +865,10 @@ int SDNController_ML::findBestRouteTraditional(int srcAddr, int destAddr)
 
     int gate = selectEnergyAwareGate(srcAddr, destAddr, directGate);
 
-    EV << "SDN: [EA-TRAD] src=" << srcAddr
-       << " dest=" << destAddr
-       << " directGate=" << directGate
-       << " chosenGate=" << gate << "\n";
+    EV_TRACE << "SDN: [EA-TRAD] src=" << srcAddr
+             << " dest=" << destAddr
+             << " directGate=" << directGate
+             << " chosenGate=" << gate << "\n";
 
     return gate;
 }
@@ -419,92 +876,99 @@ int SDNController_ML::findBestRouteTraditional(int srcAddr, int destAddr)
 void SDNController_ML::exportToDataset(const FlowData &data)
 {
     if (datasetStream.is_open()) {
-        datasetStream << std::fixed << std::setprecision(6)
-                      << data.timestamp.dbl() << ","
-                      << data.srcAddr << ","
-                      << data.destAddr << ","
-                      << data.srcBattery << ","
-                      << data.destBattery << ","
-                      << data.pathDistance << ","
-                      << data.chosenPath << ","
-                      << data.pathDelay << ","
-                      << data.pathQuality << "\n";
+        writeDatasetRow(datasetStream, data);
         datasetStream.flush();
 
-        EV << "  Data exported to CSV (row #" << trainingDataset.size() + 1 << ")\n";
+        EV_TRACE << "  Data exported to CSV (row #" << trainingDataset.size() + 1 << ")\n";
     } else {
-        EV << "  WARNING: Dataset file not open!\n";
+        EV_WARN << "  WARNING: Dataset file not open!\n";
     }
 }
 
 void SDNController_ML::trainMLModel()
 {
-    EV << "\n*** TRAINING ML MODEL ***\n";
-    EV << "Training samples: " << trainingDataset.size() << "\n";
+    EV_INFO << "\n*** TRAINING ML MODEL ***\n";
+    EV_INFO << "Training samples: " << trainingDataset.size() << "\n";
 
-    mlModel.trainingSet = trainingDataset;
+    mlModel.classifier->train(trainingDataset);
     mlModel.isTrained = true;
-
-    EV << "ML Model trained successfully!\n";
-    EV << "Model type: K-Nearest Neighbors (k=" << mlModel.k << ")\n";
-    EV << "*************************\n\n";
+    updateMemoryAccounting();
+
+    EV_INFO << "ML Model trained successfully!\n";
+    EV_INFO << "Model type: " << mlModel.classifier->getName();
+    if (mlModel.classifier->isOnline())
+        EV_INFO << " (online, keeps learning)\n";
+    else
+        EV_INFO << " (k=" << mlModel.k << ")\n";
+    EV_INFO << "*************************\n\n";
 }
 
-int SDNController_ML::predictBestPath(int srcAddr, int destAddr)
+// prediction: the model's gate if already known (batched decisions), else -1
+int SDNController_ML::predictBestPath(const FlowData &flow, int prediction)
 {
-    if (!mlModel.isTrained || mlModel.trainingSet.empty()) {
-        return findBestRouteTraditional(srcAddr, destAddr);
+    if (!mlModel.isTrained || mlModel.classifier->getNumSamples() == 0) {
+        return findBestRouteTraditional(flow.srcAddr, flow.destAddr);
     }
 
-    FlowData query;
-    query.srcAddr = srcAddr;
-    query.destAddr = destAddr;
-    query.srcBattery = (nodeDatabase.find(srcAddr) != nodeDatabase.end()) ?
-                       nodeDatabase[srcAddr].batteryLevel : 100.0;
-    query.destBattery = (nodeDatabase.find(destAddr) != nodeDatabase.end()) ?
-                        nodeDatabase[destAddr].batteryLevel : 100.0;
-    query.pathDistance = (nodeDatabase.find(srcAddr) != nodeDatabase.end()) ?
-                         nodeDatabase[srcAddr].distance : 50.0;
+    int bestPath = prediction >= 0 ? prediction : mlModel.classifier->predict(flow);
 
-    std::vector<std::pair<double, int>> distances;
-
-    for (const auto &sample : mlModel.trainingSet) {
-        double dist = calculateEuclideanDistance(query, sample);
-        distances.push_back({dist, sample.chosenPath});
+    if (bestPath < 0 || bestPath >= gateSize("out")) {
+        bestPath = findGateToDestination(flow.destAddr);
     }
 
-    std::sort(distances.begin(), distances.end());
-
-    std::map<int, int> votes;
-    int limit = std::min((int)distances.size(), mlModel.k);
-
-    for (int i = 0; i < limit; i++) {
-        votes[distances[i].second]++;
-    }
+    if (mlModel.classifier->isOnline() || trackMLAccuracy)
+        unlabelledPrediction = bestPath;
+    return bestPath;
+}
 
-    int bestPath = -1;
-    int maxVotes = 0;
-    for (auto &vote : votes) {
-        if (vote.second > maxVotes) {
-            maxVotes = vote.second;
-            bestPath = vote.first;
-        }
+// Scores the prediction of the decision in progress against the traditional
+// gate, which online models also learn.
+void SDNController_ML::labelPrediction(const FlowData &flow)
+{
+    if (unlabelledPrediction < 0)
+        return;
+    int label = traditionalGate(flow.destAddr);
+    mlPredictions++;
+    mlAgreements += unlabelledPrediction == label;
+    unlabelledPrediction = -1;
+    if (mlModel.classifier->isOnline()) {
+        FlowData sample = flow;
+        sample.chosenPath = label;
+        mlModel.classifier->learn(sample);
     }
+}
 
-    if (bestPath < 0 || bestPath >= gateSize("out")) {
-        bestPath = findGateToDestination(destAddr);
-    }
+FlowData SDNController_ML::makeFlowContext(int srcAddr, int destAddr)
+{
+    auto src = nodeDatabase.find(srcAddr);
+    auto dest = nodeDatabase.find(destAddr);
+
+    FlowData flow;
+    flow.srcAddr = srcAddr;
+    flow.destAddr = destAddr;
+    flow.srcBattery = src != nodeDatabase.end() ? src->second.batteryLevel : 100.0;
+    flow.destBattery = dest != nodeDatabase.end() ? dest->second.batteryLevel : 100.0;
+    flow.pathDistance = src != nodeDatabase.end() ? src->second.distance : 50.0;
+    flow.chosenPath = -1;
+    flow.pathDelay = 0;
+    flow.pathQuality = 0;
+    flow.timestamp = simTime().dbl();
+    return flow;
+}
 
-    return bestPath;
+// The label of the training samples: the traditional policy's gate, without
+// its logging and without touching the score margin of the decision in progress.
+int SDNController_ML::traditionalGate(int destAddr)
+{
+    int directGate = findGateToDestination(destAddr);
+    if (!energyAwareRouting)
+        return directGate;
+    return ::selectEnergyAwareGate(nodeDatabase, scoringNeighbors, energyWeights, directGate, simTime().dbl());
 }
 
 double SDNController_ML::calculateEuclideanDistance(const FlowData &a, const FlowData &b)
 {
-    double d1 = (a.srcBattery - b.srcBattery) / 100.0;
-    double d2 = (a.destBattery - b.destBattery) / 100.0;
-    double d3 = (a.pathDistance - b.pathDistance) / 100.0;
-
-    return sqrt(d1*d1 + d2*d2 + d3*d3);
+    return flowFeatureDistance(a, b);
 }
 
 // CHANGE 8: Path quality metric now also reflects *battery levels*,
@@ -528,28 +992,461 @@ double SDNController_ML::calculatePathQuality(int srcAddr, int destAddr, int pat
     return std::max(0.0, std::min(100.0, quality));
 }
 
+void SDNController_ML::banditContext(int srcAddr, int destAddr, int neighbor, double *x)
+{
+    auto src = nodeDatabase.find(srcAddr);
+    auto dest = nodeDatabase.find(destAddr);
+    auto next = nodeDatabase.find(neighbor);
+    double nextBattery = next != nodeDatabase.end() ? next->second.batteryLevel : 100.0;
+
+    x[0] = 1.0;
+    x[1] = (src != nodeDatabase.end() ? src->second.batteryLevel : 100.0) / 100.0;
+    x[2] = (dest != nodeDatabase.end() ? dest->second.batteryLevel : 100.0) / 100.0;
+    x[3] = nextBattery / 100.0;
+    x[4] = (next != nodeDatabase.end() ? next->second.linkQuality : 90.0) / 100.0;
+    x[5] = (next != nodeDatabase.end() ? std::min(next->second.distance, 100.0) : 50.0) / 100.0;
+    x[6] = neighbor == destAddr ? 1.0 : 0.0;
+    x[7] = nextBattery < lowBatteryThreshold ? 1.0 : 0.0;
+}
+
+int SDNController_ML::selectBanditGate(int srcAddr, int destAddr)
+{
+    expireBanditDecisions();
+    for (size_t i = 0; i < banditArms.size(); i++)
+        banditContext(srcAddr, destAddr, scoringNeighbors[banditArms[i]], &banditContexts[i * BANDIT_FEATURES]);
+    return bandit->select(banditArms.size(), banditArms.data(), banditContexts.data(), &lastScoreMargin);
+}
+
+void SDNController_ML::banditRouted(long packetId, int gate)
+{
+    // the context was computed for this gate by selectBanditGate()
+    auto arm = std::find(banditArms.begin(), banditArms.end(), gate);
+    if (arm == banditArms.end())
+        return;
+    BanditPending& decision = banditPending[packetId];
+    decision.gate = gate;
+    decision.neighbor = scoringNeighbors[gate];
+    decision.routedAt = simTime();
+    std::copy_n(&banditContexts[(arm - banditArms.begin()) * BANDIT_FEATURES], BANDIT_FEATURES, decision.context);
+    banditPendingOrder.push_back({simTime(), packetId});
+}
+
+void SDNController_ML::banditReward(const BanditPending& decision, double reward)
+{
+    bandit->update(decision.gate, decision.context, reward);
+    banditRewardSum += reward;
+    emit(banditRewardSignal, reward);
+}
+
+void SDNController_ML::expireBanditDecisions()
+{
+    // packets that did not arrive in time were lost on the way
+    simtime_t limit = simTime() - banditFeedbackTimeout;
+    while (!banditPendingOrder.empty() && banditPendingOrder.front().first < limit) {
+        auto it = banditPending.find(banditPendingOrder.front().second);
+        banditPendingOrder.pop_front();
+        if (it == banditPending.end())
+            continue;  // delivered
+        banditLosses++;
+        banditReward(it->second, banditLossReward);
+        banditPending.erase(it);
+    }
+}
+
+void SDNController_ML::receiveSignal(cComponent *source, simsignal_t signalID, const SimTime& value, cObject *details)
+{
+    Packet *pkt = dynamic_cast<Packet *>(details);
+    if (signalID != endToEndDelaySignal || !pkt)
+        return;
+    auto it = banditPending.find(pkt->getId());
+    if (it == banditPending.end())
+        return;  // not routed by the bandit, or already counted as lost
+
+    Enter_Method_Silent();
+    const BanditPending& decision = it->second;
+    auto next = nodeDatabase.find(decision.neighbor);
+    double nextBattery = next != nodeDatabase.end() ? next->second.batteryLevel : 100.0;
+    double energyCost = 1.0 - nextBattery / 100.0 + (nextBattery < lowBatteryThreshold ? 1.0 : 0.0);
+    double reward = -value.dbl() / banditDelayScale - banditEnergyWeight * energyCost;
+
+    banditRewards++;
+    banditReward(decision, std::max(reward, banditLossReward));
+    banditPending.erase(it);
+}
+
+int SDNController_ML::decisionPolicy(bool usedML) const
+{
+    if (banditRouting)
+        return POLICY_BANDIT;
+    return usedML ? (energyAwareRouting ? POLICY_ML_ENERGY_AWARE : POLICY_ML)
+                  : (energyAwareRouting ? POLICY_ENERGY_AWARE : POLICY_TRADITIONAL);
+}
+
+// The gate policy would choose for flow, without side effects; -1 if it
+// cannot decide. mlGate caches the model's prediction across the ML policies
+// (-2 = not predicted yet).
+int SDNController_ML::shadowGate(int policy, const FlowData &flow, int directGate, int &mlGate)
+{
+    double now = simTime().dbl();
+    switch (policy) {
+        case POLICY_TRADITIONAL:
+            return directGate;
+        case POLICY_ENERGY_AWARE:
+            return ::selectEnergyAwareGate(nodeDatabase, scoringNeighbors, energyWeights, directGate, now);
+        case POLICY_ML:
+        case POLICY_ML_ENERGY_AWARE:
+            if (mlGate == -2) {
+                // reuse the live prediction: the model may have learned this flow since
+                mlGate = lastMLPrediction;
+                if (mlGate < 0 && mlModel.isTrained && mlModel.classifier->getNumSamples() > 0) {
+                    mlGate = mlModel.classifier->predict(flow);
+                    if (mlGate < 0 || mlGate >= gateSize("out"))
+                        mlGate = directGate;
+                }
+            }
+            if (mlGate < 0)
+                return -1;
+            if (policy == POLICY_ML)
+                return mlGate;
+            return ::selectEnergyAwareGate(nodeDatabase, scoringNeighbors, energyWeights, mlGate, now);
+        default:
+            return -1;
+    }
+}
+
+void SDNController_ML::scoreShadowGate(ShadowStats &stats, const FlowData &flow, int gate, int liveGate)
+{
+    int neighbor = gate < (int)gateNeighbors.size() ? gateNeighbors[gate] : -1;
+    auto next = nodeDatabase.find(neighbor);
+    double nextBattery = next != nodeDatabase.end() ? next->second.batteryLevel : 100.0;
+
+    stats.decisions++;
+    stats.agreements += gate == liveGate;
+    stats.nextHopBatterySum += nextBattery;
+    stats.lowBatteryHops += nextBattery < lowBatteryThreshold;
+    stats.directHops += neighbor == flow.destAddr;
+}
+
+void SDNController_ML::evaluateShadowPolicies(const FlowData &flow, int liveGate)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    int directGate = findGateToDestination(flow.destAddr);
+    int mlGate = -2;
+    scoreShadowGate(shadowStats[NUM_POLICIES], flow, liveGate, liveGate);
+    for (int policy : shadowPolicies) {
+        int gate = shadowGate(policy, flow, directGate, mlGate);
+        if (gate >= 0)
+            scoreShadowGate(shadowStats[policy], flow, gate, liveGate);
+    }
+
+    shadowEvaluations++;
+    shadowTimeNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+}
+
+void SDNController_ML::recordShadowStats()
+{
+    for (int policy = 0; policy <= NUM_POLICIES; policy++) {
+        const ShadowStats& stats = shadowStats[policy];
+        if (stats.decisions == 0)
+            continue;
+        std::string prefix = std::string("shadow:") + (policy == NUM_POLICIES ? "live" : policyNames[policy]);
+        double n = stats.decisions;
+        recordScalar((prefix + ":decisions").c_str(), n);
+        recordScalar((prefix + ":agreement").c_str(), stats.agreements / n);
+        recordScalar((prefix + ":nextHopBattery").c_str(), stats.nextHopBatterySum / n, "%");
+        recordScalar((prefix + ":lowBatteryHops").c_str(), stats.lowBatteryHops / n);
+        recordScalar((prefix + ":directHops").c_str(), stats.directHops / n);
+    }
+    if (shadowEvaluations > 0)
+        recordScalar("shadow:meanTime", (double)shadowTimeNs / shadowEvaluations, "ns");
+}
+
+void SDNController_ML::sendQRoutingParameters()
+{
+    double exploration = par("qExploration");  // volatile: may follow a schedule over simTime()
+    double energyWeight = par("qEnergyWeight");
+    for (const auto& entry : nodeDatabase) {
+        int gate = findGateToDestination(entry.first);
+        if (gate < 0)
+            continue;
+        Packet *pkt = new Packet("qparams");
+        pkt->setPacketType(QROUTING_PARAMS);
+        pkt->setSrcAddr(myAddress);
+        pkt->setDestAddr(entry.first);
+        pkt->setQExploration(exploration);
+        pkt->setQEnergyWeight(energyWeight);
+        pkt->setByteLength(24);
+        send(pkt, "out", gate);
+    }
+}
+
+void SDNController_ML::collectDecisionLatency(int policy, size_t workingSetSize,
+                                              std::chrono::steady_clock::time_point start)
+{
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    int sizeBucket = 0;
+    for (size_t limit = 100; workingSetSize >= limit && sizeBucket < 4; limit *= 10)
+        sizeBucket++;
+
+    decisionLatency[{policy, sizeBucket}].collect(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+void SDNController_ML::recordDecisionLatency()
+{
+    static const char *sizeNames[] = { "lt100", "lt1k", "lt10k", "lt100k", "ge100k" };
+
+    LatencyHistogram all;
+    for (auto &entry : decisionLatency) {
+        const LatencyHistogram &h = entry.second;
+        std::string prefix = std::string("decisionLatency:") + policyNames[entry.first.first]
+                             + ":" + sizeNames[entry.first.second];
+        recordScalar((prefix + ":count").c_str(), (double)h.getCount());
+        recordScalar((prefix + ":mean").c_str(), h.getMeanNs(), "ns");
+        recordScalar((prefix + ":p50").c_str(), h.getQuantile(0.50), "ns");
+        recordScalar((prefix + ":p90").c_str(), h.getQuantile(0.90), "ns");
+        recordScalar((prefix + ":p99").c_str(), h.getQuantile(0.99), "ns");
+        recordScalar((prefix + ":p999").c_str(), h.getQuantile(0.999), "ns");
+        recordScalar((prefix + ":max").c_str(), (double)h.getMaxNs(), "ns");
+        all.merge(h);
+    }
+
+    if (all.getCount() > 0) {
+        recordScalar("decisionLatency:count", (double)all.getCount());
+        recordScalar("decisionLatency:mean", all.getMeanNs(), "ns");
+        recordScalar("decisionLatency:p50", all.getQuantile(0.50), "ns");
+        recordScalar("decisionLatency:p99", all.getQuantile(0.99), "ns");
+        recordScalar("decisionLatency:max", (double)all.getMaxNs(), "ns");
+    }
+}
+
+void SDNController_ML::loadReplayLog(const char *fileName)
+{
+    DecisionTraceHeader header;
+    std::vector<DecisionRecord> records;
+    try {
+        records = DecisionTrace::load(fileName, header);
+    }
+    catch (std::exception& e) {
+        throw cRuntimeError("SDNController_ML: Cannot load replay log: %s", e.what());
+    }
+    // with the oldest decisions overwritten, the start of the run could not be replayed
+    if (header.totalRecorded > header.capacity)
+        throw cRuntimeError("SDNController_ML: Replay log '%s' holds only the last %u of %llu decisions, "
+                            "record it with a larger decisionTraceSize", fileName, header.capacity,
+                            (unsigned long long)header.totalRecorded);
+
+    for (const DecisionRecord& r : records)
+        if (!(r.flags & DECISION_BACKBONE))
+            replayLog[{r.srcAddr, r.sequence}].decisions.push_back({r.destAddr, r.chosenGate});
+    replaying = true;
+    EV_INFO << "SDN: Replaying " << records.size() << " decisions from " << fileName << "\n";
+}
+
+// Looks up the recorded decision for pkt: true with the gate (-1 for a
+// recorded drop), or false if the log has no usable decision for it, which
+// counts as a divergence and leaves the packet to live routing.
+bool SDNController_ML::replayDecision(const Packet *pkt, int &gate)
+{
+    auto it = replayLog.find({pkt->getSrcAddr(), (uint64_t)pkt->getSequenceNumber()});
+    if (it != replayLog.end() && it->second.next < it->second.decisions.size()) {
+        const ReplayEntry& entry = it->second.decisions[it->second.next++];
+        if (entry.destAddr == pkt->getDestAddr() && entry.gate < gateSize("out")) {
+            gate = entry.gate;
+            replayedDecisions++;
+            return true;
+        }
+    }
+
+    // traffic differs from the recorded run: route this packet live
+    if (replayDivergences++ == 0)
+        EV_WARN << "SDN: Replay diverged at packet " << pkt->getSequenceNumber() << " of " << pkt->getSrcAddr()
+                << " (to " << pkt->getDestAddr() << "), routing live where the log has no usable decision\n";
+    return false;
+}
+
+void SDNController_ML::saveSnapshot()
+{
+    ControllerState state;
+    state.savedAt = simTime().dbl();
+    state.totalFlowsProcessed = totalFlowsProcessed;
+    state.modelTrained = mlModel.isTrained;
+    state.modelK = mlModel.k;
+    state.nodeDatabase = &nodeDatabase;
+    state.trainingDataset = &trainingDataset;
+    static const std::vector<FlowData> noSamples;
+    const std::vector<FlowData> *modelSamples = mlModel.classifier->getSamples();
+    state.modelTrainingSet = modelSamples ? modelSamples : &noSamples;
+    std::vector<double> modelParameters = mlModel.classifier->getParameters();
+    state.modelType = mlModel.classifier->getName();
+    state.modelParameters = &modelParameters;
+
+    try {
+        saveControllerSnapshot(snapshotFile, state);
+    }
+    catch (std::exception& e) {
+        throw cRuntimeError("SDNController_ML: Cannot save snapshot: %s", e.what());
+    }
+    EV_INFO << "SDN: Snapshot saved to " << snapshotFile << " (" << nodeDatabase.size() << " nodes, "
+            << trainingDataset.size() << " samples)\n";
+}
+
+void SDNController_ML::restoreSnapshot(const char *fileName)
+{
+    try {
+        MappedSnapshot snapshot(fileName);
+        const SnapshotHeader& header = snapshot.getHeader();
+
+        nodeDatabase.clear();
+        const NodeMetrics *nodes = snapshot.getNodes();
+        for (uint64_t i = 0; i < header.numNodes; i++) {
+            nodeDatabase.emplace_hint(nodeDatabase.end(), nodes[i].address, nodes[i]);
+            batterySum += nodes[i].batteryLevel;
+            lowBatteryNodes += nodes[i].batteryLevel < lowBatteryThreshold;
+        }
+        trainingDataset.assign(snapshot.getDatasetRows(), snapshot.getDatasetRows() + header.numDatasetRows);
+        mlModel.isTrained = header.modelTrained;
+        if (mlModel.isTrained) {
+            // online models go on with their saved parameters; the others, or a
+            // model of another type, are retrained from the saved samples or,
+            // without those, from the restored dataset
+            if (header.numModelParams > 0 && snapshot.getModelType() == mlModel.classifier->getName())
+                mlModel.classifier->setParameters(snapshot.getModelParameters(), header.numModelParams);
+            else if (header.numModelSamples > 0)
+                mlModel.classifier->train(std::vector<FlowData>(snapshot.getModelSamples(),
+                                                                snapshot.getModelSamples() + header.numModelSamples));
+            else
+                mlModel.classifier->train(trainingDataset);
+        }
+        totalFlowsProcessed = header.totalFlowsProcessed;
+
+        EV_INFO << "SDN: Restored snapshot " << fileName << " taken at t=" << header.savedAt << "s: "
+                << nodeDatabase.size() << " nodes, " << trainingDataset.size() << " samples, ML model "
+                << (mlModel.isTrained ? "trained" : "not trained") << "\n";
+    }
+    catch (std::exception& e) {
+        throw cRuntimeError("SDNController_ML: Cannot restore snapshot: %s", e.what());
+    }
+    updateMemoryAccounting();
+}
+
+void SDNController_ML::traceDecision(const Packet *pkt, int policy, int gate, int flags)
+{
+    if (!decisionTrace.isEnabled())
+        return;
+    DecisionRecord r = DecisionRecord();
+    r.time = simTime().dbl();
+    r.sequence = pkt->getSequenceNumber();
+    r.srcAddr = pkt->getSrcAddr();
+    r.destAddr = pkt->getDestAddr();
+    r.scoreMargin = (float)lastScoreMargin;
+    r.mlPrediction = policy == POLICY_ML || policy == POLICY_ML_ENERGY_AWARE ? lastMLPrediction : -1;
+    r.chosenGate = gate;
+    r.policy = policy;
+    r.flags = flags;
+    decisionTrace.record(r);
+}
+
+void SDNController_ML::saveDecisionTrace()
+{
+    decisionTraceSaved = true;
+    if (decisionTrace.getTotalRecorded() == 0)
+        return;
+    decisionTrace.save(decisionTraceFile);
+}
+
 void SDNController_ML::finish()
 {
-    EV << "\n==== SDN CONTROLLER FINAL REPORT ====\n";
-    EV << "Total nodes discovered: " << nodeDatabase.size() << "\n";
-    EV << "Total flows recorded: " << trainingDataset.size() << "\n";
-    EV << "Total flows processed: " << totalFlowsProcessed << "\n";
-    EV << "ML Model trained: " << (mlModel.isTrained ? "YES" : "NO") << "\n";
-    EV << "Dataset file: " << datasetFile << "\n";
-    EV << "======================================\n";
+    PROFILE_HANDLER_FINISH();
+
+    if (measureDecisionLatency)
+        recordDecisionLatency();
+
+    updateMemoryAccounting();
+    for (const MemoryAccount *account : {&datasetMemory, &modelMemory, &metricsMemory}) {
+        std::string name = std::string("memoryPeak:") + account->getName();
+        recordScalar(name.c_str(), (double)account->getPeak(), "B");
+    }
+
+    if (!snapshotFile.empty())
+        saveSnapshot();
+
+    if (mlPredictions > 0) {
+        recordScalar("mlPredictions", mlPredictions);
+        recordScalar("mlAccuracy", (double)mlAgreements / mlPredictions);
+        recordScalar("mlModelSamples", (double)mlModel.classifier->getNumSamples());
+    }
+
+    if (banditRouting) {
+        recordScalar("banditRewards", banditRewards);
+        recordScalar("banditLosses", banditLosses);
+        recordScalar("banditPending", (double)banditPending.size());
+        if (banditRewards + banditLosses > 0)
+            recordScalar("banditMeanReward", banditRewardSum / (banditRewards + banditLosses));
+    }
+
+    if (!shadowPolicies.empty())
+        recordShadowStats();
+
+    if (batchDecisions) {
+        recordScalar("decisionBatches", decisionBatches);
+        recordScalar("decisionsPending", (double)pendingDecisions.size());
+        if (decisionBatches > 0)
+            recordScalar("decisionBatchSize:mean", (double)batchedDecisions / decisionBatches);
+        if (batchInferences > 0) {
+            recordScalar("decisionBatch:inferenceTime", (double)batchInferenceNs / batchInferences, "ns");
+            recordScalar("decisionBatch:unbatchedInferenceTime", (double)unbatchedInferenceNs / batchInferences, "ns");
+            if (batchInferenceNs > 0)
+                recordScalar("decisionBatch:speedup", (double)unbatchedInferenceNs / batchInferenceNs);
+        }
+    }
+
+    if (domainAddressBlock > 0) {
+        recordScalar("backboneForwards", backboneForwards);
+        recordScalar("hopLimitDrops", hopLimitDrops);
+    }
+
+    if (replaying) {
+        recordScalar("replayedDecisions", replayedDecisions);
+        recordScalar("replayDrops", replayDrops);
+        recordScalar("replayDivergences", replayDivergences);
+    }
+
+    try {
+        saveDecisionTrace();
+    }
+    catch (std::exception& e) {
+        EV_WARN << "SDN: Could not save decision trace: " << e.what() << "\n";
+    }
+
+    EV_INFO << "\n==== SDN CONTROLLER FINAL REPORT ====\n";
+    EV_INFO << "Total nodes discovered: " << nodeDatabase.size() << "\n";
+    EV_INFO << "Total flows recorded: " << trainingDataset.size() << "\n";
+    EV_INFO << "Total flows processed: " << totalFlowsProcessed << "\n";
+    EV_INFO << "ML Model trained: " << (mlModel.isTrained ? "YES" : "NO") << "\n";
+    EV_INFO << "Dataset file: " << datasetFile << "\n";
+    if (decisionTrace.getTotalRecorded() > 0)
+        EV_INFO << "Decision trace: " << decisionTraceFile << " (last "
+                << std::min<uint64_t>(decisionTrace.getTotalRecorded(), decisionTrace.getCapacity())
+                << " of " << decisionTrace.getTotalRecorded() << " decisions)\n";
+    EV_INFO << "======================================\n";
 
     if (datasetStream.is_open()) {
         datasetStream.close();
-        EV << "Dataset file closed.\n";
+        EV_INFO << "Dataset file closed.\n";
     }
 
     if (nodeDatabase.size() > 0) {
-        EV << "\nFinal Node Statistics:\n";
+        EV_INFO << "\nFinal Node Statistics:\n";
         for (auto &entry : nodeDatabase) {
             NodeMetrics &nm = entry.second;
-            EV << "Node " << nm.address << ": "
-               << "Battery=" << nm.batteryLevel << "%, "
-               << "Quality=" << nm.linkQuality << "%\n";
+            EV_INFO << "Node " << nm.address << ": "
+                    << "Battery=" << nm.batteryLevel << "%, "
+                    << "Drain=" << -nm.batteryTrend << "%/s, "
+                    << "Quality=" << nm.linkQuality << "%\n";
         }
     }
 }
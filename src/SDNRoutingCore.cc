@@ -0,0 +1,190 @@
+//
+// Routing math of the SDN controller (see SDNRoutingCore.h)
+//
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include "SDNRoutingCore.h"
+
+double flowFeatureDistance(const FlowData& a, const FlowData& b)
+{
+    double d1 = (a.srcBattery - b.srcBattery) / 100.0;
+    double d2 = (a.destBattery - b.destBattery) / 100.0;
+    double d3 = (a.pathDistance - b.pathDistance) / 100.0;
+
+    return sqrt(d1*d1 + d2*d2 + d3*d3);
+}
+
+int knnPredict(const std::vector<FlowData>& trainingSet, const FlowData& query, int k)
+{
+    std::vector<std::pair<double, int>> distances;
+
+    for (const auto& sample : trainingSet) {
+        double dist = flowFeatureDistance(query, sample);
+        distances.push_back({dist, sample.chosenPath});
+    }
+
+    std::sort(distances.begin(), distances.end());
+
+    std::map<int, int> votes;
+    int limit = std::min((int)distances.size(), k);
+
+    for (int i = 0; i < limit; i++) {
+        votes[distances[i].second]++;
+    }
+
+    int bestPath = -1;
+    int maxVotes = 0;
+    for (auto& vote : votes) {
+        if (vote.second > maxVotes) {
+            maxVotes = vote.second;
+            bestPath = vote.first;
+        }
+    }
+
+    return bestPath;
+}
+
+void updateBatteryForecast(NodeMetrics& nm, double batteryLevel, double now, bool firstReport,
+                           double alpha, double beta)
+{
+    double dt = now - nm.lastUpdate;
+    if (firstReport) {
+        nm.batteryForecast = batteryLevel;
+        nm.batteryTrend = 0;
+        return;
+    }
+    if (dt <= 0) {
+        nm.batteryForecast = alpha * batteryLevel + (1 - alpha) * nm.batteryForecast;
+        return;
+    }
+
+    // Holt's linear trend for irregularly spaced reports: the trend is a rate
+    double level = alpha * batteryLevel + (1 - alpha) * (nm.batteryForecast + nm.batteryTrend * dt);
+    nm.batteryTrend = beta * (level - nm.batteryForecast) / dt + (1 - beta) * nm.batteryTrend;
+    nm.batteryForecast = level;
+}
+
+double predictTimeToDepletion(const NodeMetrics& nm, double threshold, double now)
+{
+    double level = nm.batteryForecast + nm.batteryTrend * std::max(now - nm.lastUpdate, 0.0);
+    if (level <= threshold)
+        return 0;
+    if (nm.batteryTrend >= 0)
+        return INFINITY;
+    return (level - threshold) / -nm.batteryTrend;
+}
+
+int selectEnergyAwareGate(const std::map<int, NodeMetrics>& nodeDatabase,
+                          const std::vector<int>& gateNeighbors,
+                          const EnergyWeights& weights, int preferredGate, double now,
+                          double *scoreMargin)
+{
+    int numGates = gateNeighbors.size();
+    if (scoreMargin)
+        *scoreMargin = NAN;
+    if (numGates <= 0)
+        return -1;
+
+    // Compute average battery to define a fairness baseline.
+    double avgBattery = 100.0;
+    if (!nodeDatabase.empty()) {
+        double sum = 0.0;
+        int count = 0;
+        for (auto& kv : nodeDatabase) {
+            sum += kv.second.batteryLevel;
+            count++;
+        }
+        if (count > 0)
+            avgBattery = sum / count;
+    }
+
+    double bestScore = -1e9;
+    double runnerUpScore = -1e9;
+    int bestGate = preferredGate;
+    int candidates = 0;
+
+    for (int i = 0; i < numGates; i++) {
+        int neighborAddr = gateNeighbors[i];
+        if (neighborAddr < 0)
+            continue;
+
+        // Default (optimistic) metrics if we have never seen this neighbor.
+        double battery   = 100.0;
+        double quality   = 90.0;
+        double distance  = 50.0;
+        double degree    = 1.0;
+        double depletionRisk = 0.0;   // 1 = predicted to reach the threshold now
+
+        auto it = nodeDatabase.find(neighborAddr);
+        if (it != nodeDatabase.end()) {
+            const NodeMetrics& nm = it->second;
+            battery  = nm.batteryLevel;
+            quality  = nm.linkQuality;
+            distance = 100.0 - std::min(nm.distance, 100.0); // closer → higher score
+            degree   = (double)nm.connectedNeighbors;
+            if (weights.depletion > 0) {
+                double timeLeft = predictTimeToDepletion(nm, weights.lowBatteryThreshold, now);
+                if (timeLeft < weights.depletionHorizon)
+                    depletionRisk = 1.0 - timeLeft / weights.depletionHorizon;
+            }
+        }
+
+        double fairnessPenalty = 0.0;
+        if (battery < avgBattery)
+            fairnessPenalty = (avgBattery - battery);
+
+        double score =
+            weights.battery      * battery   +
+            weights.linkQuality  * quality   +
+            weights.distance     * distance  +
+            weights.fairness     * degree    -
+            weights.fairness     * fairnessPenalty;
+
+        // Strong penalty if node is below lowBatteryThreshold
+        if (battery < weights.lowBatteryThreshold)
+            score -= 50.0;
+
+        // ... and, scaled by the depletion weight, as it is predicted to get there
+        score -= weights.depletion * 50.0 * depletionRisk;
+
+        // Small bias to keep the original ML/traditional suggestion when scores tie.
+        if (i == preferredGate)
+            score += 5.0;
+
+        candidates++;
+        if (score > bestScore) {
+            runnerUpScore = bestScore;
+            bestScore = score;
+            bestGate  = i;
+        }
+        else if (score > runnerUpScore) {
+            runnerUpScore = score;
+        }
+    }
+
+    if (scoreMargin && candidates >= 2)
+        *scoreMargin = bestScore - runnerUpScore;
+    return bestGate;
+}
+
+void writeDatasetHeader(std::ostream& os)
+{
+    os << "timestamp,src_addr,dest_addr,src_battery,dest_battery,"
+       << "path_distance,chosen_path,path_delay,path_quality\n";
+}
+
+void writeDatasetRow(std::ostream& os, const FlowData& data)
+{
+    os << std::fixed << std::setprecision(6)
+       << data.timestamp << ","
+       << data.srcAddr << ","
+       << data.destAddr << ","
+       << data.srcBattery << ","
+       << data.destBattery << ","
+       << data.pathDistance << ","
+       << data.chosenPath << ","
+       << data.pathDelay << ","
+       << data.pathQuality << "\n";
+}
@@ -0,0 +1,106 @@
+//
+// Routing math of the SDN controller, kept free of the simulation kernel
+// so that it can be driven in isolation (see bench/controller_bench.cc).
+//
+
+#ifndef __SDNROUTINGCORE_H
+#define __SDNROUTINGCORE_H
+
+#include <map>
+#include <ostream>
+#include <vector>
+
+/**
+ * Per-node view of the controller, updated from DISCOVERY packets.
+ */
+struct NodeMetrics {
+    int address;
+    double batteryLevel;
+    double distance;
+    double avgDelay;
+    double packetLoss;
+    double throughput;
+    int hopCount;
+    double linkQuality;
+    double lastUpdate;    // simulation time of the last discovery [s]
+    int connectedNeighbors;
+    double batteryForecast;   // Holt-smoothed battery level at lastUpdate [%]
+    double batteryTrend;      // Holt-smoothed battery change [%/s], negative while draining
+};
+
+/**
+ * One routing decision; rows of the training dataset and KNN samples.
+ */
+struct FlowData {
+    int srcAddr;
+    int destAddr;
+    double srcBattery;
+    double destBattery;
+    double pathDistance;
+    int chosenPath;
+    double pathDelay;
+    double pathQuality;
+    double timestamp;     // simulation time of the decision [s]
+};
+
+/**
+ * Tuning knobs of the energy-aware gate scoring (SDNController_ML.ned).
+ */
+struct EnergyWeights {
+    double battery;
+    double linkQuality;
+    double distance;
+    double fairness;
+    double lowBatteryThreshold;
+    double depletion;           // weight of the predicted depletion (0 = current level only)
+    double depletionHorizon;    // [s] depletion predicted within this time is penalized
+};
+
+// destination address -> output gate index
+typedef std::map<int, int> RoutingTable;
+
+/** Distance in the normalized (srcBattery, destBattery, pathDistance) feature space. */
+double flowFeatureDistance(const FlowData& a, const FlowData& b);
+
+/**
+ * Majority vote of the k nearest samples; ties go to the lowest gate index.
+ * Returns -1 for an empty training set.
+ */
+int knnPredict(const std::vector<FlowData>& trainingSet, const FlowData& query, int k);
+
+/**
+ * Folds the battery level reported at time now into the Holt linear-trend
+ * forecast of nm, in O(1); call it before nm.lastUpdate is advanced. The
+ * first report of a node (firstReport) starts the forecast without a trend.
+ * alpha and beta are the smoothing factors of level and trend.
+ */
+void updateBatteryForecast(NodeMetrics& nm, double batteryLevel, double now, bool firstReport,
+                           double alpha, double beta);
+
+/**
+ * Predicted time [s] from now until the battery of nm falls to threshold:
+ * 0 if the forecast is already there, infinity if the battery is not draining.
+ */
+double predictTimeToDepletion(const NodeMetrics& nm, double threshold, double now);
+
+/**
+ * Scores every gate by the metrics of the neighbour behind it and returns the
+ * best one; preferredGate gets a small bonus. gateNeighbors holds the
+ * neighbour address per gate, negative entries are not candidates. With
+ * weights.depletion set, neighbours predicted to reach lowBatteryThreshold
+ * within depletionHorizon of now are penalized as well.
+ * If scoreMargin is given, it receives the difference between the best and
+ * the runner-up score (NaN with fewer than two candidates).
+ */
+int selectEnergyAwareGate(const std::map<int, NodeMetrics>& nodeDatabase,
+                          const std::vector<int>& gateNeighbors,
+                          const EnergyWeights& weights, int preferredGate, double now,
+                          double *scoreMargin = nullptr);
+
+/** Header line of the exported dataset CSV. */
+void writeDatasetHeader(std::ostream& os);
+
+/** Appends one decision as a CSV row (same columns as the header). */
+void writeDatasetRow(std::ostream& os, const FlowData& data);
+
+#endif
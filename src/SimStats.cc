@@ -0,0 +1,152 @@
+//
+// Simulation speed telemetry (see SimStats.ned)
+//
+
+#include <chrono>
+#include <omnetpp.h>
+
+using namespace omnetpp;
+
+/**
+ * Periodically samples how fast the simulation runs: events per wall-clock
+ * second, simulated seconds per wall-clock second, the length of the future
+ * event set and the number of live messages. The rates of a sample cover the
+ * interval since the previous sample; finish() records totals and peaks.
+ */
+class SimStats : public cSimpleModule
+{
+  private:
+    typedef std::chrono::steady_clock Clock;
+
+    // configuration
+    simtime_t sampleInterval;
+
+    // state
+    cMessage *sampleTimer = nullptr;
+    Clock::time_point startWallTime;
+    Clock::time_point lastWallTime;
+    int64_t startEventNumber;
+    int64_t lastEventNumber;
+    simtime_t startSimTime;
+    simtime_t lastSimTime;
+
+    // statistics
+    double peakEventRate = 0;
+    double minSimSpeed = -1;
+    int peakFesLength = 0;
+    uint64_t peakLiveMessages = 0;
+    long numSamples = 0;
+
+    // signals
+    simsignal_t eventRateSignal;
+    simsignal_t simSpeedSignal;
+    simsignal_t fesLengthSignal;
+    simsignal_t liveMessagesSignal;
+
+  public:
+    virtual ~SimStats();
+
+  protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
+    void takeSample();
+};
+
+Define_Module(SimStats);
+
+SimStats::~SimStats()
+{
+    cancelAndDelete(sampleTimer);
+}
+
+void SimStats::initialize()
+{
+    sampleInterval = par("sampleInterval").doubleValue();
+
+    eventRateSignal = registerSignal("eventRate");
+    simSpeedSignal = registerSignal("simSpeed");
+    fesLengthSignal = registerSignal("fesLength");
+    liveMessagesSignal = registerSignal("liveMessages");
+
+    startWallTime = lastWallTime = Clock::now();
+    startEventNumber = lastEventNumber = getSimulation()->getEventNumber();
+    startSimTime = lastSimTime = simTime();
+
+    WATCH(peakEventRate);
+    WATCH(peakFesLength);
+    WATCH(peakLiveMessages);
+
+    // sampleInterval = 0 turns the module into a pure start/end summary
+    if (sampleInterval > 0) {
+        sampleTimer = new cMessage("sample");
+        scheduleAt(simTime() + sampleInterval, sampleTimer);
+    }
+}
+
+void SimStats::handleMessage(cMessage *msg)
+{
+    ASSERT(msg == sampleTimer);
+    takeSample();
+    scheduleAt(simTime() + sampleInterval, sampleTimer);
+}
+
+void SimStats::takeSample()
+{
+    Clock::time_point now = Clock::now();
+    int64_t eventNumber = getSimulation()->getEventNumber();
+    double wallSeconds = std::chrono::duration<double>(now - lastWallTime).count();
+
+    int fesLength = getSimulation()->getFES()->getLength();
+    uint64_t liveMessages = cMessage::getLiveMessageCount();
+    peakFesLength = std::max(peakFesLength, fesLength);
+    peakLiveMessages = std::max(peakLiveMessages, liveMessages);
+    emit(fesLengthSignal, (long)fesLength);
+    emit(liveMessagesSignal, (long)liveMessages);
+
+    // A sample that took no measurable wall time carries no rate information
+    if (wallSeconds > 0) {
+        double eventRate = (eventNumber - lastEventNumber) / wallSeconds;
+        double simSpeed = (simTime() - lastSimTime).dbl() / wallSeconds;
+        peakEventRate = std::max(peakEventRate, eventRate);
+        if (minSimSpeed < 0 || simSpeed < minSimSpeed)
+            minSimSpeed = simSpeed;
+        emit(eventRateSignal, eventRate);
+        emit(simSpeedSignal, simSpeed);
+    }
+
+    lastWallTime = now;
+    lastEventNumber = eventNumber;
+    lastSimTime = simTime();
+    numSamples++;
+}
+
+void SimStats::finish()
+{
+    double wallSeconds = std::chrono::duration<double>(Clock::now() - startWallTime).count();
+    int64_t events = getSimulation()->getEventNumber() - startEventNumber;
+    double simSeconds = (simTime() - startSimTime).dbl();
+
+    peakFesLength = std::max(peakFesLength, getSimulation()->getFES()->getLength());
+    peakLiveMessages = std::max(peakLiveMessages, cMessage::getLiveMessageCount());
+
+    recordScalar("events", (double)events);
+    recordScalar("elapsedTime", wallSeconds, "s");
+    if (wallSeconds > 0) {
+        recordScalar("meanEventRate", events / wallSeconds);
+        recordScalar("meanSimSpeed", simSeconds / wallSeconds);
+    }
+    if (numSamples > 0) {
+        recordScalar("peakEventRate", peakEventRate);
+        recordScalar("minSimSpeed", minSimSpeed);
+    }
+    recordScalar("peakFesLength", peakFesLength);
+    recordScalar("peakLiveMessages", (double)peakLiveMessages);
+    recordScalar("totalMessages", (double)cMessage::getTotalMessageCount());
+
+    EV_INFO << "SimStats: " << events << " events in " << wallSeconds << "s wall time ("
+            << (wallSeconds > 0 ? events / wallSeconds : 0) << " ev/s, "
+            << (wallSeconds > 0 ? simSeconds / wallSeconds : 0) << " simsec/s), "
+            << "peak FES length " << peakFesLength
+            << ", peak live messages " << peakLiveMessages << endl;
+}
@@ -0,0 +1,212 @@
+//
+// Live telemetry in POSIX shared memory (see TelemetryExporter.ned)
+//
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <omnetpp.h>
+#include "TelemetryShm.h"
+
+using namespace omnetpp;
+
+/**
+ * Collects controller and network metrics from signals (routing decisions,
+ * drops, ML model size, queue lengths, node batteries) and publishes them
+ * into a seqlock ring in POSIX shared memory every publishInterval of
+ * wall-clock time. It only listens: no events are scheduled and no module
+ * is touched, so the run behaves exactly as without it.
+ */
+class TelemetryExporter : public cSimpleModule, public cListener
+{
+  private:
+    typedef std::chrono::steady_clock Clock;
+
+    // configuration
+    std::string shmName;
+    double publishInterval;
+
+    // state
+    TelemetryRegion *region = nullptr;
+    TelemetrySample sample;
+    std::map<int, int> nodeSlots;       // node address -> index in sample
+    std::map<int, int> queueSlots;      // queue module id -> index in sample
+    Clock::time_point startWallTime;
+    Clock::time_point lastPublishTime;
+    unsigned signalsSinceCheck = 0;
+
+    simsignal_t routingDecisionSignal;
+    simsignal_t dropSignal;
+    simsignal_t memModelSignal;
+    simsignal_t qlenSignal;
+    simsignal_t batteryLevelSignal;
+
+  public:
+    virtual ~TelemetryExporter();
+
+  protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
+
+    virtual void receiveSignal(cComponent *source, simsignal_t signalID, intval_t value, cObject *details) override;
+    virtual void receiveSignal(cComponent *source, simsignal_t signalID, double value, cObject *details) override;
+
+    void openRegion();
+    void closeRegion();
+    void signalReceived();
+    void publish();
+};
+
+Define_Module(TelemetryExporter);
+
+TelemetryExporter::~TelemetryExporter()
+{
+    closeRegion();
+}
+
+void TelemetryExporter::initialize()
+{
+    shmName = par("shmName").stdstringValue();
+    publishInterval = par("publishInterval").doubleValue();
+    if (shmName.empty())
+        return;  // opt-in
+
+    routingDecisionSignal = registerSignal("routingDecision");
+    dropSignal = registerSignal("drop");
+    memModelSignal = registerSignal("memModel");
+    qlenSignal = registerSignal("qlen");
+    batteryLevelSignal = registerSignal("batteryLevel");
+
+    openRegion();
+
+    cModule *network = getSimulation()->getSystemModule();
+    for (simsignal_t signal : {routingDecisionSignal, dropSignal, memModelSignal, qlenSignal, batteryLevelSignal})
+        network->subscribe(signal, this);
+
+    startWallTime = lastPublishTime = Clock::now();
+}
+
+void TelemetryExporter::handleMessage(cMessage *msg)
+{
+    throw cRuntimeError("TelemetryExporter does not receive messages");
+}
+
+void TelemetryExporter::openRegion()
+{
+#ifdef _WIN32
+    throw cRuntimeError("TelemetryExporter: POSIX shared memory is not available on this platform");
+#else
+    int fd = shm_open(shmName.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+        throw cRuntimeError("TelemetryExporter: Cannot create shared memory '%s': %s", shmName.c_str(), strerror(errno));
+    if (ftruncate(fd, sizeof(TelemetryRegion)) != 0) {
+        close(fd);
+        throw cRuntimeError("TelemetryExporter: Cannot size shared memory '%s': %s", shmName.c_str(), strerror(errno));
+    }
+    void *p = mmap(nullptr, sizeof(TelemetryRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        throw cRuntimeError("TelemetryExporter: Cannot map shared memory '%s': %s", shmName.c_str(), strerror(errno));
+
+    // a fresh region per run; readers attached to a previous run see the version reset
+    region = (TelemetryRegion *)p;
+    memset((void *)region, 0, sizeof(TelemetryRegion));
+    region->version = TELEMETRY_VERSION;
+    region->numSlots = TELEMETRY_SLOTS;
+    region->sampleSize = sizeof(TelemetrySample);
+    region->pid = getpid();
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(region->magic, TELEMETRY_MAGIC, sizeof(TELEMETRY_MAGIC));
+
+    memset(&sample, 0, sizeof(sample));
+#endif
+}
+
+void TelemetryExporter::closeRegion()
+{
+#ifndef _WIN32
+    if (!region)
+        return;
+    munmap((void *)region, sizeof(TelemetryRegion));
+    region = nullptr;
+    // readers that are attached keep their mapping
+    shm_unlink(shmName.c_str());
+#endif
+}
+
+void TelemetryExporter::receiveSignal(cComponent *source, simsignal_t signalID, intval_t value, cObject *details)
+{
+    if (signalID == routingDecisionSignal) {
+        sample.routingDecisions++;
+    }
+    else if (signalID == dropSignal) {
+        sample.drops++;
+    }
+    else if (signalID == memModelSignal) {
+        sample.modelBytes = value;
+    }
+    else if (signalID == qlenSignal) {
+        auto it = queueSlots.find(source->getId());
+        if (it == queueSlots.end()) {
+            if (sample.numQueues >= TELEMETRY_MAX_QUEUES)
+                return;
+            it = queueSlots.emplace(source->getId(), sample.numQueues++).first;
+            strncpy(region->queueNames[it->second], source->getFullPath().c_str(), TELEMETRY_NAME_LEN - 1);
+        }
+        sample.queueLength[it->second] = value;
+    }
+    signalReceived();
+}
+
+void TelemetryExporter::receiveSignal(cComponent *source, simsignal_t signalID, double value, cObject *details)
+{
+    if (signalID == batteryLevelSignal) {
+        // emitted by Routing, whose parent node carries the address
+        int address = source->getParentModule()->par("address");
+        auto it = nodeSlots.find(address);
+        if (it == nodeSlots.end()) {
+            if (sample.numNodes >= TELEMETRY_MAX_NODES)
+                return;
+            it = nodeSlots.emplace(address, sample.numNodes).first;
+            sample.nodeAddress[sample.numNodes++] = address;
+        }
+        sample.battery[it->second] = value;
+    }
+    signalReceived();
+}
+
+void TelemetryExporter::signalReceived()
+{
+    // looking at the clock on every signal would cost more than the rest
+    if (++signalsSinceCheck < 256)
+        return;
+    signalsSinceCheck = 0;
+    if (std::chrono::duration<double>(Clock::now() - lastPublishTime).count() >= publishInterval)
+        publish();
+}
+
+void TelemetryExporter::publish()
+{
+    lastPublishTime = Clock::now();
+    sample.eventNumber = getSimulation()->getEventNumber();
+    sample.simTime = simTime().dbl();
+    sample.wallTime = std::chrono::duration<double>(lastPublishTime - startWallTime).count();
+    publishTelemetry(region, sample);
+    sample.index++;
+}
+
+void TelemetryExporter::finish()
+{
+    if (!region)
+        return;
+    publish();
+    region->finished.store(1, std::memory_order_release);
+}
@@ -0,0 +1,93 @@
+//
+// Layout of the live telemetry region in POSIX shared memory, shared by
+// TelemetryExporter and tools/telemetry_reader.
+//
+// The region holds a ring of TELEMETRY_SLOTS samples. Each slot is guarded
+// by a sequence counter (seqlock): the single writer makes it odd, writes
+// the sample and makes it even again; a reader copies the sample and keeps
+// the copy only if the counter was even and unchanged around the copy. The
+// writer never waits for readers, and readers never block the simulation.
+//
+
+#ifndef __TELEMETRYSHM_H
+#define __TELEMETRYSHM_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#define TELEMETRY_MAGIC       "SDNTELE"
+#define TELEMETRY_VERSION     1
+#define TELEMETRY_SLOTS       64
+#define TELEMETRY_MAX_NODES   256
+#define TELEMETRY_MAX_QUEUES  256
+#define TELEMETRY_NAME_LEN    48
+
+struct TelemetrySample {
+    uint64_t index;             // number of this sample since the start of the run
+    int64_t eventNumber;
+    double simTime;             // [s]
+    double wallTime;            // wall-clock seconds since the start of the run
+    uint64_t routingDecisions;
+    uint64_t drops;
+    int64_t modelBytes;         // memory of the trained ML model [B]
+    int32_t numNodes;           // valid entries of nodeAddress/battery
+    int32_t numQueues;          // valid entries of queueLength
+    int32_t nodeAddress[TELEMETRY_MAX_NODES];
+    float battery[TELEMETRY_MAX_NODES];         // [%]
+    int32_t queueLength[TELEMETRY_MAX_QUEUES];  // names in TelemetryRegion::queueNames
+};
+
+struct TelemetrySlot {
+    std::atomic<uint64_t> sequence;
+    TelemetrySample sample;
+};
+
+struct TelemetryRegion {
+    char magic[8];
+    uint32_t version;
+    uint32_t numSlots;
+    uint32_t sampleSize;
+    int32_t pid;                // of the simulation
+    std::atomic<uint64_t> published;    // samples written so far; latest is (published-1) % numSlots
+    std::atomic<uint32_t> finished;     // 1 once the run has ended
+    char queueNames[TELEMETRY_MAX_QUEUES][TELEMETRY_NAME_LEN];  // fixed once assigned
+    TelemetrySlot slots[TELEMETRY_SLOTS];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "telemetry needs lock-free 64-bit atomics");
+
+/** Writer side: publishes one sample into the next slot. */
+inline void publishTelemetry(TelemetryRegion *region, const TelemetrySample& sample)
+{
+    uint64_t n = region->published.load(std::memory_order_relaxed);
+    TelemetrySlot& slot = region->slots[n % TELEMETRY_SLOTS];
+    uint64_t seq = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&slot.sample, &sample, sizeof(sample));
+    slot.sequence.store(seq + 2, std::memory_order_release);
+    region->published.store(n + 1, std::memory_order_release);
+}
+
+/**
+ * Reader side: copies sample number n (counted from 0) into sample. Returns
+ * false if it is not published yet, was already overwritten, or is being
+ * written right now (try again).
+ */
+inline bool readTelemetry(const TelemetryRegion *region, uint64_t n, TelemetrySample& sample)
+{
+    uint64_t published = region->published.load(std::memory_order_acquire);
+    if (n >= published || published - n > TELEMETRY_SLOTS)
+        return false;
+    const TelemetrySlot& slot = region->slots[n % TELEMETRY_SLOTS];
+    uint64_t before = slot.sequence.load(std::memory_order_acquire);
+    if (before & 1)
+        return false;
+    memcpy(&sample, &slot.sample, sizeof(sample));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+    return before == after && sample.index == n;
+}
+
+#endif
@@ -0,0 +1,285 @@
+//
+// Early end of the run on lifetime and convergence criteria
+// (see TerminationController.ned)
+//
+
+#include <cmath>
+#include <map>
+#include <set>
+#include <vector>
+#include <omnetpp.h>
+
+using namespace omnetpp;
+
+/**
+ * Watches node batteries, a delay statistic and the routing decisions of
+ * the whole network through signals and ends the run as soon as one of the
+ * enabled criteria holds: the first node or a fraction of the nodes has
+ * died, the confidence interval of the statistic is narrow enough (batch
+ * means), or the distribution of routing decisions no longer changes.
+ */
+class TerminationController : public cSimpleModule, public cListener
+{
+  private:
+    // configuration
+    simtime_t minSimTime;
+    double deadBatteryLevel;
+    bool stopOnFirstNodeDeath;
+    double stopOnDeadNodeFraction;
+    double ciRelativeHalfWidth;
+    int ciBatchSize;
+    int ciMinBatches;
+    int decisionWindow;
+    double decisionStability;
+    int decisionStableWindows;
+
+    // node lifetime
+    std::set<cComponent *> nodes;
+    std::set<cComponent *> deadNodes;
+    simtime_t firstNodeDeathTime = -1;
+    std::string firstDeadNode;
+    cMessage *lifetimeCheckMsg = nullptr;  // deaths before minSimTime are checked again then
+
+    // confidence interval over batch means
+    double batchSum = 0;
+    int batchCount = 0;
+    std::vector<double> batchMeans;
+    double ciHalfWidth = NAN;
+    double ciMean = NAN;
+
+    // routing decision distribution: whole run vs. the last window
+    std::map<long, long> totalDecisions;
+    std::map<long, long> windowDecisions;
+    long numDecisions = 0;
+    int stableWindows = 0;
+    double lastDistance = NAN;
+
+    cMessage *stopMsg = nullptr;
+    std::string stopReason;
+
+    simsignal_t batteryLevelSignal;
+    simsignal_t ciSignal;
+    simsignal_t routingDecisionSignal;
+
+  public:
+    virtual ~TerminationController();
+
+  protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
+
+    virtual void receiveSignal(cComponent *source, simsignal_t signalID, intval_t value, cObject *details) override;
+    virtual void receiveSignal(cComponent *source, simsignal_t signalID, double value, cObject *details) override;
+    virtual void receiveSignal(cComponent *source, simsignal_t signalID, const SimTime& value, cObject *details) override;
+
+    void batteryUpdated(cComponent *node, double level);
+    void checkNodeLifetime();
+    void ciSample(double value);
+    void decisionMade(long gate);
+    void stop(const std::string& reason);
+};
+
+Define_Module(TerminationController);
+
+TerminationController::~TerminationController()
+{
+    cancelAndDelete(stopMsg);
+    cancelAndDelete(lifetimeCheckMsg);
+}
+
+void TerminationController::initialize()
+{
+    minSimTime = par("minSimTime");
+    deadBatteryLevel = par("deadBatteryLevel");
+    stopOnFirstNodeDeath = par("stopOnFirstNodeDeath");
+    stopOnDeadNodeFraction = par("stopOnDeadNodeFraction");
+    ciRelativeHalfWidth = par("ciRelativeHalfWidth");
+    ciBatchSize = par("ciBatchSize");
+    ciMinBatches = par("ciMinBatches");
+    decisionWindow = par("decisionWindow");
+    decisionStability = par("decisionStability");
+    decisionStableWindows = par("decisionStableWindows");
+    if (ciBatchSize < 1 || ciMinBatches < 2 || decisionWindow < 1)
+        throw cRuntimeError("TerminationController: ciBatchSize and decisionWindow must be >= 1, ciMinBatches >= 2");
+
+    batteryLevelSignal = registerSignal("batteryLevel");
+    ciSignal = registerSignal(par("ciSignal").stringValue());
+    routingDecisionSignal = registerSignal("routingDecision");
+
+    // node lifetime is always tracked, it is recorded as a result
+    cModule *network = getSimulation()->getSystemModule();
+    network->subscribe(batteryLevelSignal, this);
+    if (ciRelativeHalfWidth > 0)
+        network->subscribe(ciSignal, this);
+    if (decisionStability > 0)
+        network->subscribe(routingDecisionSignal, this);
+
+    stopMsg = new cMessage("stop");
+    lifetimeCheckMsg = new cMessage("lifetimeCheck");
+    WATCH(ciHalfWidth);
+    WATCH(lastDistance);
+}
+
+void TerminationController::handleMessage(cMessage *msg)
+{
+    if (msg == lifetimeCheckMsg) {
+        checkNodeLifetime();
+        return;
+    }
+    ASSERT(msg == stopMsg);
+    EV_INFO << "TerminationController: Ending the run at t=" << simTime() << "s: " << stopReason << "\n";
+    endSimulation();
+}
+
+void TerminationController::receiveSignal(cComponent *source, simsignal_t signalID, intval_t value, cObject *details)
+{
+    if (signalID == routingDecisionSignal)
+        decisionMade(value);
+    else if (signalID == ciSignal)
+        ciSample(value);
+}
+
+void TerminationController::receiveSignal(cComponent *source, simsignal_t signalID, double value, cObject *details)
+{
+    if (signalID == batteryLevelSignal)
+        batteryUpdated(source, value);
+    else if (signalID == ciSignal)
+        ciSample(value);
+}
+
+void TerminationController::receiveSignal(cComponent *source, simsignal_t signalID, const SimTime& value, cObject *details)
+{
+    if (signalID == ciSignal)
+        ciSample(value.dbl());
+}
+
+void TerminationController::batteryUpdated(cComponent *node, double level)
+{
+    nodes.insert(node);
+    if (level > deadBatteryLevel || !deadNodes.insert(node).second)
+        return;
+
+    if (firstNodeDeathTime < 0) {
+        firstNodeDeathTime = simTime();
+        firstDeadNode = node->getParentModule()->getFullPath();
+    }
+    if (!stopOnFirstNodeDeath && stopOnDeadNodeFraction <= 0)
+        return;
+    if (simTime() >= minSimTime)
+        checkNodeLifetime();
+    else if (!lifetimeCheckMsg->isScheduled()) {
+        // no further signal may come to check a death that is already counted
+        Enter_Method_Silent();
+        scheduleAt(minSimTime, lifetimeCheckMsg);
+    }
+}
+
+void TerminationController::checkNodeLifetime()
+{
+    if (stopOnFirstNodeDeath && firstNodeDeathTime >= 0)
+        stop("first node died (" + firstDeadNode + ")");
+    else if (stopOnDeadNodeFraction > 0 && !deadNodes.empty() && deadNodes.size() >= stopOnDeadNodeFraction * nodes.size())
+        stop(std::to_string(deadNodes.size()) + " of " + std::to_string(nodes.size()) + " nodes died");
+}
+
+void TerminationController::ciSample(double value)
+{
+    batchSum += value;
+    if (++batchCount < ciBatchSize)
+        return;
+    batchMeans.push_back(batchSum / batchCount);
+    batchSum = 0;
+    batchCount = 0;
+
+    size_t n = batchMeans.size();
+    if ((int)n < ciMinBatches)
+        return;
+    double mean = 0;
+    for (double m : batchMeans)
+        mean += m;
+    mean /= n;
+    double var = 0;
+    for (double m : batchMeans)
+        var += (m - mean) * (m - mean);
+    var /= n - 1;
+
+    // batch means are close to independent, so the usual t interval applies;
+    // the 95% t quantile comes from a table up to 20 degrees of freedom and
+    // from the Cornish-Fisher expansion around the normal quantile above
+    // (within 0.001 of the exact value there)
+    static const double t95[] = { 0, 12.71, 4.30, 3.18, 2.78, 2.57, 2.45, 2.36, 2.31, 2.26, 2.23,
+                                  2.20, 2.18, 2.16, 2.14, 2.13, 2.12, 2.11, 2.10, 2.09, 2.09 };
+    double t;
+    if (n - 1 < sizeof(t95) / sizeof(t95[0]))
+        t = t95[n - 1];
+    else {
+        const double z = 1.959964;
+        double df = n - 1, z2 = z * z;
+        t = z + z * (z2 + 1) / (4 * df)
+              + z * ((5 * z2 + 16) * z2 + 3) / (96 * df * df)
+              + z * (((3 * z2 + 19) * z2 + 17) * z2 - 15) / (384 * df * df * df)
+              + z * ((((79 * z2 + 776) * z2 + 1482) * z2 - 1920) * z2 - 945) / (92160 * df * df * df * df);
+    }
+    ciHalfWidth = t * std::sqrt(var / n);
+    ciMean = mean;
+    if (mean != 0 && ciHalfWidth / std::fabs(mean) <= ciRelativeHalfWidth)
+        stop(std::string("95% confidence interval of ") + par("ciSignal").stringValue() + " within "
+             + std::to_string(ciRelativeHalfWidth * 100) + "% of the mean");
+}
+
+void TerminationController::decisionMade(long gate)
+{
+    windowDecisions[gate]++;
+    if (++numDecisions % decisionWindow != 0)
+        return;
+
+    // total variation distance between the last window and everything before it
+    long before = numDecisions - decisionWindow;
+    if (before > 0) {
+        double distance = 0;
+        std::set<long> gates;
+        for (auto& entry : totalDecisions)
+            gates.insert(entry.first);
+        for (auto& entry : windowDecisions)
+            gates.insert(entry.first);
+        for (long g : gates) {
+            double p = totalDecisions.count(g) ? (double)totalDecisions[g] / before : 0;
+            double q = windowDecisions.count(g) ? (double)windowDecisions[g] / decisionWindow : 0;
+            distance += std::fabs(p - q);
+        }
+        lastDistance = distance / 2;
+        stableWindows = lastDistance <= decisionStability ? stableWindows + 1 : 0;
+    }
+    for (auto& entry : windowDecisions)
+        totalDecisions[entry.first] += entry.second;
+    windowDecisions.clear();
+
+    if (stableWindows >= decisionStableWindows)
+        stop("routing decision distribution stable for " + std::to_string(stableWindows) + " windows");
+}
+
+void TerminationController::stop(const std::string& reason)
+{
+    if (simTime() < minSimTime || stopMsg->isScheduled())
+        return;
+    // called from the emitting module's event; end the run in an event of our own
+    Enter_Method_Silent();
+    stopReason = reason;
+    scheduleAt(simTime(), stopMsg);
+}
+
+void TerminationController::finish()
+{
+    recordScalar("terminatedEarly", stopReason.empty() ? 0 : 1);
+    recordScalar("endTime", simTime(), "s");
+    recordScalar("deadNodes", (double)deadNodes.size());
+    if (firstNodeDeathTime >= 0)
+        recordScalar("firstNodeDeathTime", firstNodeDeathTime, "s");
+    if (ciRelativeHalfWidth > 0 && !std::isnan(ciHalfWidth)) {
+        recordScalar("ciMean", ciMean);
+        recordScalar("ciHalfWidth", ciHalfWidth);
+    }
+    if (decisionStability > 0 && !std::isnan(lastDistance))
+        recordScalar("decisionDistance", lastDistance);
+}
@@ -0,0 +1,388 @@
+//
+// Compressed output vector format (see VectorCodec.h)
+//
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "VectorCodec.h"
+
+namespace {
+
+/** MSB-first bit stream on top of a byte string. */
+class BitWriter
+{
+  private:
+    std::string& out;
+    uint8_t current = 0;
+    int used = 0;
+
+  public:
+    explicit BitWriter(std::string& out) : out(out) {}
+
+    void write(uint64_t bits, int n) {
+        while (n > 0) {
+            int chunk = std::min(n, 8 - used);
+            uint8_t part = (uint8_t)((bits >> (n - chunk)) & ((1u << chunk) - 1));
+            current |= part << (8 - used - chunk);
+            used += chunk;
+            n -= chunk;
+            if (used == 8) {
+                out += (char)current;
+                current = 0;
+                used = 0;
+            }
+        }
+    }
+
+    void flush() {
+        if (used > 0)
+            out += (char)current;
+        current = 0;
+        used = 0;
+    }
+};
+
+class BitReader
+{
+  private:
+    const unsigned char *p;
+    const unsigned char *end;
+    int used = 0;
+
+  public:
+    BitReader(const char *data, size_t size)
+        : p((const unsigned char *)data), end((const unsigned char *)data + size) {}
+
+    uint64_t read(int n) {
+        uint64_t result = 0;
+        while (n > 0) {
+            if (p >= end)
+                throw std::runtime_error("truncated sample block");
+            int chunk = std::min(n, 8 - used);
+            uint8_t part = (*p >> (8 - used - chunk)) & ((1u << chunk) - 1);
+            result = (result << chunk) | part;
+            used += chunk;
+            n -= chunk;
+            if (used == 8) {
+                p++;
+                used = 0;
+            }
+        }
+        return result;
+    }
+};
+
+// delta-of-delta buckets: control bits, control length, payload bits
+struct DodBucket { uint64_t control; int controlBits; int payloadBits; };
+const DodBucket DOD_BUCKETS[] = { {0x2, 2, 7}, {0x6, 3, 9}, {0xe, 4, 12} };
+
+bool fitsSigned(int64_t v, int bits)
+{
+    int64_t limit = (int64_t)1 << (bits - 1);
+    return v >= -limit && v < limit;
+}
+
+int64_t signExtend(uint64_t v, int bits)
+{
+    uint64_t sign = (uint64_t)1 << (bits - 1);
+    return (int64_t)((v ^ sign) - sign);
+}
+
+void writeDod(BitWriter& w, int64_t dod)
+{
+    if (dod == 0) {
+        w.write(0, 1);
+        return;
+    }
+    for (const DodBucket& b : DOD_BUCKETS) {
+        if (fitsSigned(dod, b.payloadBits)) {
+            w.write(b.control, b.controlBits);
+            w.write((uint64_t)dod & (((uint64_t)1 << b.payloadBits) - 1), b.payloadBits);
+            return;
+        }
+    }
+    // irregular timestamps: explicit width instead of a full 64-bit word
+    int bits = 13;
+    while (bits < 64 && !fitsSigned(dod, bits))
+        bits++;
+    w.write(0xf, 4);
+    w.write(bits - 1, 6);
+    w.write(bits == 64 ? (uint64_t)dod : (uint64_t)dod & (((uint64_t)1 << bits) - 1), bits);
+}
+
+int64_t readDod(BitReader& r)
+{
+    if (r.read(1) == 0)
+        return 0;
+    // every further 1 bit moves on to the next wider bucket
+    for (const DodBucket& b : DOD_BUCKETS)
+        if (r.read(1) == 0)
+            return signExtend(r.read(b.payloadBits), b.payloadBits);
+    int bits = (int)r.read(6) + 1;
+    return bits == 64 ? (int64_t)r.read(64) : signExtend(r.read(bits), bits);
+}
+
+/** Delta-of-delta coder state of one integer column. */
+struct DodColumn {
+    int64_t prev = 0;
+    int64_t prevDelta = 0;
+};
+
+/** XOR coder state of the value column. */
+struct XorColumn {
+    uint64_t prev = 0;
+    int leading = -1;     // window of the previous meaningful bits
+    int trailing = 0;
+};
+
+uint64_t doubleBits(double d)
+{
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return bits;
+}
+
+double bitsDouble(uint64_t bits)
+{
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+int leadingZeros(uint64_t v)
+{
+    int n = 0;
+    for (uint64_t mask = (uint64_t)1 << 63; mask && !(v & mask); mask >>= 1)
+        n++;
+    return n;
+}
+
+int trailingZeros(uint64_t v)
+{
+    int n = 0;
+    for (; n < 64 && !(v & 1); v >>= 1)
+        n++;
+    return n;
+}
+
+void writeXor(BitWriter& w, XorColumn& col, uint64_t bits)
+{
+    uint64_t x = bits ^ col.prev;
+    col.prev = bits;
+    if (x == 0) {
+        w.write(0, 1);
+        return;
+    }
+    w.write(1, 1);
+
+    int leading = std::min(leadingZeros(x), 31);  // 5-bit field
+    int trailing = trailingZeros(x);
+    if (col.leading >= 0 && leading >= col.leading && trailing >= col.trailing) {
+        // fits into the previous window
+        w.write(0, 1);
+        w.write(x >> col.trailing, 64 - col.leading - col.trailing);
+    }
+    else {
+        int meaningful = 64 - leading - trailing;
+        w.write(1, 1);
+        w.write(leading, 5);
+        w.write(meaningful - 1, 6);
+        w.write(x >> trailing, meaningful);
+        col.leading = leading;
+        col.trailing = trailing;
+    }
+}
+
+uint64_t readXor(BitReader& r, XorColumn& col)
+{
+    if (r.read(1) == 0)
+        return col.prev;
+    if (r.read(1) == 1) {
+        col.leading = (int)r.read(5);
+        int meaningful = (int)r.read(6) + 1;
+        col.trailing = 64 - col.leading - meaningful;
+    }
+    uint64_t x = r.read(64 - col.leading - col.trailing) << col.trailing;
+    col.prev ^= x;
+    return col.prev;
+}
+
+}  // namespace
+
+void putVarint(std::string& out, uint64_t v)
+{
+    while (v >= 0x80) {
+        out += (char)(v | 0x80);
+        v >>= 7;
+    }
+    out += (char)v;
+}
+
+void putSignedVarint(std::string& out, int64_t v)
+{
+    putVarint(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));  // zigzag
+}
+
+void putString(std::string& out, const std::string& s)
+{
+    putVarint(out, s.size());
+    out += s;
+}
+
+void putDouble(std::string& out, double d)
+{
+    uint64_t bits = doubleBits(d);
+    for (int i = 0; i < 8; i++)
+        out += (char)(bits >> (8 * i));
+}
+
+void putBlockInfo(std::string& out, const VectorBlockInfo& info)
+{
+    putVarint(out, info.vectorId);
+    putVarint(out, info.offset);
+    putVarint(out, info.count);
+    putSignedVarint(out, info.startEventNumber);
+    putSignedVarint(out, info.endEventNumber);
+    putSignedVarint(out, info.startRawTime);
+    putSignedVarint(out, info.endRawTime);
+    putDouble(out, info.min);
+    putDouble(out, info.max);
+}
+
+void ByteReader::skip(size_t n)
+{
+    if (n > remaining())
+        throw std::runtime_error("truncated record");
+    p += n;
+}
+
+uint8_t ByteReader::byte()
+{
+    if (p >= end)
+        throw std::runtime_error("truncated record");
+    return *p++;
+}
+
+uint64_t ByteReader::varint()
+{
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t b = byte();
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return v;
+    }
+    throw std::runtime_error("malformed varint");
+}
+
+int64_t ByteReader::signedVarint()
+{
+    uint64_t v = varint();
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+std::string ByteReader::string()
+{
+    uint64_t n = varint();
+    const char *start = position();
+    skip(n);
+    return std::string(start, n);
+}
+
+double ByteReader::dbl()
+{
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; i++)
+        bits |= (uint64_t)byte() << (8 * i);
+    return bitsDouble(bits);
+}
+
+VectorBlockInfo ByteReader::blockInfo()
+{
+    VectorBlockInfo info;
+    info.vectorId = varint();
+    info.offset = varint();
+    info.count = varint();
+    info.startEventNumber = signedVarint();
+    info.endEventNumber = signedVarint();
+    info.startRawTime = signedVarint();
+    info.endRawTime = signedVarint();
+    info.min = dbl();
+    info.max = dbl();
+    return info;
+}
+
+VectorBlockInfo summarizeSamples(uint64_t vectorId, const std::vector<VectorSample>& samples)
+{
+    VectorBlockInfo info;
+    info.vectorId = vectorId;
+    info.count = samples.size();
+    if (samples.empty())
+        return info;
+    info.startEventNumber = samples.front().eventNumber;
+    info.endEventNumber = samples.back().eventNumber;
+    info.startRawTime = samples.front().rawTime;
+    info.endRawTime = samples.back().rawTime;
+    info.min = info.max = samples.front().value;
+    for (const VectorSample& s : samples) {
+        info.min = std::min(info.min, s.value);
+        info.max = std::max(info.max, s.value);
+    }
+    return info;
+}
+
+void encodeSamples(const std::vector<VectorSample>& samples, std::string& out)
+{
+    BitWriter w(out);
+    DodColumn events, times;
+    XorColumn values;
+    bool first = true;
+    for (const VectorSample& s : samples) {
+        if (first) {
+            w.write((uint64_t)s.eventNumber, 64);
+            w.write((uint64_t)s.rawTime, 64);
+            w.write(doubleBits(s.value), 64);
+            values.prev = doubleBits(s.value);
+            first = false;
+        }
+        else {
+            int64_t eventDelta = s.eventNumber - events.prev;
+            int64_t timeDelta = s.rawTime - times.prev;
+            writeDod(w, eventDelta - events.prevDelta);
+            writeDod(w, timeDelta - times.prevDelta);
+            writeXor(w, values, doubleBits(s.value));
+            events.prevDelta = eventDelta;
+            times.prevDelta = timeDelta;
+        }
+        events.prev = s.eventNumber;
+        times.prev = s.rawTime;
+    }
+    w.flush();
+}
+
+void decodeSamples(const char *data, size_t size, size_t count, std::vector<VectorSample>& samples)
+{
+    BitReader r(data, size);
+    DodColumn events, times;
+    XorColumn values;
+    for (size_t i = 0; i < count; i++) {
+        VectorSample s;
+        if (i == 0) {
+            s.eventNumber = (int64_t)r.read(64);
+            s.rawTime = (int64_t)r.read(64);
+            values.prev = r.read(64);
+            s.value = bitsDouble(values.prev);
+        }
+        else {
+            events.prevDelta += readDod(r);
+            times.prevDelta += readDod(r);
+            s.eventNumber = events.prev + events.prevDelta;
+            s.rawTime = times.prev + times.prevDelta;
+            s.value = bitsDouble(readXor(r, values));
+        }
+        events.prev = s.eventNumber;
+        times.prev = s.rawTime;
+        samples.push_back(s);
+    }
+}
@@ -0,0 +1,101 @@
+//
+// Compressed output vector format (.vecz), kept free of the simulation kernel
+// so that the converter in tools/ can share it.
+//
+// A .vecz file is a "VECZ" magic, a version byte and the simtime scale
+// exponent, followed by records of the form <tag> <varint length> <payload>:
+//
+//   'A'  run attribute        key, value
+//   'I'  iteration variable   name, value
+//   'V'  vector declaration   id, module, name, attribute count, key/value pairs
+//   'B'  sample block         VectorBlockInfo, Gorilla-compressed samples
+//   'X'  block index          count, VectorBlockInfo of every block
+//
+// and a trailer of the index offset (8 bytes, little endian) and "VECZ".
+// Within a block, event numbers and raw simulation times are stored as
+// delta-of-deltas, values as the XOR of consecutive IEEE doubles (Gorilla,
+// VLDB 2015), so decoding reproduces every sample bit for bit.
+//
+
+#ifndef __VECTORCODEC_H
+#define __VECTORCODEC_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define VECZ_MAGIC      "VECZ"
+#define VECZ_VERSION    1
+
+enum VeczRecordTag {
+    VECZ_RUN_ATTR = 'A',
+    VECZ_ITERVAR = 'I',
+    VECZ_VECTOR = 'V',
+    VECZ_BLOCK = 'B',
+    VECZ_INDEX = 'X',
+};
+
+struct VectorSample {
+    int64_t eventNumber;
+    int64_t rawTime;    // simtime_t::raw()
+    double value;
+};
+
+/**
+ * Summary of one block: stored in the block header and again in the index,
+ * where offset is the file position of the block record.
+ */
+struct VectorBlockInfo {
+    uint64_t vectorId = 0;
+    uint64_t offset = 0;
+    uint64_t count = 0;
+    int64_t startEventNumber = 0;
+    int64_t endEventNumber = 0;
+    int64_t startRawTime = 0;
+    int64_t endRawTime = 0;
+    double min = 0;
+    double max = 0;
+};
+
+void putVarint(std::string& out, uint64_t v);
+void putSignedVarint(std::string& out, int64_t v);
+void putString(std::string& out, const std::string& s);
+void putDouble(std::string& out, double d);
+void putBlockInfo(std::string& out, const VectorBlockInfo& info);
+
+/**
+ * Bounds-checked reader of the encodings above; throws std::runtime_error
+ * on truncated input.
+ */
+class ByteReader
+{
+  private:
+    const unsigned char *p;
+    const unsigned char *end;
+
+  public:
+    ByteReader(const char *data, size_t size)
+        : p((const unsigned char *)data), end((const unsigned char *)data + size) {}
+
+    bool atEnd() const { return p >= end; }
+    size_t remaining() const { return end - p; }
+    const char *position() const { return (const char *)p; }
+    void skip(size_t n);
+    uint8_t byte();
+    uint64_t varint();
+    int64_t signedVarint();
+    std::string string();
+    double dbl();
+    VectorBlockInfo blockInfo();
+};
+
+/** Fills in the count, time/event range and min/max of a block. */
+VectorBlockInfo summarizeSamples(uint64_t vectorId, const std::vector<VectorSample>& samples);
+
+/** Appends the compressed samples to out (byte aligned at the end). */
+void encodeSamples(const std::vector<VectorSample>& samples, std::string& out);
+
+/** Decodes count samples from data and appends them to samples. */
+void decodeSamples(const char *data, size_t size, size_t count, std::vector<VectorSample>& samples);
+
+#endif
@@ -0,0 +1,210 @@
+//
+// Helpers shared by the tools (see SimFiles.h)
+//
+
+#include <sched.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include "SimFiles.h"
+
+std::string trim(const std::string& s)
+{
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos)
+        return "";
+    size_t e = s.find_last_not_of(" \t\r\n");
+    return s.substr(b, e - b + 1);
+}
+
+std::string stripComment(const std::string& line)
+{
+    bool inQuotes = false;
+    for (size_t i = 0; i < line.size(); i++) {
+        if (line[i] == '"' && (i == 0 || line[i-1] != '\\'))
+            inQuotes = !inQuotes;
+        else if (line[i] == '#' && !inQuotes)
+            return line.substr(0, i);
+    }
+    return line;
+}
+
+std::string dirName(const std::string& path)
+{
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? "." : path.substr(0, slash);
+}
+
+void readIniFile(const std::string& fileName, IniFile& ini, std::string& section)
+{
+    std::ifstream in(fileName);
+    if (!in)
+        throw std::runtime_error("cannot open ini file '" + fileName + "'");
+
+    std::string line, pending;
+    while (std::getline(in, line)) {
+        // continuation lines end with a backslash
+        if (!line.empty() && line.back() == '\\') {
+            pending += line.substr(0, line.size() - 1);
+            continue;
+        }
+        line = trim(stripComment(pending + line));
+        pending.clear();
+        if (line.empty())
+            continue;
+
+        if (line.compare(0, 8, "include ") == 0) {
+            std::string included = trim(line.substr(8));
+            if (included[0] != '/')
+                included = dirName(fileName) + "/" + included;
+            readIniFile(included, ini, section);
+        }
+        else if (line.front() == '[' && line.back() == ']') {
+            section = trim(line.substr(1, line.size() - 2));
+            if (section.compare(0, 7, "Config ") == 0)
+                section = trim(section.substr(7));
+            ini[section];
+        }
+        else {
+            size_t eq = line.find('=');
+            if (eq == std::string::npos)
+                continue;
+            ini[section].entries.push_back({trim(line.substr(0, eq)), trim(line.substr(eq + 1))});
+        }
+    }
+}
+
+std::vector<std::string> sectionChain(const IniFile& ini, const std::string& config)
+{
+    std::vector<std::string> chain, todo = {config};
+    std::set<std::string> seen;
+    while (!todo.empty()) {
+        std::string name = todo.front();
+        todo.erase(todo.begin());
+        if (!seen.insert(name).second)
+            continue;
+
+        auto it = ini.find(name);
+        if (it == ini.end())
+            throw std::runtime_error("no such config: '" + name + "'");
+        chain.push_back(name);
+
+        for (auto& kv : it->second.entries) {
+            if (kv.first != "extends")
+                continue;
+            std::stringstream bases(kv.second);
+            std::string base;
+            while (std::getline(bases, base, ','))
+                todo.push_back(trim(base));
+        }
+    }
+    if (config != "General" && ini.count("General") && !seen.count("General"))
+        chain.push_back("General");
+    return chain;
+}
+
+void makeDirs(const std::string& path)
+{
+    std::string partial;
+    std::stringstream parts(path);
+    std::string part;
+    if (!path.empty() && path[0] == '/')
+        partial = "/";
+    while (std::getline(parts, part, '/')) {
+        if (part.empty())
+            continue;
+        partial += part + "/";
+        if (mkdir(partial.c_str(), 0755) != 0 && errno != EEXIST)
+            throw std::runtime_error("cannot create directory '" + partial + "': " + strerror(errno));
+    }
+}
+
+std::vector<std::string> tokenize(const std::string& line)
+{
+    std::vector<std::string> tokens;
+    std::string cur;
+    bool inQuotes = false, hasToken = false;
+    for (size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+        if (inQuotes) {
+            if (c == '\\' && i + 1 < line.size())
+                cur += line[++i];
+            else if (c == '"')
+                inQuotes = false;
+            else
+                cur += c;
+        }
+        else if (c == '"') {
+            inQuotes = hasToken = true;
+        }
+        else if (c == ' ' || c == '\t') {
+            if (hasToken)
+                tokens.push_back(cur);
+            cur.clear();
+            hasToken = false;
+        }
+        else {
+            cur += c;
+            hasToken = true;
+        }
+    }
+    if (hasToken)
+        tokens.push_back(cur);
+    return tokens;
+}
+
+std::string csvField(const std::string& s)
+{
+    if (s.find_first_of(",\"\n") == std::string::npos)
+        return s;
+    std::string quoted = "\"";
+    for (char c : s) {
+        if (c == '"')
+            quoted += '"';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+pid_t spawnProcess(const std::vector<std::string>& args, const std::string& logFile, int core)
+{
+    pid_t pid = fork();
+    if (pid < 0)
+        throw std::runtime_error(std::string("fork failed: ") + strerror(errno));
+    if (pid > 0)
+        return pid;
+
+    // child: pin, redirect output, exec
+    if (core >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0)
+            perror("sched_setaffinity");
+    }
+
+    int fd = open(logFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        close(fd);
+    }
+
+    std::vector<char *> argv;
+    for (auto& arg : args)
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    execv(argv[0], argv.data());
+    perror(("exec " + args[0]).c_str());
+    _exit(127);
+}
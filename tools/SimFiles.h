@@ -0,0 +1,48 @@
+//
+// Helpers shared by the tools: reading OMNeT++ ini and result files and
+// starting simulation processes.
+//
+
+#ifndef __SIMFILES_H
+#define __SIMFILES_H
+
+#include <sys/types.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * The parts of an ini file the tools need: per section, the key/value
+ * pairs in file order. "[Config X]" is stored as "X".
+ */
+struct IniSection {
+    std::vector<std::pair<std::string, std::string>> entries;
+};
+
+typedef std::map<std::string, IniSection> IniFile;
+
+std::string trim(const std::string& s);
+std::string stripComment(const std::string& line);
+std::string dirName(const std::string& path);
+void makeDirs(const std::string& path);
+
+/** Reads an ini file (following includes) into ini; section is the current section. */
+void readIniFile(const std::string& fileName, IniFile& ini, std::string& section);
+
+/** Returns the section chain of a config: the config itself, its bases, General. */
+std::vector<std::string> sectionChain(const IniFile& ini, const std::string& config);
+
+/** Splits a result file line into tokens, honouring double quotes. */
+std::vector<std::string> tokenize(const std::string& line);
+
+/** Quotes a CSV field if needed. */
+std::string csvField(const std::string& s);
+
+/**
+ * Forks and execs args with stdout and stderr redirected to logFile,
+ * optionally pinned to a core (core < 0: no pinning). Returns the child pid.
+ */
+pid_t spawnProcess(const std::vector<std::string>& args, const std::string& logFile, int core);
+
+#endif
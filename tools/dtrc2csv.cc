@@ -0,0 +1,200 @@
+//
+// Decodes the routing decision trace of SDNController_ML (.dtrc, see
+// src/DecisionTrace.h) into CSV, or summarizes it per policy.
+//
+// Examples:
+//   dtrc2csv results/NetSDN_ML-#0-NetSDN_ML.sdn.controller.dtrc     -> .csv
+//   dtrc2csv -s results/...dtrc                  per-policy summary
+//   dtrc2csv -a 7 -f 120 -t 130 -o - results/...dtrc
+//                                                decisions involving node 7
+//                                                between t=120s and t=130s
+//
+
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "DecisionTrace.h"
+
+namespace {
+
+const char *policyNames[] = { "traditional", "energyAware", "ml", "mlEnergyAware", "bandit", "replay" };
+const int NUM_POLICIES = 6;
+
+struct Options {
+    std::string inputFile;
+    std::string outputFile;
+    int address = -1;
+    double from = -std::numeric_limits<double>::infinity();
+    double to = std::numeric_limits<double>::infinity();
+    bool summary = false;
+};
+
+const char *policyName(int policy)
+{
+    return policy >= 0 && policy < NUM_POLICIES ? policyNames[policy] : "unknown";
+}
+
+std::string flagNames(int flags)
+{
+    std::string s;
+    if (flags & DECISION_FALLBACK)
+        s += "fallback ";
+    if (flags & DECISION_BACKBONE)
+        s += "backbone ";
+    if (flags & DECISION_DROPPED)
+        s += "dropped ";
+    if (flags & DECISION_REPLAYED)
+        s += "replayed ";
+    if (!s.empty())
+        s.pop_back();
+    return s;
+}
+
+bool selected(const Options& opt, const DecisionRecord& r)
+{
+    if (opt.address >= 0 && r.srcAddr != opt.address && r.destAddr != opt.address)
+        return false;
+    return r.time >= opt.from && r.time <= opt.to;
+}
+
+void writeCsv(std::ostream& out, const Options& opt, const std::vector<DecisionRecord>& records)
+{
+    out << "time,sequence,src_addr,dest_addr,policy,ml_prediction,chosen_gate,score_margin,flags\n";
+    char line[256];
+    for (const DecisionRecord& r : records) {
+        if (!selected(opt, r))
+            continue;
+        // score_margin stays empty if the decision was not scored
+        char margin[32] = "";
+        if (!std::isnan(r.scoreMargin))
+            snprintf(margin, sizeof(margin), "%.4f", r.scoreMargin);
+        snprintf(line, sizeof(line), "%.9f,%llu,%d,%d,%s,%d,%d,%s,%s\n",
+                 r.time, (unsigned long long)r.sequence, r.srcAddr, r.destAddr, policyName(r.policy),
+                 r.mlPrediction, r.chosenGate, margin, flagNames(r.flags).c_str());
+        out << line;
+    }
+}
+
+void writeSummary(std::ostream& out, const Options& opt, const DecisionTraceHeader& header,
+                  const std::vector<DecisionRecord>& records)
+{
+    struct PolicyStats {
+        uint64_t decisions = 0, fallbacks = 0, backbone = 0, dropped = 0, overridden = 0;
+        uint64_t scored = 0, closeCalls = 0;
+        double marginSum = 0;
+    } stats[NUM_POLICIES + 1];
+
+    double first = NAN, last = NAN;
+    for (const DecisionRecord& r : records) {
+        if (!selected(opt, r))
+            continue;
+        if (std::isnan(first))
+            first = r.time;
+        last = r.time;
+        PolicyStats& s = stats[r.policy < NUM_POLICIES ? r.policy : NUM_POLICIES];
+        s.decisions++;
+        s.fallbacks += (r.flags & DECISION_FALLBACK) != 0;
+        s.backbone += (r.flags & DECISION_BACKBONE) != 0;
+        s.dropped += (r.flags & DECISION_DROPPED) != 0;
+        // energy-aware scoring chose another gate than the ML model
+        s.overridden += r.mlPrediction >= 0 && r.chosenGate != r.mlPrediction;
+        if (!std::isnan(r.scoreMargin)) {
+            s.scored++;
+            s.marginSum += r.scoreMargin;
+            s.closeCalls += r.scoreMargin < 1.0;
+        }
+    }
+
+    out << "decisions in trace: " << records.size() << " of " << header.totalRecorded
+        << " (ring capacity " << header.capacity << ")\n";
+    if (!std::isnan(first))
+        out << "time range: " << first << "s .. " << last << "s\n";
+    out << "\npolicy,decisions,fallbacks,backbone,dropped,ml_overridden,mean_margin,close_calls\n";
+    for (int i = 0; i <= NUM_POLICIES; i++) {
+        const PolicyStats& s = stats[i];
+        if (s.decisions == 0)
+            continue;
+        out << (i < NUM_POLICIES ? policyNames[i] : "unknown") << ',' << s.decisions << ','
+            << s.fallbacks << ',' << s.backbone << ',' << s.dropped << ',' << s.overridden << ',';
+        if (s.scored > 0)
+            out << s.marginSum / s.scored;
+        out << ',' << s.closeCalls << '\n';
+    }
+}
+
+void usage()
+{
+    std::cerr <<
+        "Usage: dtrc2csv [options] <file.dtrc>\n"
+        "  -o <file>   output file, '-' for stdout (default: input with .csv extension)\n"
+        "  -a <addr>   only decisions with this source or destination address\n"
+        "  -f <t>      only decisions at or after simulation time t [s]\n"
+        "  -t <t>      only decisions at or before simulation time t [s]\n"
+        "  -s          per-policy summary on stdout instead of the CSV\n";
+}
+
+Options parseArgs(int argc, char **argv)
+{
+    Options opt;
+    int c;
+    while ((c = getopt(argc, argv, "o:a:f:t:sh")) != -1) {
+        switch (c) {
+            case 'o': opt.outputFile = optarg; break;
+            case 'a': opt.address = atoi(optarg); break;
+            case 'f': opt.from = atof(optarg); break;
+            case 't': opt.to = atof(optarg); break;
+            case 's': opt.summary = true; break;
+            default: usage(); exit(c == 'h' ? 0 : 1);
+        }
+    }
+    if (optind != argc - 1) {
+        usage();
+        exit(1);
+    }
+    opt.inputFile = argv[optind];
+    if (opt.outputFile.empty() && !opt.summary) {
+        opt.outputFile = opt.inputFile;
+        if (opt.outputFile.size() > 5 && opt.outputFile.compare(opt.outputFile.size() - 5, 5, ".dtrc") == 0)
+            opt.outputFile.resize(opt.outputFile.size() - 5);
+        opt.outputFile += ".csv";
+    }
+    return opt;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    try {
+        Options opt = parseArgs(argc, argv);
+        DecisionTraceHeader header;
+        std::vector<DecisionRecord> records = DecisionTrace::load(opt.inputFile, header);
+
+        if (opt.summary) {
+            writeSummary(std::cout, opt, header, records);
+        }
+        else if (opt.outputFile == "-") {
+            writeCsv(std::cout, opt, records);
+        }
+        else {
+            std::ofstream out(opt.outputFile);
+            if (!out)
+                throw std::runtime_error("cannot write '" + opt.outputFile + "'");
+            writeCsv(out, opt, records);
+        }
+        return 0;
+    }
+    catch (std::exception& e) {
+        std::cerr << "dtrc2csv: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,483 @@
+//
+// Fingerprint regression check for the SDN simulations.
+//
+// Runs every config of an ini file with a fixed seed set and a short time
+// limit, and compares the event fingerprint and a set of key scalars
+// (routing decisions, end-to-end delay, drops) against a checked-in
+// baseline. Differences are listed per config; the exit code is nonzero if
+// any config fails. With -u the results are written as the new baseline.
+//
+// Each config can have a tolerance (a "tolerance" line in the baseline, or
+// -t for all of them):
+//   exact      fingerprint and scalars must match exactly (default)
+//   scalars    fingerprint differences are only reported, scalars must match
+//   rel:<eps>  fingerprint differences are only reported, scalars may differ
+//              by a relative error of eps (for intentionally approximate modes)
+//
+// Example (from simulations/):
+//   ../tools/fingerprint_check omnetppNewML.ini
+//
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SimFiles.h"
+
+namespace {
+
+// asks OMNeT++ to compute the fingerprint; the mismatch message reports it
+const char *PLACEHOLDER_FINGERPRINT = "0000-0000/tplx";
+
+struct Options {
+    std::string executable = "../src/ModelingProject4SDNML";
+    std::string nedPath = ".:../src";
+    std::vector<std::string> iniFiles;
+    std::vector<std::string> configs;
+    std::vector<std::string> keyPrefixes;
+    std::vector<std::string> extraArgs;
+    std::string baselineFile;
+    std::string outputDir = "results/fingerprint";
+    std::string simTimeLimit = "60s";
+    std::string tolerance;
+    int workers = 0;
+    bool update = false;
+};
+
+struct Tolerance {
+    enum Mode { EXACT, SCALARS, RELATIVE } mode = EXACT;
+    double epsilon = 0;
+};
+
+/** Fingerprint and key scalars of one config, as recorded or as measured. */
+struct Result {
+    std::string fingerprint;
+    std::string tolerance;
+    std::map<std::string, std::string> scalars;  // "module/name" -> value
+    std::string error;
+};
+
+typedef std::map<std::string, Result> ResultSet;
+
+// scalars compared by default: routing decisions, delay and drops
+const std::vector<std::string> DEFAULT_KEY_PREFIXES = {
+    "routingDecision:", "endToEndDelay:mean", "drop:count", "drop:sum",
+};
+
+Tolerance parseTolerance(const std::string& spec)
+{
+    Tolerance t;
+    if (spec.empty() || spec == "exact")
+        t.mode = Tolerance::EXACT;
+    else if (spec == "scalars")
+        t.mode = Tolerance::SCALARS;
+    else if (spec.compare(0, 4, "rel:") == 0) {
+        t.mode = Tolerance::RELATIVE;
+        t.epsilon = atof(spec.c_str() + 4);
+    }
+    else
+        throw std::runtime_error("unknown tolerance '" + spec + "' (exact, scalars or rel:<eps>)");
+    return t;
+}
+
+bool isKeyScalar(const Options& opt, const std::string& name)
+{
+    for (auto& prefix : opt.keyPrefixes)
+        if (name.compare(0, prefix.size(), prefix) == 0)
+            return true;
+    return false;
+}
+
+/** Reads the key scalars of a .sca file, including the fields and bins of histograms. */
+void readKeyScalars(const Options& opt, const std::string& fileName, Result& result)
+{
+    std::ifstream in(fileName);
+    std::string line, statistic;
+    while (std::getline(in, line)) {
+        std::vector<std::string> t = tokenize(line);
+        if (t.empty())
+            continue;
+        if (t[0] == "scalar" && t.size() >= 4) {
+            statistic.clear();
+            if (isKeyScalar(opt, t[2]))
+                result.scalars[t[1] + "/" + t[2]] = t[3];
+        }
+        else if (t[0] == "statistic" && t.size() >= 3)
+            statistic = isKeyScalar(opt, t[2]) ? t[1] + "/" + t[2] : "";
+        else if (t[0] == "field" && t.size() >= 3 && !statistic.empty())
+            result.scalars[statistic + ":" + t[1]] = t[2];
+        else if (t[0] == "bin" && t.size() >= 3 && !statistic.empty())
+            result.scalars[statistic + ":bin(" + t[1] + ")"] = t[2];
+        else if (t[0] != "attr" && t[0] != "field" && t[0] != "bin")
+            statistic.clear();
+    }
+}
+
+/** Extracts the calculated fingerprint from the Cmdenv output. */
+std::string readFingerprint(const std::string& logFile)
+{
+    std::ifstream in(logFile);
+    std::string line;
+    const char *markers[] = {"calculated: ", "successfully verified: "};
+    while (std::getline(in, line)) {
+        for (const char *marker : markers) {
+            size_t pos = line.find(marker);
+            if (pos == std::string::npos)
+                continue;
+            pos += strlen(marker);
+            size_t end = line.find_first_of(", \t\r", pos);
+            return line.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+        }
+    }
+    return "";
+}
+
+std::string runDir(const Options& opt, const std::string& config)
+{
+    return opt.outputDir + "/" + config;
+}
+
+std::vector<std::string> buildCommand(const Options& opt, const std::string& config)
+{
+    std::string dir = runDir(opt, config);
+    std::vector<std::string> args = {
+        opt.executable, "-u", "Cmdenv", "-n", opt.nedPath,
+        "-c", config, "-r", "0",
+        "--result-dir=" + dir,
+        "--cmdenv-express-mode=true",
+        "--seed-set=0",
+        "--sim-time-limit=" + opt.simTimeLimit,
+        "--fingerprint=" + std::string(PLACEHOLDER_FINGERPRINT),
+        "--**.vector-recording=false",
+        "--**.controller.datasetFile=\"" + dir + "/sdn_dataset.csv\"",
+    };
+    for (auto& arg : opt.extraArgs)
+        args.push_back(arg);
+    for (auto& ini : opt.iniFiles)
+        args.push_back(ini);
+    return args;
+}
+
+Result collectResult(const Options& opt, const std::string& config)
+{
+    Result result;
+    std::string dir = runDir(opt, config);
+    result.fingerprint = readFingerprint(dir + "/stdout.log");
+    if (result.fingerprint.empty()) {
+        result.error = "no fingerprint in " + dir + "/stdout.log (simulation failed?)";
+        return result;
+    }
+    if (DIR *d = opendir(dir.c_str())) {
+        while (dirent *e = readdir(d)) {
+            std::string name = e->d_name;
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".sca") == 0)
+                readKeyScalars(opt, dir + "/" + name, result);
+        }
+        closedir(d);
+    }
+    if (result.scalars.empty())
+        result.error = "no key scalars recorded in " + dir;
+    return result;
+}
+
+/** Runs the configs on a pool of workers; the exit status is ignored (see PLACEHOLDER_FINGERPRINT). */
+ResultSet runConfigs(const Options& opt)
+{
+    std::map<pid_t, std::string> active;
+    size_t next = 0;
+    while (next < opt.configs.size() || !active.empty()) {
+        while (next < opt.configs.size() && (int)active.size() < opt.workers) {
+            const std::string& config = opt.configs[next++];
+            std::string dir = runDir(opt, config);
+            makeDirs(dir);
+            active[spawnProcess(buildCommand(opt, config), dir + "/stdout.log", -1)] = config;
+        }
+
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(std::string("waitpid failed: ") + strerror(errno));
+        }
+        auto it = active.find(pid);
+        if (it != active.end()) {
+            std::cout << "ran " << it->second << "\n";
+            active.erase(it);
+        }
+    }
+
+    ResultSet results;
+    for (auto& config : opt.configs)
+        results[config] = collectResult(opt, config);
+    return results;
+}
+
+/** Baseline format: one "config,key,value" line per item; key is "fingerprint", "tolerance" or "module/name". */
+ResultSet readBaseline(const std::string& fileName)
+{
+    ResultSet baseline;
+    std::ifstream in(fileName);
+    std::string line;
+    while (std::getline(in, line)) {
+        line = trim(line);
+        if (line.empty() || line[0] == '#')
+            continue;
+        size_t first = line.find(','), last = line.rfind(',');
+        if (first == std::string::npos || first == last)
+            throw std::runtime_error("malformed baseline line: '" + line + "'");
+        std::string config = line.substr(0, first);
+        std::string key = line.substr(first + 1, last - first - 1);
+        std::string value = line.substr(last + 1);
+
+        Result& result = baseline[config];
+        if (key == "fingerprint")
+            result.fingerprint = value;
+        else if (key == "tolerance")
+            result.tolerance = value;
+        else
+            result.scalars[key] = value;
+    }
+    return baseline;
+}
+
+void writeBaseline(const std::string& fileName, const ResultSet& baseline)
+{
+    std::ofstream out(fileName);
+    if (!out)
+        throw std::runtime_error("cannot write baseline '" + fileName + "'");
+    out << "# Fingerprint regression baseline, written by tools/fingerprint_check -u\n"
+        << "# config,key,value (key: fingerprint, tolerance or module/scalar)\n";
+    for (auto& entry : baseline) {
+        const Result& r = entry.second;
+        out << entry.first << ",fingerprint," << r.fingerprint << "\n";
+        if (!r.tolerance.empty())
+            out << entry.first << ",tolerance," << r.tolerance << "\n";
+        for (auto& kv : r.scalars)
+            out << entry.first << "," << kv.first << "," << kv.second << "\n";
+    }
+}
+
+bool valuesMatch(const std::string& expected, const std::string& actual, const Tolerance& tolerance)
+{
+    if (expected == actual)
+        return true;
+    double a = strtod(expected.c_str(), nullptr), b = strtod(actual.c_str(), nullptr);
+    if (std::isnan(a) || std::isnan(b))
+        return std::isnan(a) && std::isnan(b);
+    if (a == b)
+        return true;
+    if (tolerance.mode != Tolerance::RELATIVE)
+        return false;
+    return std::fabs(a - b) <= tolerance.epsilon * std::max(std::fabs(a), std::fabs(b));
+}
+
+std::string relativeDiff(const std::string& expected, const std::string& actual)
+{
+    double a = strtod(expected.c_str(), nullptr), b = strtod(actual.c_str(), nullptr);
+    if (a == 0 || !std::isfinite(a) || !std::isfinite(b))
+        return "";
+    std::ostringstream os;
+    os.precision(3);
+    os << " (" << (b > a ? "+" : "") << 100.0 * (b - a) / std::fabs(a) << "%)";
+    return os.str();
+}
+
+/** Prints the differences of one config and returns whether it passes. */
+bool compareConfig(const std::string& config, const Result& expected, const Result& actual, const Tolerance& tolerance)
+{
+    std::vector<std::string> diffs, notes;
+    if (!actual.error.empty())
+        diffs.push_back(actual.error);
+    else {
+        if (expected.fingerprint != actual.fingerprint) {
+            std::string msg = "fingerprint: expected " + expected.fingerprint + ", got " + actual.fingerprint;
+            (tolerance.mode == Tolerance::EXACT ? diffs : notes).push_back(msg);
+        }
+        for (auto& kv : expected.scalars) {
+            auto it = actual.scalars.find(kv.first);
+            if (it == actual.scalars.end())
+                diffs.push_back(kv.first + ": expected " + kv.second + ", missing");
+            else if (!valuesMatch(kv.second, it->second, tolerance))
+                diffs.push_back(kv.first + ": expected " + kv.second + ", got " + it->second + relativeDiff(kv.second, it->second));
+        }
+        for (auto& kv : actual.scalars)
+            if (!expected.scalars.count(kv.first))
+                diffs.push_back(kv.first + ": not in baseline, got " + kv.second);
+    }
+
+    bool pass = diffs.empty();
+    std::cout << (pass ? "[PASS] " : "[FAIL] ") << config << "  fingerprint " << actual.fingerprint
+              << ", " << actual.scalars.size() << " scalars"
+              << (expected.tolerance.empty() ? "" : ", tolerance " + expected.tolerance) << "\n";
+    for (auto& d : diffs)
+        std::cout << "    " << d << "\n";
+    for (auto& n : notes)
+        std::cout << "    note: " << n << "\n";
+    return pass;
+}
+
+void usage()
+{
+    std::cerr <<
+        "Usage: fingerprint_check [options] <inifile>...\n"
+        "  -b <file>     baseline (default ../test/fingerprints/<first inifile>.csv)\n"
+        "  -c <config>   check only this config (repeatable; default: all configs)\n"
+        "  -x <exe>      simulation executable (default ../src/ModelingProject4SDNML)\n"
+        "  -n <nedpath>  NED path (default .:../src)\n"
+        "  -l <limit>    sim-time-limit of every run (default 60s)\n"
+        "  -t <mode>     tolerance for all configs: exact, scalars or rel:<eps>\n"
+        "  -k <prefix>   compare scalars with this name prefix (repeatable)\n"
+        "  -j <N>        number of parallel runs (default: number of CPUs)\n"
+        "  -o <dir>      output root (default results/fingerprint)\n"
+        "  -a <arg>      extra argument for every run (repeatable)\n"
+        "  -u            update the baseline with the results of this run\n";
+}
+
+Options parseArgs(int argc, char **argv)
+{
+    Options opt;
+    int c;
+    while ((c = getopt(argc, argv, "b:c:x:n:l:t:k:j:o:a:uh")) != -1) {
+        switch (c) {
+            case 'b': opt.baselineFile = optarg; break;
+            case 'c': opt.configs.push_back(optarg); break;
+            case 'x': opt.executable = optarg; break;
+            case 'n': opt.nedPath = optarg; break;
+            case 'l': opt.simTimeLimit = optarg; break;
+            case 't': opt.tolerance = optarg; parseTolerance(optarg); break;
+            case 'k': opt.keyPrefixes.push_back(optarg); break;
+            case 'j': opt.workers = atoi(optarg); break;
+            case 'o': opt.outputDir = optarg; break;
+            case 'a': opt.extraArgs.push_back(optarg); break;
+            case 'u': opt.update = true; break;
+            default: usage(); exit(c == 'h' ? 0 : 1);
+        }
+    }
+    for (int i = optind; i < argc; i++)
+        opt.iniFiles.push_back(argv[i]);
+
+    if (opt.iniFiles.empty()) {
+        usage();
+        exit(1);
+    }
+    if (opt.keyPrefixes.empty())
+        opt.keyPrefixes = DEFAULT_KEY_PREFIXES;
+    if (opt.workers <= 0)
+        opt.workers = std::max(1u, std::thread::hardware_concurrency());
+    if (opt.baselineFile.empty()) {
+        std::string base = opt.iniFiles[0].substr(opt.iniFiles[0].rfind('/') + 1);
+        if (base.size() > 4 && base.compare(base.size() - 4, 4, ".ini") == 0)
+            base.resize(base.size() - 4);
+        opt.baselineFile = "../test/fingerprints/" + base + ".csv";
+    }
+    return opt;
+}
+
+/**
+ * Warm-start, replay and MLP configs depend on files of another run or of the
+ * offline trainer and are skipped by default.
+ */
+bool dependsOnOtherRun(const IniFile& ini, const std::string& config)
+{
+    for (auto& section : sectionChain(ini, config)) {
+        auto it = ini.find(section);
+        if (it == ini.end())
+            continue;
+        for (auto& kv : it->second.entries) {
+            const std::string& key = kv.first;
+            for (const char *param : {"restoreFile", "replayFile", "mlWeightsFile"}) {
+                size_t n = strlen(param);
+                if (key.size() >= n && key.compare(key.size() - n, n, param) == 0)
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    try {
+        Options opt = parseArgs(argc, argv);
+
+        if (opt.configs.empty()) {
+            IniFile ini;
+            for (auto& file : opt.iniFiles) {
+                std::string section = "General";
+                readIniFile(file, ini, section);
+            }
+            for (auto& entry : ini)
+                if (!dependsOnOtherRun(ini, entry.first))
+                    opt.configs.push_back(entry.first);
+        }
+
+        ResultSet baseline = readBaseline(opt.baselineFile);
+        if (baseline.empty() && !opt.update)
+            throw std::runtime_error("baseline '" + opt.baselineFile + "' has no entries, record it with -u "
+                                     "(make fingerprints-update) and commit it");
+
+        signal(SIGPIPE, SIG_IGN);
+        ResultSet results = runConfigs(opt);
+
+        if (opt.update) {
+            int failed = 0;
+            for (auto& entry : results) {
+                if (!entry.second.error.empty()) {
+                    std::cout << "[SKIP] " << entry.first << ": " << entry.second.error << "\n";
+                    failed++;
+                    continue;
+                }
+                Result& r = baseline[entry.first];
+                std::string tolerance = r.tolerance;  // hand-edited, keep it
+                r = entry.second;
+                r.tolerance = tolerance;
+            }
+            // a build that cannot run must not leave an empty baseline behind
+            if (failed == (int)results.size())
+                throw std::runtime_error("no config produced a fingerprint, baseline '" + opt.baselineFile
+                                         + "' left unchanged");
+            writeBaseline(opt.baselineFile, baseline);
+            std::cout << "Baseline " << opt.baselineFile << " updated ("
+                      << results.size() - failed << " configs)\n";
+            return failed ? 1 : 0;
+        }
+
+        int passed = 0, failed = 0;
+        for (auto& entry : results) {
+            auto it = baseline.find(entry.first);
+            if (it == baseline.end()) {
+                std::cout << "[FAIL] " << entry.first << "  no baseline (record one with -u)\n";
+                failed++;
+                continue;
+            }
+            Tolerance tolerance = parseTolerance(opt.tolerance.empty() ? it->second.tolerance : opt.tolerance);
+            if (compareConfig(entry.first, it->second, entry.second, tolerance))
+                passed++;
+            else
+                failed++;
+        }
+        std::cout << "Fingerprint check: " << passed << " passed, " << failed << " failed\n";
+        return failed ? 1 : 0;
+    }
+    catch (std::exception& e) {
+        std::cerr << "fingerprint_check: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,452 @@
+//
+// Native replacement of the "scavetool export + pandas" step.
+//
+// Reads .sca and .vec files (memory-mapped, one file per worker thread at a
+// time), keeps the scalars, statistic fields and vectors that match the
+// module/name patterns, and aggregates them over the repetitions of every
+// config and iteration variable combination. Writes one CSV row per group:
+//
+//   config,iterationvars,module,name,kind,runs,count,mean,stddev,ci95,min,max,p50,p90,p99
+//
+// For scalars (kind "scalar"), count is the number of values and all
+// columns describe the values across repetitions; p50..p99 are exact. For
+// vectors (kind "vector"), mean/stddev/ci95 describe the per-run vector
+// means, while count, min, max and p50..p99 refer to all samples pooled
+// (quantiles from a DDSketch with 1% relative accuracy).
+//
+// Example:
+//   result_aggregator -n 'endToEndDelay:*' -o summary.csv results/
+//
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "SimFiles.h"
+#include "QuantileSketch.h"
+
+namespace {
+
+struct Options {
+    std::vector<std::string> inputs;
+    std::vector<std::string> modulePatterns;
+    std::vector<std::string> namePatterns;
+    std::string outputFile;
+    int threads = 0;
+    bool poolModules = false;
+    bool scalarsOnly = false;
+    bool vectorsOnly = false;
+};
+
+/** Group key: config, iteration variables (without repetition), module, name, kind. */
+typedef std::tuple<std::string, std::string, std::string, std::string, char> GroupKey;
+
+struct Group {
+    std::vector<double> values;             // scalar values, or per-run vector means
+    uint64_t samples = 0;                   // vectors: pooled sample count
+    double sampleMin = INFINITY;
+    double sampleMax = -INFINITY;
+    std::unique_ptr<QuantileSketch> sketch; // vectors: pooled samples
+
+    void merge(Group& other) {
+        values.insert(values.end(), other.values.begin(), other.values.end());
+        samples += other.samples;
+        sampleMin = std::min(sampleMin, other.sampleMin);
+        sampleMax = std::max(sampleMax, other.sampleMax);
+        if (other.sketch) {
+            if (!sketch)
+                sketch = std::move(other.sketch);
+            else
+                sketch->merge(*other.sketch);
+        }
+    }
+};
+
+typedef std::map<GroupKey, Group> GroupMap;
+
+/** Read-only memory mapping of a whole file. */
+class MappedFile
+{
+  private:
+    const char *data = nullptr;
+    size_t size = 0;
+
+  public:
+    explicit MappedFile(const std::string& fileName) {
+        int fd = open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("cannot open '" + fileName + "': " + strerror(errno));
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            size = st.st_size;
+            void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("cannot map '" + fileName + "': " + strerror(errno));
+            }
+            madvise(p, size, MADV_SEQUENTIAL);
+            data = (const char *)p;
+        }
+        close(fd);
+    }
+    ~MappedFile() { if (data) munmap((void *)data, size); }
+
+    const char *begin() const { return data; }
+    const char *end() const { return data + size; }
+};
+
+bool matchesAny(const std::vector<std::string>& patterns, const std::string& s)
+{
+    if (patterns.empty())
+        return true;
+    for (auto& pattern : patterns)
+        if (fnmatch(pattern.c_str(), s.c_str(), 0) == 0)
+            return true;
+    return false;
+}
+
+/** Parses one result file into the thread's groups. */
+class ResultFileParser
+{
+  private:
+    const Options& opt;
+    GroupMap& groups;
+    std::string config, iterationVars;
+
+    // vectors of the current file: id -> group and running sum of this run
+    struct VectorState {
+        Group *group = nullptr;
+        uint64_t count = 0;
+        double sum = 0;
+    };
+    std::vector<VectorState> vectors;
+
+    std::string moduleKey(const std::string& module) const {
+        return opt.poolModules ? "*" : module;
+    }
+
+    Group& groupOf(const std::string& module, const std::string& name, char kind) {
+        return groups[GroupKey(config, iterationVars, moduleKey(module), name, kind)];
+    }
+
+    void addScalar(const std::string& module, const std::string& name, const char *value) {
+        if (opt.vectorsOnly || !matchesAny(opt.modulePatterns, module) || !matchesAny(opt.namePatterns, name))
+            return;
+        groupOf(module, name, 's').values.push_back(strtod(value, nullptr));
+    }
+
+    void declareVector(const std::vector<std::string>& t) {
+        // vector <id> <module> <name> [columns]
+        size_t id = strtoul(t[1].c_str(), nullptr, 10);
+        if (id >= vectors.size())
+            vectors.resize(id + 1);
+        vectors[id] = VectorState();
+        if (opt.scalarsOnly || !matchesAny(opt.modulePatterns, t[2]) || !matchesAny(opt.namePatterns, t[3]))
+            return;
+        Group& group = groupOf(t[2], t[3], 'v');
+        if (!group.sketch)
+            group.sketch.reset(new QuantileSketch());
+        vectors[id].group = &group;
+    }
+
+    /** Data line: "<id> [event] <time> <value>"; the value is the last column. */
+    void addSample(const char *line, const char *eol) {
+        size_t id = 0;
+        const char *p = line;
+        while (p < eol && *p >= '0' && *p <= '9')
+            id = id * 10 + (*p++ - '0');
+        if (id >= vectors.size() || !vectors[id].group)
+            return;
+        const char *last = eol;
+        while (last > p && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r'))
+            last--;
+        const char *start = last;
+        while (start > p && start[-1] != ' ' && start[-1] != '\t')
+            start--;
+        double value = strtod(std::string(start, last).c_str(), nullptr);
+
+        VectorState& v = vectors[id];
+        v.count++;
+        v.sum += value;
+        Group& g = *v.group;
+        g.samples++;
+        g.sampleMin = std::min(g.sampleMin, value);
+        g.sampleMax = std::max(g.sampleMax, value);
+        g.sketch->collect(value);
+    }
+
+    void endRun() {
+        for (auto& v : vectors)
+            if (v.group && v.count > 0)
+                v.group->values.push_back(v.sum / v.count);
+        vectors.clear();
+    }
+
+  public:
+    ResultFileParser(const Options& opt, GroupMap& groups) : opt(opt), groups(groups) {}
+
+    void parse(const std::string& fileName) {
+        MappedFile file(fileName);
+        std::string statisticModule, statisticName;
+        config.clear();
+        iterationVars.clear();
+
+        for (const char *line = file.begin(); line && line < file.end();) {
+            const char *eol = (const char *)memchr(line, '\n', file.end() - line);
+            if (!eol)
+                eol = file.end();
+            const char *next = eol + 1;
+
+            if (line < eol && *line >= '0' && *line <= '9') {
+                addSample(line, eol);  // hot path: vector data, no tokenizing
+            }
+            else if (line < eol) {
+                std::vector<std::string> t = tokenize(std::string(line, eol));
+                if (t.empty()) {
+                }
+                else if (t[0] == "run") {
+                    endRun();
+                    config.clear();
+                    iterationVars.clear();
+                }
+                else if (t[0] == "attr" && t.size() >= 3 && statisticName.empty()) {
+                    if (t[1] == "configname")
+                        config = t[2];
+                    else if (t[1] == "iterationvars")
+                        iterationVars = t[2];
+                }
+                else if (t[0] == "scalar" && t.size() >= 4) {
+                    statisticName.clear();
+                    addScalar(t[1], t[2], t[3].c_str());
+                }
+                else if (t[0] == "statistic" && t.size() >= 3) {
+                    statisticModule = t[1];
+                    statisticName = t[2];
+                }
+                else if (t[0] == "field" && t.size() >= 3 && !statisticName.empty()) {
+                    addScalar(statisticModule, statisticName + ":" + t[1], t[2].c_str());
+                }
+                else if (t[0] == "vector" && t.size() >= 4) {
+                    statisticName.clear();
+                    declareVector(t);
+                }
+                else if (t[0] != "attr" && t[0] != "bin") {
+                    statisticName.clear();
+                }
+            }
+            line = next;
+        }
+        endRun();
+    }
+};
+
+void findResultFiles(const std::string& path, const Options& opt, std::vector<std::string>& files)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        throw std::runtime_error("cannot access '" + path + "'");
+    if (!S_ISDIR(st.st_mode)) {
+        files.push_back(path);
+        return;
+    }
+    DIR *d = opendir(path.c_str());
+    if (!d)
+        return;
+    while (dirent *e = readdir(d)) {
+        std::string name = e->d_name;
+        if (name == "." || name == "..")
+            continue;
+        std::string full = path + "/" + name;
+        bool isSca = name.size() > 4 && name.compare(name.size() - 4, 4, ".sca") == 0;
+        bool isVec = name.size() > 4 && name.compare(name.size() - 4, 4, ".vec") == 0;
+        if ((isSca && !opt.vectorsOnly) || (isVec && !opt.scalarsOnly))
+            files.push_back(full);
+        else if (stat(full.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+            findResultFiles(full, opt, files);
+    }
+    closedir(d);
+}
+
+/** Two-sided 95% Student t quantile for n-1 degrees of freedom. */
+double tQuantile95(size_t n)
+{
+    static const double table[] = {
+        0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+    };
+    size_t dof = n - 1;
+    return dof < sizeof(table) / sizeof(table[0]) ? table[dof] : 1.96;
+}
+
+double exactQuantile(const std::vector<double>& sorted, double q)
+{
+    double pos = q * (sorted.size() - 1);
+    size_t lo = (size_t)pos;
+    if (lo + 1 >= sorted.size())
+        return sorted.back();
+    return sorted[lo] + (pos - lo) * (sorted[lo + 1] - sorted[lo]);
+}
+
+void writeSummary(std::ostream& out, GroupMap& groups)
+{
+    out.precision(10);
+    out << "config,iterationvars,module,name,kind,runs,count,mean,stddev,ci95,min,max,p50,p90,p99\n";
+    for (auto& entry : groups) {
+        const GroupKey& key = entry.first;
+        Group& g = entry.second;
+        std::vector<double>& v = g.values;
+        if (v.empty())
+            continue;
+        std::sort(v.begin(), v.end());
+
+        size_t n = v.size();
+        double mean = 0;
+        for (double x : v)
+            mean += x;
+        mean /= n;
+        double var = 0;
+        for (double x : v)
+            var += (x - mean) * (x - mean);
+        double stddev = n > 1 ? std::sqrt(var / (n - 1)) : 0;
+        double ci95 = n > 1 ? tQuantile95(n) * stddev / std::sqrt((double)n) : 0;
+
+        bool isVector = std::get<4>(key) == 'v';
+        out << csvField(std::get<0>(key)) << ',' << csvField(std::get<1>(key)) << ','
+            << csvField(std::get<2>(key)) << ',' << csvField(std::get<3>(key)) << ','
+            << (isVector ? "vector" : "scalar") << ',' << n << ','
+            << (isVector ? g.samples : n) << ',' << mean << ',' << stddev << ',' << ci95 << ',';
+        if (isVector)
+            out << g.sampleMin << ',' << g.sampleMax << ',' << g.sketch->getQuantile(0.5) << ','
+                << g.sketch->getQuantile(0.9) << ',' << g.sketch->getQuantile(0.99) << '\n';
+        else
+            out << v.front() << ',' << v.back() << ',' << exactQuantile(v, 0.5) << ','
+                << exactQuantile(v, 0.9) << ',' << exactQuantile(v, 0.99) << '\n';
+    }
+}
+
+void usage()
+{
+    std::cerr <<
+        "Usage: result_aggregator [options] <file or directory>...\n"
+        "  -m <pattern>  module pattern, e.g. '*.device*.app' (repeatable)\n"
+        "  -n <pattern>  result name pattern, e.g. 'endToEndDelay:*' (repeatable)\n"
+        "  -p            pool matching modules into one row per name\n"
+        "  -s            scalars (.sca) only\n"
+        "  -v            vectors (.vec) only\n"
+        "  -j <N>        worker threads (default: number of CPUs)\n"
+        "  -o <file>     output CSV (default: stdout)\n";
+}
+
+Options parseArgs(int argc, char **argv)
+{
+    Options opt;
+    int c;
+    while ((c = getopt(argc, argv, "m:n:psvj:o:h")) != -1) {
+        switch (c) {
+            case 'm': opt.modulePatterns.push_back(optarg); break;
+            case 'n': opt.namePatterns.push_back(optarg); break;
+            case 'p': opt.poolModules = true; break;
+            case 's': opt.scalarsOnly = true; break;
+            case 'v': opt.vectorsOnly = true; break;
+            case 'j': opt.threads = atoi(optarg); break;
+            case 'o': opt.outputFile = optarg; break;
+            default: usage(); exit(c == 'h' ? 0 : 1);
+        }
+    }
+    for (int i = optind; i < argc; i++)
+        opt.inputs.push_back(argv[i]);
+    if (opt.inputs.empty() || (opt.scalarsOnly && opt.vectorsOnly)) {
+        usage();
+        exit(1);
+    }
+    if (opt.threads <= 0)
+        opt.threads = std::max(1u, std::thread::hardware_concurrency());
+    return opt;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    try {
+        Options opt = parseArgs(argc, argv);
+        auto start = std::chrono::steady_clock::now();
+
+        std::vector<std::string> files;
+        for (auto& input : opt.inputs)
+            findResultFiles(input, opt, files);
+        // big files first, so that no thread is left with a huge file at the end
+        std::vector<std::pair<off_t, std::string>> bySize;
+        for (auto& file : files) {
+            struct stat st;
+            bySize.push_back({stat(file.c_str(), &st) == 0 ? st.st_size : 0, file});
+        }
+        std::sort(bySize.rbegin(), bySize.rend());
+
+        int numThreads = std::min<int>(opt.threads, std::max<size_t>(1, files.size()));
+        std::vector<GroupMap> partial(numThreads);
+        std::vector<std::string> errors(numThreads);
+        std::atomic<size_t> nextFile(0);
+        std::vector<std::thread> workers;
+        for (int i = 0; i < numThreads; i++) {
+            workers.emplace_back([&, i]() {
+                try {
+                    ResultFileParser parser(opt, partial[i]);
+                    for (size_t k; (k = nextFile++) < bySize.size();)
+                        parser.parse(bySize[k].second);
+                }
+                catch (std::exception& e) {
+                    errors[i] = e.what();
+                }
+            });
+        }
+        for (auto& worker : workers)
+            worker.join();
+        for (auto& error : errors)
+            if (!error.empty())
+                throw std::runtime_error(error);
+
+        GroupMap groups;
+        for (auto& p : partial)
+            for (auto& entry : p)
+                groups[entry.first].merge(entry.second);
+
+        if (opt.outputFile.empty())
+            writeSummary(std::cout, groups);
+        else {
+            std::ofstream out(opt.outputFile);
+            if (!out)
+                throw std::runtime_error("cannot write '" + opt.outputFile + "'");
+            writeSummary(out, groups);
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << "Aggregated " << files.size() << " files into " << groups.size() << " groups in "
+                  << seconds << "s using " << numThreads << " threads\n";
+        return 0;
+    }
+    catch (std::exception& e) {
+        std::cerr << "result_aggregator: " << e.what() << "\n";
+        return 1;
+    }
+}
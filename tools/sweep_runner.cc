@@ -0,0 +1,418 @@
+//
+// Parallel parameter-sweep runner for the SDN simulations.
+//
+// Expands the iteration variables (${...}) and the repeat count of an ini
+// config, runs every run in its own Cmdenv process on a pool of workers
+// (one per CPU by default, optionally pinned to cores), isolates the output
+// of each run in its own directory and finally merges all recorded scalars
+// into one summary CSV.
+//
+// Example (from simulations/):
+//   ../tools/sweep_runner -c NetSDN_ML_Comparison -p omnetpp_ml.ini
+//
+
+#include <sched.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SimFiles.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+    std::string executable = "../src/ModelingProject4SDNML";
+    std::string nedPath = ".:../src";
+    std::string config;
+    std::vector<std::string> iniFiles;
+    std::string outputDir;
+    std::string summaryFile;
+    std::string runFilter;
+    std::vector<std::string> extraArgs;
+    int workers = 0;
+    bool pinCores = false;
+    bool dryRun = false;
+    bool mergeOnly = false;
+};
+
+struct RunSlot {
+    int runNumber;
+    int slot;
+    int core;
+    Clock::time_point started;
+};
+
+/** Number of values of an iteration spec body, e.g. "a=1,2,3" or "x=0..10 step 2". */
+int countIterationValues(const std::string& body)
+{
+    std::string values = body;
+    size_t eq = body.find('=');
+    if (eq != std::string::npos && body.find_first_of("\"(,") > eq)
+        values = body.substr(eq + 1);
+
+    size_t range = values.find("..");
+    if (range != std::string::npos && values.find(',') == std::string::npos) {
+        double from = atof(values.substr(0, range).c_str());
+        std::string rest = values.substr(range + 2);
+        double step = 1;
+        size_t stepPos = rest.find("step");
+        if (stepPos != std::string::npos) {
+            step = atof(rest.substr(stepPos + 4).c_str());
+            rest = rest.substr(0, stepPos);
+        }
+        double to = atof(rest.c_str());
+        if (step == 0)
+            throw std::runtime_error("zero step in iteration '${" + body + "}'");
+        return (int)std::floor((to - from) / step + 1e-9) + 1;
+    }
+
+    int count = 1, depth = 0;
+    bool inQuotes = false;
+    for (char c : values) {
+        if (c == '"')
+            inQuotes = !inQuotes;
+        else if (!inQuotes && (c == '(' || c == '{'))
+            depth++;
+        else if (!inQuotes && (c == ')' || c == '}'))
+            depth--;
+        else if (!inQuotes && depth == 0 && c == ',')
+            count++;
+    }
+    return count;
+}
+
+/**
+ * Expands the iteration variables of a config and returns its number of runs
+ * (product of the variable sizes times 'repeat'). References to an already
+ * named variable (${name}) do not add a dimension.
+ */
+int countRuns(const IniFile& ini, const std::string& config)
+{
+    std::set<std::string> definedVars;
+    int repeat = -1;
+    long runs = 1;
+
+    for (const std::string& section : sectionChain(ini, config)) {
+        for (auto& kv : ini.at(section).entries) {
+            if (kv.first == "repeat" && repeat < 0)
+                repeat = atoi(kv.second.c_str());
+
+            const std::string& value = kv.second;
+            for (size_t pos = value.find("${"); pos != std::string::npos; pos = value.find("${", pos + 2)) {
+                size_t end = value.find('}', pos);
+                if (end == std::string::npos)
+                    throw std::runtime_error("unterminated iteration in '" + value + "'");
+                std::string body = trim(value.substr(pos + 2, end - pos - 2));
+
+                size_t eq = body.find('=');
+                bool named = eq != std::string::npos && body.find_first_of("\"(,") > eq;
+                if (!named && body.find_first_of(",.") == std::string::npos)
+                    continue;  // ${name}: reference to a variable defined elsewhere
+                if (named && !definedVars.insert(trim(body.substr(0, eq))).second)
+                    continue;
+
+                runs *= countIterationValues(body);
+            }
+        }
+    }
+    return (int)(runs * (repeat > 0 ? repeat : 1));
+}
+
+/** Parses "0..9,12,15..17" into run numbers below numRuns. */
+std::vector<int> parseRunFilter(const std::string& filter, int numRuns)
+{
+    std::vector<int> result;
+    if (filter.empty()) {
+        for (int i = 0; i < numRuns; i++)
+            result.push_back(i);
+        return result;
+    }
+
+    std::stringstream items(filter);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        size_t range = item.find("..");
+        int from = atoi(item.substr(0, range).c_str());
+        int to = range == std::string::npos ? from : atoi(item.substr(range + 2).c_str());
+        for (int i = from; i <= to && i < numRuns; i++)
+            result.push_back(i);
+    }
+    return result;
+}
+
+std::string runDir(const Options& opt, int runNumber)
+{
+    return opt.outputDir + "/run" + std::to_string(runNumber);
+}
+
+std::vector<std::string> buildCommand(const Options& opt, int runNumber)
+{
+    std::string dir = runDir(opt, runNumber);
+    std::vector<std::string> args = {
+        opt.executable, "-u", "Cmdenv", "-n", opt.nedPath,
+        "-c", opt.config, "-r", std::to_string(runNumber),
+        "--result-dir=" + dir,
+        "--cmdenv-express-mode=true",
+        // every run gets its own dataset file instead of all of them
+        // appending to the shared sdn_dataset.csv
+        "--**.controller.datasetFile=\"" + dir + "/sdn_dataset.csv\"",
+    };
+    for (auto& arg : opt.extraArgs)
+        args.push_back(arg);
+    for (auto& ini : opt.iniFiles)
+        args.push_back(ini);
+    return args;
+}
+
+pid_t startRun(const Options& opt, int runNumber, int core)
+{
+    std::string dir = runDir(opt, runNumber);
+    makeDirs(dir);
+    return spawnProcess(buildCommand(opt, runNumber), dir + "/stdout.log", core);
+}
+
+/** Appends the scalars of one .sca file to the summary, one row per scalar. */
+int mergeScalarFile(const std::string& fileName, std::ostream& out)
+{
+    std::ifstream in(fileName);
+    std::string line, runId, config, iterVars, repetition;
+    int rows = 0;
+    while (std::getline(in, line)) {
+        std::vector<std::string> t = tokenize(line);
+        if (t.empty())
+            continue;
+        if (t[0] == "run" && t.size() >= 2)
+            runId = t[1];
+        else if (t[0] == "attr" && t.size() >= 3) {
+            if (t[1] == "configname")
+                config = t[2];
+            else if (t[1] == "iterationvars")
+                iterVars = t[2];
+            else if (t[1] == "repetition")
+                repetition = t[2];
+        }
+        else if (t[0] == "scalar" && t.size() >= 4) {
+            out << csvField(config) << ',' << csvField(runId) << ',' << csvField(iterVars) << ','
+                << repetition << ',' << csvField(t[1]) << ',' << csvField(t[2]) << ',' << t[3] << '\n';
+            rows++;
+        }
+    }
+    return rows;
+}
+
+std::vector<std::string> listScalarFiles(const std::string& dir)
+{
+    std::vector<std::string> files;
+    if (DIR *d = opendir(dir.c_str())) {
+        while (dirent *e = readdir(d)) {
+            std::string name = e->d_name;
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".sca") == 0)
+                files.push_back(dir + "/" + name);
+        }
+        closedir(d);
+    }
+    return files;
+}
+
+void mergeResults(const Options& opt, const std::vector<int>& runs)
+{
+    std::ofstream out(opt.summaryFile);
+    if (!out)
+        throw std::runtime_error("cannot write summary '" + opt.summaryFile + "'");
+    out << "config,run,iterationvars,repetition,module,name,value\n";
+
+    int rows = 0, files = 0;
+    for (int run : runs) {
+        for (auto& file : listScalarFiles(runDir(opt, run))) {
+            rows += mergeScalarFile(file, out);
+            files++;
+        }
+    }
+    std::cout << "Merged " << rows << " scalars from " << files << " result files into "
+              << opt.summaryFile << "\n";
+}
+
+void usage()
+{
+    std::cerr <<
+        "Usage: sweep_runner [options] -c <config> <inifile>...\n"
+        "  -c <config>   config to sweep\n"
+        "  -x <exe>      simulation executable (default ../src/ModelingProject4SDNML)\n"
+        "  -n <nedpath>  NED path (default .:../src)\n"
+        "  -j <N>        number of worker processes (default: number of CPUs)\n"
+        "  -p            pin worker k to the k-th CPU of the affinity mask\n"
+        "  -r <runs>     run filter, e.g. 0..9,12 (default: all runs)\n"
+        "  -o <dir>      output root (default results/sweep/<config>)\n"
+        "  -s <file>     summary CSV (default <dir>/summary.csv)\n"
+        "  -a <arg>      extra argument for every run (repeatable)\n"
+        "  -m            only merge the results of a previous sweep\n"
+        "  -d            dry run: print the commands only\n";
+}
+
+Options parseArgs(int argc, char **argv)
+{
+    Options opt;
+    int c;
+    while ((c = getopt(argc, argv, "c:x:n:j:pr:o:s:a:mdh")) != -1) {
+        switch (c) {
+            case 'c': opt.config = optarg; break;
+            case 'x': opt.executable = optarg; break;
+            case 'n': opt.nedPath = optarg; break;
+            case 'j': opt.workers = atoi(optarg); break;
+            case 'p': opt.pinCores = true; break;
+            case 'r': opt.runFilter = optarg; break;
+            case 'o': opt.outputDir = optarg; break;
+            case 's': opt.summaryFile = optarg; break;
+            case 'a': opt.extraArgs.push_back(optarg); break;
+            case 'm': opt.mergeOnly = true; break;
+            case 'd': opt.dryRun = true; break;
+            default: usage(); exit(c == 'h' ? 0 : 1);
+        }
+    }
+    for (int i = optind; i < argc; i++)
+        opt.iniFiles.push_back(argv[i]);
+
+    if (opt.config.empty() || opt.iniFiles.empty()) {
+        usage();
+        exit(1);
+    }
+    if (opt.workers <= 0)
+        opt.workers = std::max(1u, std::thread::hardware_concurrency());
+    if (opt.outputDir.empty())
+        opt.outputDir = "results/sweep/" + opt.config;
+    if (opt.summaryFile.empty())
+        opt.summaryFile = opt.outputDir + "/summary.csv";
+    return opt;
+}
+
+/** CPUs this process may run on; worker slot k is pinned to the k-th of them. */
+std::vector<int> allowedCores()
+{
+    std::vector<int> cores;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int i = 0; i < CPU_SETSIZE; i++)
+            if (CPU_ISSET(i, &set))
+                cores.push_back(i);
+    }
+    return cores;
+}
+
+int runSweep(const Options& opt, const std::vector<int>& runs)
+{
+    std::map<pid_t, RunSlot> active;
+    std::vector<bool> slotBusy(opt.workers, false);
+    std::vector<int> cores = opt.pinCores ? allowedCores() : std::vector<int>();
+    double busySeconds = 0;
+    int failed = 0;
+    size_t next = 0;
+    Clock::time_point sweepStart = Clock::now();
+
+    while (next < runs.size() || !active.empty()) {
+        while (next < runs.size() && (int)active.size() < opt.workers) {
+            int slot = 0;
+            while (slotBusy[slot])
+                slot++;
+            slotBusy[slot] = true;
+            int core = cores.empty() ? -1 : cores[slot % cores.size()];
+
+            pid_t pid = startRun(opt, runs[next], core);
+            active[pid] = {runs[next], slot, core, Clock::now()};
+            next++;
+        }
+
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(std::string("waitpid failed: ") + strerror(errno));
+        }
+        auto it = active.find(pid);
+        if (it == active.end())
+            continue;
+
+        double seconds = std::chrono::duration<double>(Clock::now() - it->second.started).count();
+        busySeconds += seconds;
+        bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        if (!ok)
+            failed++;
+        std::cout << "run " << it->second.runNumber << (ok ? " done" : " FAILED")
+                  << " in " << seconds << "s"
+                  << (it->second.core >= 0 ? " (core " + std::to_string(it->second.core) + ")" : "")
+                  << "  [" << (runs.size() - next + active.size() - 1) << " left]\n";
+        slotBusy[it->second.slot] = false;
+        active.erase(it);
+    }
+
+    double wall = std::chrono::duration<double>(Clock::now() - sweepStart).count();
+    std::cout << "Sweep finished: " << runs.size() << " runs, " << failed << " failed, "
+              << wall << "s wall clock, " << busySeconds << "s total work, "
+              << "parallel efficiency " << (wall > 0 ? 100.0 * busySeconds / (wall * opt.workers) : 0)
+              << "%\n";
+    return failed;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    try {
+        Options opt = parseArgs(argc, argv);
+
+        IniFile ini;
+        for (auto& file : opt.iniFiles) {
+            std::string section = "General";
+            readIniFile(file, ini, section);
+        }
+
+        int numRuns = countRuns(ini, opt.config);
+        std::vector<int> runs = parseRunFilter(opt.runFilter, numRuns);
+        std::cout << "Config " << opt.config << ": " << numRuns << " runs, "
+                  << runs.size() << " selected, " << opt.workers << " workers"
+                  << (opt.pinCores ? " (pinned)" : "") << "\n";
+
+        if (opt.dryRun) {
+            for (int run : runs) {
+                for (auto& arg : buildCommand(opt, run))
+                    std::cout << arg << ' ';
+                std::cout << "\n";
+            }
+            return 0;
+        }
+
+        int failed = 0;
+        if (!opt.mergeOnly) {
+            signal(SIGPIPE, SIG_IGN);
+            failed = runSweep(opt, runs);
+        }
+        makeDirs(dirName(opt.summaryFile));
+        mergeResults(opt, runs);
+        return failed ? 1 : 0;
+    }
+    catch (std::exception& e) {
+        std::cerr << "sweep_runner: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,224 @@
+//
+// Displays the live telemetry that TelemetryExporter publishes in shared
+// memory (see src/TelemetryShm.h) while a simulation is running.
+//
+// Examples:
+//   telemetry_reader                        refresh a summary every second
+//   telemetry_reader -c > live.csv          one CSV line per published sample
+//   telemetry_reader -1 -n /sdnml-run3      print the latest sample and exit
+//
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "TelemetryShm.h"
+
+namespace {
+
+struct Options {
+    std::string shmName = "/sdnml-telemetry";
+    double interval = 1.0;
+    int top = 5;
+    bool once = false;
+    bool csv = false;
+};
+
+/** Maps the region read-only, waiting for the simulation to create it. */
+const TelemetryRegion *attach(const Options& opt)
+{
+    bool waiting = false;
+    while (true) {
+        int fd = shm_open(opt.shmName.c_str(), O_RDONLY, 0);
+        if (fd >= 0) {
+            void *p = mmap(nullptr, sizeof(TelemetryRegion), PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED)
+                throw std::runtime_error("cannot map '" + opt.shmName + "': " + strerror(errno));
+            const TelemetryRegion *region = (const TelemetryRegion *)p;
+            if (memcmp(region->magic, TELEMETRY_MAGIC, sizeof(TELEMETRY_MAGIC)) == 0) {
+                if (region->version != TELEMETRY_VERSION || region->sampleSize != sizeof(TelemetrySample))
+                    throw std::runtime_error("'" + opt.shmName + "' was written by an incompatible version");
+                return region;
+            }
+            munmap(p, sizeof(TelemetryRegion));
+        }
+        else if (errno != ENOENT) {
+            throw std::runtime_error("cannot open '" + opt.shmName + "': " + strerror(errno));
+        }
+        if (opt.once)
+            throw std::runtime_error("no simulation is publishing to '" + opt.shmName + "'");
+        if (!waiting)
+            std::cerr << "waiting for a simulation to publish to " << opt.shmName << "...\n";
+        waiting = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+}
+
+/** Latest consistent sample; false if nothing is published yet. */
+bool readLatest(const TelemetryRegion *region, TelemetrySample& sample)
+{
+    for (int attempt = 0; attempt < 100; attempt++) {
+        uint64_t published = region->published.load(std::memory_order_acquire);
+        if (published == 0)
+            return false;
+        if (readTelemetry(region, published - 1, sample))
+            return true;
+    }
+    return false;
+}
+
+void printSummary(const Options& opt, const TelemetryRegion *region, const TelemetrySample& s, const TelemetrySample *prev)
+{
+    printf("pid %d  sample %llu  t=%.3fs  wall %.1fs  events %lld",
+           region->pid, (unsigned long long)s.index, s.simTime, s.wallTime, (long long)s.eventNumber);
+    if (prev && s.wallTime > prev->wallTime) {
+        double dt = s.wallTime - prev->wallTime;
+        printf("  (%.0f ev/s, %.2f simsec/s)", (s.eventNumber - prev->eventNumber) / dt,
+               (s.simTime - prev->simTime) / dt);
+    }
+    printf("%s\n", region->finished.load() ? "  [finished]" : "");
+    printf("  routing decisions %llu  drops %llu  ML model %.1f KiB\n",
+           (unsigned long long)s.routingDecisions, (unsigned long long)s.drops, s.modelBytes / 1024.0);
+
+    // the nodes closest to depletion and the longest queues
+    std::vector<std::pair<float, int>> batteries;
+    for (int i = 0; i < s.numNodes; i++)
+        batteries.push_back({s.battery[i], s.nodeAddress[i]});
+    std::sort(batteries.begin(), batteries.end());
+    if (!batteries.empty()) {
+        printf("  lowest batteries:");
+        for (int i = 0; i < (int)batteries.size() && i < opt.top; i++)
+            printf("  node %d %.1f%%", batteries[i].second, batteries[i].first);
+        printf("\n");
+    }
+
+    std::vector<std::pair<int, int>> queues;
+    for (int i = 0; i < s.numQueues; i++)
+        if (s.queueLength[i] > 0)
+            queues.push_back({-s.queueLength[i], i});
+    std::sort(queues.begin(), queues.end());
+    printf("  longest queues:");
+    if (queues.empty())
+        printf("  (all empty)");
+    for (int i = 0; i < (int)queues.size() && i < opt.top; i++)
+        printf("  %s=%d", region->queueNames[queues[i].second], -queues[i].first);
+    printf("\n\n");
+    fflush(stdout);
+}
+
+void printCsv(const TelemetrySample& s)
+{
+    double batterySum = 0, batteryMin = s.numNodes ? 100 : 0;
+    for (int i = 0; i < s.numNodes; i++) {
+        batterySum += s.battery[i];
+        batteryMin = std::min(batteryMin, (double)s.battery[i]);
+    }
+    long queued = 0;
+    int queueMax = 0;
+    for (int i = 0; i < s.numQueues; i++) {
+        queued += s.queueLength[i];
+        queueMax = std::max(queueMax, s.queueLength[i]);
+    }
+    printf("%llu,%.6f,%.3f,%lld,%llu,%llu,%lld,%.3f,%.3f,%ld,%d\n",
+           (unsigned long long)s.index, s.simTime, s.wallTime, (long long)s.eventNumber,
+           (unsigned long long)s.routingDecisions, (unsigned long long)s.drops, (long long)s.modelBytes,
+           s.numNodes ? batterySum / s.numNodes : 0, batteryMin, queued, queueMax);
+    fflush(stdout);
+}
+
+void follow(const Options& opt, const TelemetryRegion *region)
+{
+    TelemetrySample sample, prev;
+    bool havePrev = false;
+    uint64_t next = 0;
+    if (opt.csv)
+        printf("sample,sim_time,wall_time,events,routing_decisions,drops,model_bytes,"
+               "battery_mean,battery_min,queued_packets,queue_max\n");
+
+    while (true) {
+        bool finished = region->finished.load(std::memory_order_acquire);
+        if (opt.csv) {
+            // every sample still in the ring, in order
+            uint64_t published = region->published.load(std::memory_order_acquire);
+            if (published > next + TELEMETRY_SLOTS) {
+                std::cerr << "telemetry_reader: skipped " << published - TELEMETRY_SLOTS - next << " samples\n";
+                next = published - TELEMETRY_SLOTS;
+            }
+            while (next < published) {
+                if (readTelemetry(region, next, sample))
+                    printCsv(sample);
+                next++;
+            }
+        }
+        else if (readLatest(region, sample) && (!havePrev || sample.index != prev.index || opt.once)) {
+            printSummary(opt, region, sample, havePrev ? &prev : nullptr);
+            prev = sample;
+            havePrev = true;
+        }
+        if (opt.once || finished)
+            return;
+        std::this_thread::sleep_for(std::chrono::duration<double>(opt.csv ? 0.05 : opt.interval));
+    }
+}
+
+void usage()
+{
+    std::cerr <<
+        "Usage: telemetry_reader [options]\n"
+        "  -n <name>   shared memory object (default /sdnml-telemetry, see shmName)\n"
+        "  -i <s>      refresh interval in seconds (default 1)\n"
+        "  -t <N>      nodes and queues to list (default 5)\n"
+        "  -c          CSV: one line per published sample instead of the summary\n"
+        "  -1          print the latest sample once and exit\n";
+}
+
+Options parseArgs(int argc, char **argv)
+{
+    Options opt;
+    int c;
+    while ((c = getopt(argc, argv, "n:i:t:c1h")) != -1) {
+        switch (c) {
+            case 'n': opt.shmName = optarg; break;
+            case 'i': opt.interval = atof(optarg); break;
+            case 't': opt.top = atoi(optarg); break;
+            case 'c': opt.csv = true; break;
+            case '1': opt.once = true; break;
+            default: usage(); exit(c == 'h' ? 0 : 1);
+        }
+    }
+    if (optind != argc) {
+        usage();
+        exit(1);
+    }
+    return opt;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    try {
+        Options opt = parseArgs(argc, argv);
+        const TelemetryRegion *region = attach(opt);
+        follow(opt, region);
+        return 0;
+    }
+    catch (std::exception& e) {
+        std::cerr << "telemetry_reader: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,384 @@
+//
+// Converts the compressed output vectors of CompressedOutputVectorManager
+// (.vecz, see src/VectorCodec.h) into a standard OMNeT++ .vec file, or
+// lists their contents from the block index without decoding any samples.
+//
+// Examples:
+//   vecz2vec results/NetSDN_ML_HighLoad-#0.vecz      -> ...-#0.vec
+//   vecz2vec -l results/NetSDN_ML_HighLoad-#0.vecz   vector summary
+//   vecz2vec -v 3 -o delay.vec results/...vecz       only vector 3
+//
+
+#include <unistd.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "VectorCodec.h"
+
+namespace {
+
+struct Options {
+    std::string inputFile;
+    std::string outputFile;
+    int precision = 14;     // OMNeT++ default output-vector-precision
+    long vectorId = -1;
+    bool list = false;
+};
+
+struct VectorDecl {
+    std::string module;
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> attributes;
+};
+
+struct Record {
+    char tag = 0;
+    std::string payload;
+};
+
+/** Sequential and random access to the records of a .vecz file. */
+class VeczFile
+{
+  private:
+    static const int HEADER_SIZE = 6;  // magic, version, scale exponent
+    FILE *f;
+    int scaleExp = -12;
+
+  public:
+    explicit VeczFile(const std::string& fileName) {
+        f = fopen(fileName.c_str(), "rb");
+        if (!f)
+            throw std::runtime_error("cannot open '" + fileName + "'");
+        char header[HEADER_SIZE];
+        if (fread(header, 1, HEADER_SIZE, f) != HEADER_SIZE || memcmp(header, VECZ_MAGIC, 4) != 0)
+            throw std::runtime_error("'" + fileName + "' is not a .vecz file");
+        if (header[4] != VECZ_VERSION)
+            throw std::runtime_error("unsupported .vecz version " + std::to_string((int)header[4]));
+        scaleExp = (signed char)header[5];
+    }
+    ~VeczFile() { fclose(f); }
+
+    int getScaleExp() const { return scaleExp; }
+
+    /** Reads the next record; skipBlocks seeks over block payloads. Returns false at the index or at EOF. */
+    bool next(Record& record, bool skipBlocks = false) {
+        int tag = fgetc(f);
+        if (tag == EOF)
+            return false;
+        uint64_t length = 0;
+        for (int shift = 0;; shift += 7) {
+            int b = fgetc(f);
+            if (b == EOF || shift > 63)
+                throw std::runtime_error("truncated record header");
+            length |= (uint64_t)(b & 0x7f) << shift;
+            if (!(b & 0x80))
+                break;
+        }
+        record.tag = (char)tag;
+        if (skipBlocks && tag == VECZ_BLOCK) {
+            record.payload.clear();
+            fseeko(f, (off_t)length, SEEK_CUR);
+            return true;
+        }
+        record.payload.resize(length);
+        if (length > 0 && fread(&record.payload[0], 1, length, f) != length)
+            throw std::runtime_error("truncated record (file not closed properly?)");
+        return tag != VECZ_INDEX;  // the index and the trailer end the records
+    }
+
+    void seek(uint64_t offset) { fseeko(f, (off_t)offset, SEEK_SET); }
+    void rewind() { seek(HEADER_SIZE); }
+
+    /** Reads the block index through the trailer. */
+    std::vector<VectorBlockInfo> readIndex() {
+        unsigned char trailer[12];
+        if (fseeko(f, -12, SEEK_END) != 0 || fread(trailer, 1, 12, f) != 12 || memcmp(trailer + 8, VECZ_MAGIC, 4) != 0)
+            throw std::runtime_error("no block index (the run did not finish?)");
+        uint64_t offset = 0;
+        for (int i = 0; i < 8; i++)
+            offset |= (uint64_t)trailer[i] << (8 * i);
+        seek(offset);
+        Record record;
+        if (next(record) || record.tag != VECZ_INDEX)
+            throw std::runtime_error("trailer does not point to the block index");
+
+        ByteReader r(record.payload.data(), record.payload.size());
+        std::vector<VectorBlockInfo> index(r.varint());
+        for (auto& info : index)
+            info = r.blockInfo();
+        return index;
+    }
+};
+
+std::string quoteIfNeeded(const std::string& s)
+{
+    if (!s.empty() && s.find_first_of(" \t\"\\\n") == std::string::npos)
+        return s;
+    std::string quoted = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            quoted += '\\';
+        quoted += c == '\n' ? ' ' : c;
+    }
+    return quoted + "\"";
+}
+
+/** Prints raw * 10^scaleExp exactly, like SimTime::str(). */
+std::string formatTime(int64_t raw, int scaleExp)
+{
+    std::string sign = raw < 0 ? "-" : "";
+    uint64_t value = raw < 0 ? -(uint64_t)raw : (uint64_t)raw;
+    if (scaleExp >= 0) {
+        std::string s = std::to_string(value);
+        if (value != 0)
+            s.append(scaleExp, '0');
+        return sign + s;
+    }
+    uint64_t scale = 1;
+    for (int i = 0; i < -scaleExp; i++)
+        scale *= 10;
+    std::string frac = std::to_string(value % scale);
+    frac.insert(0, -scaleExp - frac.size(), '0');
+    frac.erase(frac.find_last_not_of('0') + 1);
+    return sign + std::to_string(value / scale) + (frac.empty() ? "" : "." + frac);
+}
+
+VectorDecl parseVector(const std::string& payload, uint64_t& id)
+{
+    ByteReader r(payload.data(), payload.size());
+    VectorDecl decl;
+    id = r.varint();
+    decl.module = r.string();
+    decl.name = r.string();
+    for (uint64_t n = r.varint(); n > 0; n--) {
+        std::string key = r.string();
+        decl.attributes.push_back({key, r.string()});
+    }
+    return decl;
+}
+
+void writeVectorHeader(FILE *out, uint64_t id, const VectorDecl& decl)
+{
+    fprintf(out, "vector %" PRIu64 " %s %s ETV\n", id, quoteIfNeeded(decl.module).c_str(), quoteIfNeeded(decl.name).c_str());
+    for (auto& attr : decl.attributes)
+        fprintf(out, "attr %s %s\n", attr.first.c_str(), quoteIfNeeded(attr.second).c_str());
+}
+
+/** Decodes one block record and writes its samples as .vec data lines. */
+uint64_t writeBlock(FILE *out, const std::string& payload, int scaleExp, int precision)
+{
+    ByteReader r(payload.data(), payload.size());
+    VectorBlockInfo info = r.blockInfo();
+    std::vector<VectorSample> samples;
+    decodeSamples(r.position(), r.remaining(), info.count, samples);
+    for (const VectorSample& s : samples)
+        fprintf(out, "%" PRIu64 "\t%" PRId64 "\t%s\t%.*g\n", info.vectorId, s.eventNumber,
+                formatTime(s.rawTime, scaleExp).c_str(), precision, s.value);
+    return samples.size();
+}
+
+/** Reads all vector declarations, skipping over the sample blocks. */
+std::map<uint64_t, VectorDecl> readDeclarations(VeczFile& in)
+{
+    std::map<uint64_t, VectorDecl> vectors;
+    Record record;
+    while (in.next(record, true)) {
+        if (record.tag == VECZ_VECTOR) {
+            uint64_t id;
+            VectorDecl decl = parseVector(record.payload, id);
+            vectors[id] = decl;
+        }
+    }
+    return vectors;
+}
+
+void listVectors(const Options& opt)
+{
+    VeczFile in(opt.inputFile);
+    std::map<uint64_t, VectorDecl> vectors = readDeclarations(in);
+
+    struct Summary { uint64_t blocks = 0, count = 0; int64_t start = 0, end = 0; double min = 0, max = 0; };
+    std::map<uint64_t, Summary> summaries;
+    for (const VectorBlockInfo& info : in.readIndex()) {
+        Summary& s = summaries[info.vectorId];
+        if (s.blocks == 0) {
+            s.start = info.startRawTime;
+            s.min = info.min;
+            s.max = info.max;
+        }
+        s.blocks++;
+        s.count += info.count;
+        s.end = info.endRawTime;
+        s.min = std::min(s.min, info.min);
+        s.max = std::max(s.max, info.max);
+    }
+
+    printf("id\tcount\tblocks\tstart\tend\tmin\tmax\tmodule\tname\n");
+    for (auto& entry : summaries) {
+        const Summary& s = entry.second;
+        const VectorDecl& decl = vectors[entry.first];
+        printf("%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%s\t%s\t%.*g\t%.*g\t%s\t%s\n", entry.first, s.count, s.blocks,
+               formatTime(s.start, in.getScaleExp()).c_str(), formatTime(s.end, in.getScaleExp()).c_str(),
+               opt.precision, s.min, opt.precision, s.max, decl.module.c_str(), decl.name.c_str());
+    }
+}
+
+void convert(const Options& opt)
+{
+    VeczFile in(opt.inputFile);
+    FILE *out = fopen(opt.outputFile.c_str(), "w");
+    if (!out)
+        throw std::runtime_error("cannot write '" + opt.outputFile + "'");
+
+    fprintf(out, "version 3\n");
+    Record record;
+    std::string runId;
+    std::vector<std::pair<std::string, std::string>> attrs, itervars;
+    uint64_t samples = 0, vectorCount = 0;
+    bool headerDone = false;
+
+    auto writeRunHeader = [&]() {
+        fprintf(out, "run %s\n", quoteIfNeeded(runId).c_str());
+        for (auto& a : attrs)
+            fprintf(out, "attr %s %s\n", a.first.c_str(), quoteIfNeeded(a.second).c_str());
+        for (auto& v : itervars)
+            fprintf(out, "itervar %s %s\n", v.first.c_str(), quoteIfNeeded(v.second).c_str());
+        fprintf(out, "\n");
+        headerDone = true;
+    };
+
+    if (opt.vectorId >= 0) {
+        // one vector: declarations by a skipping scan, samples through the index
+        std::map<uint64_t, VectorDecl> vectors = readDeclarations(in);
+        in.rewind();
+        while (in.next(record, true)) {
+            ByteReader r(record.payload.data(), record.payload.size());
+            if (record.tag == VECZ_RUN_ATTR || record.tag == VECZ_ITERVAR) {
+                std::string key = r.string(), value = r.string();
+                if (record.tag == VECZ_ITERVAR)
+                    itervars.push_back({key, value});
+                else if (key == "runid")
+                    runId = value;
+                else
+                    attrs.push_back({key, value});
+            }
+        }
+        writeRunHeader();
+        auto it = vectors.find(opt.vectorId);
+        if (it == vectors.end())
+            throw std::runtime_error("no vector with id " + std::to_string(opt.vectorId));
+        writeVectorHeader(out, it->first, it->second);
+        vectorCount = 1;
+        for (const VectorBlockInfo& info : in.readIndex()) {
+            if (info.vectorId != (uint64_t)opt.vectorId)
+                continue;
+            in.seek(info.offset);
+            if (!in.next(record) || record.tag != VECZ_BLOCK)
+                throw std::runtime_error("block index points to a non-block record");
+            samples += writeBlock(out, record.payload, in.getScaleExp(), opt.precision);
+        }
+    }
+    else {
+        while (in.next(record)) {
+            ByteReader r(record.payload.data(), record.payload.size());
+            switch (record.tag) {
+                case VECZ_RUN_ATTR: {
+                    std::string key = r.string(), value = r.string();
+                    if (key == "runid")
+                        runId = value;
+                    else
+                        attrs.push_back({key, value});
+                    break;
+                }
+                case VECZ_ITERVAR: {
+                    std::string key = r.string();
+                    itervars.push_back({key, r.string()});
+                    break;
+                }
+                case VECZ_VECTOR: {
+                    if (!headerDone)
+                        writeRunHeader();
+                    uint64_t id;
+                    VectorDecl decl = parseVector(record.payload, id);
+                    writeVectorHeader(out, id, decl);
+                    vectorCount++;
+                    break;
+                }
+                case VECZ_BLOCK:
+                    samples += writeBlock(out, record.payload, in.getScaleExp(), opt.precision);
+                    break;
+                default:
+                    break;  // unknown records are skipped, newer writers may add some
+            }
+        }
+        if (!headerDone)
+            writeRunHeader();
+    }
+
+    fclose(out);
+    std::cout << opt.outputFile << ": " << vectorCount << " vectors, " << samples << " samples\n";
+}
+
+void usage()
+{
+    std::cerr <<
+        "Usage: vecz2vec [options] <file.vecz>\n"
+        "  -o <file>   output .vec file (default: input with .vec extension)\n"
+        "  -v <id>     convert only this vector (located through the block index)\n"
+        "  -p <N>      significant digits of the values (default 14, 17 is lossless)\n"
+        "  -l          list the vectors from the block index instead of converting\n";
+}
+
+Options parseArgs(int argc, char **argv)
+{
+    Options opt;
+    int c;
+    while ((c = getopt(argc, argv, "o:v:p:lh")) != -1) {
+        switch (c) {
+            case 'o': opt.outputFile = optarg; break;
+            case 'v': opt.vectorId = atol(optarg); break;
+            case 'p': opt.precision = atoi(optarg); break;
+            case 'l': opt.list = true; break;
+            default: usage(); exit(c == 'h' ? 0 : 1);
+        }
+    }
+    if (optind != argc - 1) {
+        usage();
+        exit(1);
+    }
+    opt.inputFile = argv[optind];
+    if (opt.outputFile.empty()) {
+        opt.outputFile = opt.inputFile;
+        if (opt.outputFile.size() > 5 && opt.outputFile.compare(opt.outputFile.size() - 5, 5, ".vecz") == 0)
+            opt.outputFile.resize(opt.outputFile.size() - 1);
+        else
+            opt.outputFile += ".vec";
+    }
+    return opt;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    try {
+        Options opt = parseArgs(argc, argv);
+        if (opt.list)
+            listVectors(opt);
+        else
+            convert(opt);
+        return 0;
+    }
+    catch (std::exception& e) {
+        std::cerr << "vecz2vec: " << e.what() << "\n";
+        return 1;
+    }
+}